@@ -17,6 +17,9 @@ let package = Package(
         // Shaft playground app
         .executable(name: "Playground", targets: ["Playground"]),
 
+        // Headless benchmark of the frame pipeline
+        .executable(name: "ShaftBenchmark", targets: ["ShaftBenchmark"]),
+
         // .executable(name: "WebDemo", targets: ["WebDemo"]),
 
         // The Shaft framework, is platform-independent and requires a backend
@@ -114,6 +117,18 @@ let package = Package(
             ]
         ),
 
+        .executableTarget(
+            name: "ShaftBenchmark",
+            dependencies: [
+                "SwiftMath",
+                "Shaft",
+                "ShaftSkia",
+                "ShaftMarkdown",
+                "ShaftCodeHighlight",
+            ],
+            swiftSettings: [.interoperabilityMode(.Cxx)]
+        ),
+
         .target(
             name: "CSkia",
             dependencies: [
@@ -265,6 +280,10 @@ let package = Package(
             dependencies: [
                 "Shaft",
                 "ShaftSetup",
+                .target(
+                    name: "ShaftSkia",
+                    condition: .when(platforms: [.linux, .windows, .macOS])
+                ),
             ],
             swiftSettings: [
                 .interoperabilityMode(.Cxx)
@@ -1,6 +1,36 @@
 #include "utils.h"
 #include "utils_macos.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "include/codec/SkCodec.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkImageGenerator.h"
+#include "include/core/SkSerialProcs.h"
+#include "include/core/SkYUVAPixmaps.h"
+#include "include/utils/SkEventTracer.h"
+
 using namespace skia::textlayout;
 
 template struct sk_sp<FontCollection>;
@@ -157,6 +187,36 @@ SkCanvas *sk_surface_get_canvas(const sk_sp<SkSurface> &surface)
     return surface->getCanvas();
 }
 
+SkSurface_sp sk_surface_make_raster(int width, int height)
+{
+    auto info = SkImageInfo::Make(width, height, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+    return SkSurfaces::Raster(info);
+}
+
+bool sk_surface_peek_pixels(const SkSurface_sp &surface, SkPixmap *pixmap)
+{
+    return surface->peekPixels(pixmap);
+}
+
+void sk_surface_draw_replacing(SkSurface_sp &surface, SkCanvas *canvas)
+{
+    SkPaint paint;
+    paint.setBlendMode(SkBlendMode::kSrc);
+    surface->draw(canvas, 0, 0, &paint);
+}
+
+// MARK: - Data
+
+SkData_sp sk_data_new_with_proc(const void *data, size_t length, sk_data_release_proc release, void *context)
+{
+    return SkData::MakeWithProc(data, length, release, context);
+}
+
+SkData_sp sk_data_new_from_file(const char *path)
+{
+    return SkData::MakeFromFileName(path);
+}
+
 // MARK: - Font
 
 FontCollection_sp sk_fontcollection_new()
@@ -177,10 +237,9 @@ void sk_fontcollection_register_typeface(FontCollection_sp &collection, SkTypefa
     typefaceProvider->registerTypeface(typeface);
 }
 
-SkTypeface_sp sk_typeface_create_from_data(const FontCollection_sp &collection, const char *data, size_t length)
+SkTypeface_sp sk_typeface_create_from_data(const FontCollection_sp &collection, const SkData_sp &data)
 {
-    auto bytes = SkData::MakeWithCopy(data, length);
-    return collection->getFallbackManager()->makeFromData(bytes);
+    return collection->getFallbackManager()->makeFromData(data);
 }
 
 std::vector<SkTypeface_sp> sk_fontcollection_find_typefaces(const FontCollection_sp &collection, const std::vector<SkString> &families, SkFontStyle style)
@@ -351,13 +410,362 @@ void sk_canvas_rotate(SkCanvas *canvas, float radians)
     canvas->rotate(radians);
 }
 
+// MARK: - Effect cache
+
+namespace
+{
+    // Effects are immutable and can be shared by any number of paints, so
+    // identical effects are created once and reused. Entries are dropped all
+    // at once when the table grows too large, which keeps lookups cheap for
+    // the handful of distinct effects a UI typically uses.
+    constexpr size_t kMaxInternedEffects = 256;
+
+    std::mutex gEffectCacheMutex;
+    std::unordered_map<uint64_t, sk_sp<SkMaskFilter>> gBlurMaskFilters;
+
+    sk_sp<SkMaskFilter> interned_blur_mask_filter(SkBlurStyle style, SkScalar sigma)
+    {
+        uint32_t sigmaBits;
+        std::memcpy(&sigmaBits, &sigma, sizeof(sigmaBits));
+        uint64_t key = (static_cast<uint64_t>(style) << 32) | sigmaBits;
+
+        std::lock_guard<std::mutex> lock(gEffectCacheMutex);
+        auto it = gBlurMaskFilters.find(key);
+        if (it != gBlurMaskFilters.end())
+        {
+            return it->second;
+        }
+        if (gBlurMaskFilters.size() >= kMaxInternedEffects)
+        {
+            gBlurMaskFilters.clear();
+        }
+        sk_sp<SkMaskFilter> filter = SkMaskFilter::MakeBlur(style, sigma);
+        gBlurMaskFilters.emplace(key, filter);
+        return filter;
+    }
+} // namespace
+
+namespace
+{
+    size_t color_filter_value_count(SkColorFilterKind kind)
+    {
+        switch (kind)
+        {
+        case SkColorFilterKind::kBlend:
+            return 2;
+        case SkColorFilterKind::kMatrix:
+            return 20;
+        default:
+            return 0;
+        }
+    }
+
+    sk_sp<SkColorFilter> make_color_filter(SkColorFilterKind kind, const uint32_t *values)
+    {
+        switch (kind)
+        {
+        case SkColorFilterKind::kNoFilter:
+            return nullptr;
+        case SkColorFilterKind::kBlend:
+            return SkColorFilters::Blend(values[0], static_cast<SkBlendMode>(values[1]));
+        case SkColorFilterKind::kMatrix:
+        {
+            float matrix[20];
+            memcpy(matrix, values, sizeof(matrix));
+            return SkColorFilters::Matrix(matrix);
+        }
+        case SkColorFilterKind::kLinearToSrgbGamma:
+            return SkColorFilters::LinearToSRGBGamma();
+        case SkColorFilterKind::kSrgbToLinearGamma:
+            return SkColorFilters::SRGBToLinearGamma();
+        }
+        return nullptr;
+    }
+} // namespace
+
+void sk_effect_cache_purge()
+{
+    std::lock_guard<std::mutex> lock(gEffectCacheMutex);
+    gBlurMaskFilters.clear();
+}
+
+// MARK: - Replay
+
+namespace
+{
+    constexpr uint32_t kNoBlur = 0xFFFFFFFF;
+
+    class SkReplayReader
+    {
+    public:
+        SkReplayReader(const uint32_t *ops, size_t count) : fCurrent(ops), fEnd(ops + count) {}
+
+        bool atEnd() const { return fCurrent >= fEnd; }
+
+        uint32_t u32() { return *fCurrent++; }
+
+        const uint32_t *current() const { return fCurrent; }
+
+        void skip(size_t count) { fCurrent += count; }
+
+        float f32()
+        {
+            float value;
+            memcpy(&value, fCurrent++, sizeof(float));
+            return value;
+        }
+
+        SkRect rect()
+        {
+            float left = f32();
+            float top = f32();
+            float right = f32();
+            float bottom = f32();
+            return SkRect::MakeLTRB(left, top, right, bottom);
+        }
+
+        SkRRect rrect()
+        {
+            SkRect bounds = rect();
+            SkVector radii[4];
+            for (auto &radius : radii)
+            {
+                float x = f32();
+                float y = f32();
+                radius.set(x, y);
+            }
+            SkRRect result;
+            result.setRectRadii(bounds, radii);
+            return result;
+        }
+
+        SkM44 matrix()
+        {
+            float values[16];
+            for (auto &value : values)
+            {
+                value = f32();
+            }
+            return SkM44::RowMajor(values);
+        }
+
+    private:
+        const uint32_t *fCurrent;
+        const uint32_t *fEnd;
+    };
+
+    void replay_set_paint(SkReplayReader &reader, SkPaint &paint)
+    {
+        paint.setAntiAlias(reader.u32() != 0);
+        paint.setColor(reader.u32());
+        paint.setBlendMode(static_cast<SkBlendMode>(reader.u32()));
+        paint.setStyle(static_cast<SkPaint::Style>(reader.u32()));
+        paint.setStrokeWidth(reader.f32());
+        paint.setStrokeCap(static_cast<SkPaint::Cap>(reader.u32()));
+        paint.setStrokeJoin(static_cast<SkPaint::Join>(reader.u32()));
+        paint.setStrokeMiter(reader.f32());
+        uint32_t blurStyle = reader.u32();
+        float blurSigma = reader.f32();
+        if (blurStyle == kNoBlur)
+        {
+            paint.setMaskFilter(nullptr);
+        }
+        else
+        {
+            paint.setMaskFilter(interned_blur_mask_filter(static_cast<SkBlurStyle>(blurStyle), blurSigma));
+        }
+        auto colorFilterKind = static_cast<SkColorFilterKind>(reader.u32());
+        paint.setColorFilter(make_color_filter(colorFilterKind, reader.current()));
+        reader.skip(color_filter_value_count(colorFilterKind));
+    }
+} // namespace
+
+void sk_canvas_replay(SkCanvas *canvas, const uint32_t *ops, size_t count)
+{
+    SkReplayReader reader(ops, count);
+    SkPaint paint;
+
+    while (!reader.atEnd())
+    {
+        switch (static_cast<SkReplayOp>(reader.u32()))
+        {
+        case SkReplayOp::kSetPaint:
+            replay_set_paint(reader, paint);
+            break;
+        case SkReplayOp::kDrawLine:
+        {
+            float x0 = reader.f32();
+            float y0 = reader.f32();
+            float x1 = reader.f32();
+            float y1 = reader.f32();
+            canvas->drawLine(x0, y0, x1, y1, paint);
+            break;
+        }
+        case SkReplayOp::kDrawRect:
+            canvas->drawRect(reader.rect(), paint);
+            break;
+        case SkReplayOp::kDrawRRect:
+            canvas->drawRRect(reader.rrect(), paint);
+            break;
+        case SkReplayOp::kDrawDRRect:
+        {
+            SkRRect outer = reader.rrect();
+            SkRRect inner = reader.rrect();
+            canvas->drawDRRect(outer, inner, paint);
+            break;
+        }
+        case SkReplayOp::kDrawCircle:
+        {
+            float x = reader.f32();
+            float y = reader.f32();
+            float radius = reader.f32();
+            canvas->drawCircle(x, y, radius, paint);
+            break;
+        }
+        case SkReplayOp::kSave:
+            canvas->save();
+            break;
+        case SkReplayOp::kSaveLayer:
+        {
+            SkRect bounds = reader.rect();
+            bool hasPaint = reader.u32() != 0;
+            canvas->saveLayer(&bounds, hasPaint ? &paint : nullptr);
+            break;
+        }
+        case SkReplayOp::kRestore:
+            canvas->restore();
+            break;
+        case SkReplayOp::kTranslate:
+        {
+            float dx = reader.f32();
+            float dy = reader.f32();
+            canvas->translate(dx, dy);
+            break;
+        }
+        case SkReplayOp::kScale:
+        {
+            float sx = reader.f32();
+            float sy = reader.f32();
+            canvas->scale(sx, sy);
+            break;
+        }
+        case SkReplayOp::kRotate:
+            canvas->rotate(reader.f32());
+            break;
+        case SkReplayOp::kConcat:
+            canvas->concat(reader.matrix());
+            break;
+        case SkReplayOp::kClipRect:
+        {
+            SkRect rect = reader.rect();
+            auto op = static_cast<SkClipOp>(reader.u32());
+            bool doAntiAlias = reader.u32() != 0;
+            canvas->clipRect(rect, op, doAntiAlias);
+            break;
+        }
+        case SkReplayOp::kClipRRect:
+        {
+            SkRRect rrect = reader.rrect();
+            auto op = static_cast<SkClipOp>(reader.u32());
+            bool doAntiAlias = reader.u32() != 0;
+            canvas->clipRRect(rrect, op, doAntiAlias);
+            break;
+        }
+        case SkReplayOp::kClear:
+            canvas->clear(reader.u32());
+            break;
+        default:
+            SkDEBUGFAIL("Unknown replay op");
+            return;
+        }
+    }
+}
+
+// MARK: - Picture
+
+SkPictureRecorder *sk_picture_recorder_new()
+{
+    return new SkPictureRecorder();
+}
+
+void sk_picture_recorder_delete(SkPictureRecorder *recorder)
+{
+    delete recorder;
+}
+
+SkCanvas *sk_picture_recorder_begin(SkPictureRecorder *recorder, const SkRect &bounds)
+{
+    SkRTreeFactory factory;
+    return recorder->beginRecording(bounds, &factory);
+}
+
+SkPicture_sp sk_picture_recorder_finish(SkPictureRecorder *recorder)
+{
+    return recorder->finishRecordingAsPicture();
+}
+
+void sk_canvas_draw_picture(SkCanvas *canvas, const SkPicture_sp &picture)
+{
+    canvas->drawPicture(picture);
+}
+
+size_t sk_picture_approximate_bytes_used(const SkPicture_sp &picture)
+{
+    return picture->approximateBytesUsed();
+}
+
+uint32_t sk_picture_unique_id(const SkPicture_sp &picture)
+{
+    return picture->uniqueID();
+}
+
+// MARK: - Raster cache
+
+SkRect sk_canvas_get_local_clip_bounds(SkCanvas *canvas)
+{
+    return canvas->getLocalClipBounds();
+}
+
+SkMatrix sk_canvas_get_total_matrix(SkCanvas *canvas)
+{
+    return canvas->getTotalMatrix();
+}
+
+void sk_canvas_concat_matrix(SkCanvas *canvas, const SkMatrix &matrix)
+{
+    canvas->concat(matrix);
+}
+
+SkSurface_sp sk_canvas_make_surface(SkCanvas *canvas, int width, int height)
+{
+    return canvas->makeSurface(canvas->imageInfo().makeWH(width, height));
+}
+
+SkImage_sp sk_surface_make_image_snapshot(SkSurface_sp &surface)
+{
+    return surface->makeImageSnapshot();
+}
+
+void sk_canvas_draw_image_untransformed(SkCanvas *canvas, SkImage_sp &image, float x, float y)
+{
+    canvas->save();
+    canvas->resetMatrix();
+    canvas->drawImage(image, x, y);
+    canvas->restore();
+}
+
+size_t sk_image_get_byte_size(SkImage_sp &image)
+{
+    return image->imageInfo().computeMinByteSize();
+}
+
 // MARK: - Paint
 
 void sk_paint_set_maskfilter_blur(SkPaint *paint, SkBlurStyle style, SkScalar sigma)
 {
     // Setting the mask filter involves sk_sp. To avoid memory leaks, we need to
     // do this in c rather than swift.
-    paint->setMaskFilter(SkMaskFilter::MakeBlur(style, sigma));
+    paint->setMaskFilter(interned_blur_mask_filter(style, sigma));
 }
 
 void sk_paint_clear_maskfilter(SkPaint *paint)
@@ -365,6 +773,21 @@ void sk_paint_clear_maskfilter(SkPaint *paint)
     paint->setMaskFilter(nullptr);
 }
 
+const void *sk_paint_get_maskfilter(const SkPaint &paint)
+{
+    return paint.getMaskFilter();
+}
+
+void sk_paint_set_colorfilter(SkPaint *paint, SkColorFilterKind kind, const uint32_t *values)
+{
+    paint->setColorFilter(make_color_filter(kind, values));
+}
+
+const void *sk_paint_get_colorfilter(const SkPaint &paint)
+{
+    return paint.getColorFilter();
+}
+
 // MARK: - Path
 
 void sk_path_move_to(SkPath *path, SkScalar x, SkScalar y)
@@ -382,17 +805,42 @@ void sk_path_reset(SkPath *path)
     path->reset();
 }
 
+SkRect sk_path_get_bounds(const SkPath &path)
+{
+    return path.getBounds();
+}
+
 // MARK: - Image
 
-SkAnimatedImage_sp sk_animated_image_create(const void *data, size_t length)
+SkAnimatedImage_sp sk_animated_image_create(const SkData_sp &data, int targetWidth, int targetHeight)
 {
-    auto bytes = SkData::MakeWithCopy(data, length);
-    auto aCodec = SkAndroidCodec::MakeFromData(std::move(bytes));
+    auto aCodec = SkAndroidCodec::MakeFromData(data);
     if (aCodec == nullptr)
     {
         return nullptr;
     }
-    return SkAnimatedImage::Make(std::move(aCodec));
+
+    // The codec decodes in the encoded orientation, while the target and
+    // the size passed to SkAnimatedImage are after applying the origin.
+    bool swapsWidthHeight = SkEncodedOriginSwapsWidthHeight(aCodec->codec()->getOrigin());
+    if (swapsWidthHeight)
+    {
+        std::swap(targetWidth, targetHeight);
+    }
+
+    auto info = aCodec->getInfo();
+    if (targetWidth > 0 && targetHeight > 0 && targetWidth < info.width() && targetHeight < info.height())
+    {
+        // The largest sample size that keeps both dimensions at or above the
+        // target. The codec picks the nearest size it can decode to natively.
+        int sampleSize = std::min(info.width() / targetWidth, info.height() / targetHeight);
+        info = info.makeDimensions(aCodec->getSampledDimensions(std::max(sampleSize, 1)));
+    }
+    if (swapsWidthHeight)
+    {
+        info = info.makeWH(info.height(), info.width());
+    }
+    return SkAnimatedImage::Make(std::move(aCodec), info, SkIRect::MakeSize(info.dimensions()), nullptr);
 }
 
 int sk_animated_image_get_frame_count(SkAnimatedImage_sp &image)
@@ -415,6 +863,103 @@ SkImage_sp sk_animated_image_get_current_frame(SkAnimatedImage_sp &image)
     return image->getCurrentFrame();
 }
 
+size_t sk_animated_image_get_byte_size(SkAnimatedImage_sp &image)
+{
+    auto frame = image->getCurrentFrame();
+    if (frame == nullptr)
+    {
+        return 0;
+    }
+    size_t frameBytes = frame->imageInfo().computeMinByteSize();
+    return image->getFrameCount() > 1 ? 2 * frameBytes : frameBytes;
+}
+
+namespace
+{
+    // Serves an image that was decoded into YUVA planes ahead of time, so
+    // that Ganesh can upload the planes without decoding on the raster
+    // thread. Raster canvases get RGBA pixels from the encoded data.
+    class YUVAPlanesGenerator : public SkImageGenerator
+    {
+    public:
+        YUVAPlanesGenerator(const SkImageInfo &info, SkYUVAPixmaps planes, sk_sp<SkData> data)
+            : SkImageGenerator(info), planes(std::move(planes)), data(std::move(data)) {}
+
+    protected:
+        sk_sp<SkData> onRefEncodedData() override
+        {
+            return data;
+        }
+
+        bool onGetPixels(const SkImageInfo &info, void *pixels, size_t rowBytes, const Options &) override
+        {
+            auto codec = SkCodec::MakeFromData(data);
+            return codec != nullptr && codec->getPixels(info, pixels, rowBytes) == SkCodec::kSuccess;
+        }
+
+        bool onQueryYUVAInfo(const SkYUVAPixmapInfo::SupportedDataTypes &supportedDataTypes,
+                             SkYUVAPixmapInfo *yuvaPixmapInfo) const override
+        {
+            if (!supportedDataTypes.supported(planes.yuvaInfo().planeConfig(), planes.dataType()))
+            {
+                return false;
+            }
+            *yuvaPixmapInfo = planes.pixmapsInfo();
+            return true;
+        }
+
+        bool onGetYUVAPlanes(const SkYUVAPixmaps &yuvaPixmaps) override
+        {
+            for (int i = 0; i < yuvaPixmaps.numPlanes(); ++i)
+            {
+                if (!planes.plane(i).readPixels(yuvaPixmaps.plane(i)))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        SkYUVAPixmaps planes;
+        sk_sp<SkData> data;
+    };
+} // namespace
+
+SkImage_sp sk_image_decode_yuva(const SkData_sp &data, int targetWidth, int targetHeight,
+                                size_t *byteSize)
+{
+    auto codec = SkCodec::MakeFromData(data);
+    // Rotated images are left to SkAnimatedImage, which applies the origin.
+    if (codec == nullptr || codec->getFrameCount() > 1 || codec->getOrigin() != kTopLeft_SkEncodedOrigin)
+    {
+        return nullptr;
+    }
+
+    // Planes are decoded at full size only. A sampled RGBA decode is smaller
+    // once it skips every other row and column.
+    auto info = codec->getInfo();
+    if (targetWidth > 0 && targetHeight > 0 && info.width() / targetWidth >= 2 && info.height() / targetHeight >= 2)
+    {
+        return nullptr;
+    }
+
+    SkYUVAPixmapInfo yuvaPixmapInfo;
+    if (!codec->queryYUVAInfo(SkYUVAPixmapInfo::SupportedDataTypes::All(), &yuvaPixmapInfo))
+    {
+        return nullptr;
+    }
+    auto planes = SkYUVAPixmaps::Allocate(yuvaPixmapInfo);
+    if (!planes.isValid() || codec->getYUVAPlanes(planes) != SkCodec::kSuccess)
+    {
+        return nullptr;
+    }
+
+    *byteSize = yuvaPixmapInfo.computeTotalBytes() + data->size();
+    return SkImages::DeferredFromGenerator(std::make_unique<YUVAPlanesGenerator>(
+        info.makeColorType(kN32_SkColorType), std::move(planes), data));
+}
+
 int sk_image_get_width(SkImage_sp &image)
 {
     return image->width();
@@ -447,6 +992,635 @@ void gr_direct_context_flush_and_submit(GrDirectContext_sp &context, GrSyncCpu s
     context->flushAndSubmit(syncCPU);
 }
 
+void gr_direct_context_flush_and_submit_async(GrDirectContext_sp &context, GrGpuFinishedProc finished, void *finishedContext)
+{
+    GrFlushInfo info;
+    info.fFinishedProc = finished;
+    info.fFinishedContext = finishedContext;
+    context->flush(info);
+    context->submit(GrSyncCpu::kNo);
+}
+
+void gr_direct_context_check_async_work_completion(GrDirectContext_sp &context)
+{
+    context->checkAsyncWorkCompletion();
+}
+
+SkSurface_sp gr_direct_context_make_render_target(GrDirectContext_sp &context, int width, int height)
+{
+    return SkSurfaces::RenderTarget(context.get(), skgpu::Budgeted::kNo,
+                                    SkImageInfo::MakeN32Premul(width, height));
+}
+
+void gr_direct_context_set_resource_cache_limit(GrDirectContext_sp &context, size_t maxResourceBytes)
+{
+    context->setResourceCacheLimit(maxResourceBytes);
+}
+
+size_t gr_direct_context_get_resource_cache_limit(GrDirectContext_sp &context)
+{
+    return context->getResourceCacheLimit();
+}
+
+void gr_direct_context_get_resource_cache_usage(GrDirectContext_sp &context, int *resourceCount, size_t *resourceBytes)
+{
+    context->getResourceCacheUsage(resourceCount, resourceBytes);
+}
+
+size_t gr_direct_context_get_resource_cache_purgeable_bytes(GrDirectContext_sp &context)
+{
+    return context->getResourceCachePurgeableBytes();
+}
+
+void gr_direct_context_purge_unlocked_resources(GrDirectContext_sp &context, bool scratchOnly)
+{
+    context->purgeUnlockedResources(scratchOnly ? GrPurgeResourceOptions::kScratchResourcesOnly
+                                                : GrPurgeResourceOptions::kAllResources);
+}
+
+void gr_direct_context_purge_resources_not_used_in_ms(GrDirectContext_sp &context, int64_t ms)
+{
+    context->performDeferredCleanup(std::chrono::milliseconds(ms));
+}
+
+void gr_direct_context_free_gpu_resources(GrDirectContext_sp &context)
+{
+    context->freeGpuResources();
+}
+
+// MARK: - Shader cache
+
+class SkiaShaderCache : public GrContextOptions::PersistentCache
+{
+public:
+    SkiaShaderCache(std::filesystem::path directory, size_t maxBytes)
+        : fDirectory(std::move(directory)), fMaxBytes(maxBytes)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(fDirectory, error);
+        for (auto &entry : std::filesystem::directory_iterator(fDirectory, error))
+        {
+            if (entry.path().extension() == ".shader")
+            {
+                fBytes += entry.file_size(error);
+            }
+        }
+    }
+
+    // Each file holds the size of the key, the key and the data. The key is
+    // compared on load, so that colliding hashes miss instead of returning
+    // the wrong program.
+    sk_sp<SkData> load(const SkData &key) override
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto path = pathForKey(key);
+        auto file = SkData::MakeFromFileName(path.c_str());
+        if (!file || file->size() < sizeof(uint32_t))
+        {
+            return nullptr;
+        }
+        uint32_t keySize;
+        memcpy(&keySize, file->data(), sizeof(keySize));
+        size_t dataOffset = sizeof(keySize) + keySize;
+        if (keySize != key.size() || file->size() < dataOffset ||
+            memcmp(file->bytes() + sizeof(keySize), key.data(), keySize) != 0)
+        {
+            return nullptr;
+        }
+
+        // The modification time orders entries for eviction.
+        std::error_code error;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+        return SkData::MakeSubset(file.get(), dataOffset, file->size() - dataOffset);
+    }
+
+    void store(const SkData &key, const SkData &data, const SkString &) override
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto path = pathForKey(key);
+        auto temporaryPath = path;
+        temporaryPath += ".tmp";
+
+        // Written to a temporary file first, so that a crash while writing
+        // never leaves a truncated entry behind.
+        FILE *file = fopen(temporaryPath.c_str(), "wb");
+        if (!file)
+        {
+            return;
+        }
+        uint32_t keySize = static_cast<uint32_t>(key.size());
+        bool written = fwrite(&keySize, sizeof(keySize), 1, file) == 1 &&
+                       fwrite(key.data(), 1, key.size(), file) == key.size() &&
+                       fwrite(data.data(), 1, data.size(), file) == data.size();
+        written = fclose(file) == 0 && written;
+
+        std::error_code error;
+        if (!written)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            return;
+        }
+        auto replacedSize = std::filesystem::file_size(path, error);
+        if (!error)
+        {
+            fBytes -= std::min<size_t>(fBytes, replacedSize);
+        }
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            return;
+        }
+        fBytes += sizeof(keySize) + key.size() + data.size();
+        evict();
+    }
+
+    int precompile(GrDirectContext *context)
+    {
+        std::vector<std::filesystem::path> paths;
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            std::error_code error;
+            for (auto &entry : std::filesystem::directory_iterator(fDirectory, error))
+            {
+                if (entry.path().extension() == ".shader")
+                {
+                    paths.push_back(entry.path());
+                }
+            }
+        }
+
+        int count = 0;
+        for (auto &path : paths)
+        {
+            auto file = SkData::MakeFromFileName(path.c_str());
+            if (!file || file->size() < sizeof(uint32_t))
+            {
+                continue;
+            }
+            uint32_t keySize;
+            memcpy(&keySize, file->data(), sizeof(keySize));
+            size_t dataOffset = sizeof(keySize) + keySize;
+            if (file->size() <= dataOffset)
+            {
+                continue;
+            }
+            auto key = SkData::MakeSubset(file.get(), sizeof(keySize), keySize);
+            auto data = SkData::MakeSubset(file.get(), dataOffset, file->size() - dataOffset);
+            if (context->precompileShader(*key, *data))
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+    // Removes the least recently used entries until the cache fits into
+    // fMaxBytes. Must be called with fMutex held.
+    void evict()
+    {
+        if (fBytes <= fMaxBytes)
+        {
+            return;
+        }
+
+        struct Entry
+        {
+            std::filesystem::path path;
+            std::filesystem::file_time_type time;
+            uintmax_t size;
+        };
+        std::vector<Entry> entries;
+        std::error_code error;
+        for (auto &entry : std::filesystem::directory_iterator(fDirectory, error))
+        {
+            if (entry.path().extension() == ".shader")
+            {
+                entries.push_back({entry.path(), entry.last_write_time(error), entry.file_size(error)});
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                  { return a.time < b.time; });
+
+        fBytes = 0;
+        for (auto &entry : entries)
+        {
+            fBytes += entry.size;
+        }
+        for (auto &entry : entries)
+        {
+            if (fBytes <= fMaxBytes)
+            {
+                break;
+            }
+            if (std::filesystem::remove(entry.path, error))
+            {
+                fBytes -= entry.size;
+            }
+        }
+    }
+
+    std::filesystem::path pathForKey(const SkData &key) const
+    {
+        auto hash = std::hash<std::string_view>()(
+            std::string_view(static_cast<const char *>(key.data()), key.size()));
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.shader", static_cast<unsigned long long>(hash));
+        return fDirectory / name;
+    }
+
+    std::filesystem::path fDirectory;
+    size_t fMaxBytes;
+    size_t fBytes = 0;
+    std::mutex fMutex;
+};
+
+SkiaShaderCache *sk_shader_cache_new(const char *directory, size_t maxBytes)
+{
+    return new SkiaShaderCache(std::filesystem::path(directory), maxBytes);
+}
+
+SkiaShaderCache *sk_shader_cache_new_gl(const char *directory, size_t maxBytes, GrGLInterface_sp &glInterface)
+{
+    std::string driver;
+    for (GrGLenum name : {0x1F00 /* GL_VENDOR */, 0x1F01 /* GL_RENDERER */, 0x1F02 /* GL_VERSION */})
+    {
+        auto value = glInterface->fFunctions.fGetString(name);
+        if (value)
+        {
+            driver += reinterpret_cast<const char *>(value);
+        }
+        driver += '\n';
+    }
+
+    char subdirectory[32];
+    snprintf(subdirectory, sizeof(subdirectory), "gl-%016llx",
+             static_cast<unsigned long long>(std::hash<std::string>()(driver)));
+    return new SkiaShaderCache(std::filesystem::path(directory) / subdirectory, maxBytes);
+}
+
+void sk_shader_cache_delete(SkiaShaderCache *cache)
+{
+    delete cache;
+}
+
+SkData_sp sk_shader_cache_load(SkiaShaderCache *cache, const SkData_sp &key)
+{
+    return cache->load(*key);
+}
+
+void sk_shader_cache_store(SkiaShaderCache *cache, const SkData_sp &key, const SkData_sp &data)
+{
+    cache->store(*key, *data, SkString());
+}
+
+GrDirectContext_sp gr_direct_context_make_gl_with_shader_cache(GrGLInterface_sp &glInterface, SkiaShaderCache *cache, bool cacheSkSL)
+{
+    GrContextOptions options;
+    options.fPersistentCache = cache;
+    options.fShaderCacheStrategy = cacheSkSL ? GrContextOptions::ShaderCacheStrategy::kSkSL
+                                             : GrContextOptions::ShaderCacheStrategy::kBackendBinary;
+    return GrDirectContexts::MakeGL(glInterface, options);
+}
+
+int sk_shader_cache_precompile(SkiaShaderCache *cache, GrDirectContext_sp &context)
+{
+    return cache->precompile(context.get());
+}
+
+// MARK: - Tracing
+
+namespace
+{
+    uint64_t trace_now_micros()
+    {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    }
+
+    // Matches Timeline.currentThreadID on the Swift side.
+    uint64_t trace_thread_id()
+    {
+#if defined(_WIN32)
+        return static_cast<uint64_t>(GetCurrentThreadId());
+#else
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(reinterpret_cast<void *>(pthread_self())));
+#endif
+    }
+
+    // Records Skia's trace events in memory. Skia caches the enabled flag of
+    // each category, so the flags are updated in place when recording starts
+    // or stops.
+    class ShaftEventTracer : public SkEventTracer
+    {
+    public:
+        const uint8_t *getCategoryGroupEnabled(const char *name) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &category = categories[name];
+            if (category.name.empty())
+            {
+                category.name = name;
+                category.flag = flagFor(category.name);
+            }
+            return &category.flag;
+        }
+
+        const char *getCategoryGroupName(const uint8_t *categoryEnabledFlag) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &entry : categories)
+            {
+                if (&entry.second.flag == categoryEnabledFlag)
+                {
+                    return entry.second.name.c_str();
+                }
+            }
+            return "unknown";
+        }
+
+        // Arguments of events are not recorded.
+        SkEventTracer::Handle addTraceEvent(char phase,
+                                            const uint8_t *categoryEnabledFlag,
+                                            const char *name,
+                                            uint64_t /* id */,
+                                            int32_t /* numArgs */,
+                                            const char ** /* argNames */,
+                                            const uint8_t * /* argTypes */,
+                                            const uint64_t * /* argValues */,
+                                            uint8_t /* flags */) override
+        {
+            if (!recording)
+            {
+                return 0;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            Event event;
+            event.name = name;
+            event.category = getCategoryGroupNameLocked(categoryEnabledFlag);
+            event.phase = phase;
+            event.threadID = trace_thread_id();
+            event.timestampMicros = trace_now_micros();
+            event.durationMicros = 0;
+            events.push_back(std::move(event));
+            // Handles are offset by one so that 0 means no event.
+            return firstHandle + events.size();
+        }
+
+        void updateTraceEventDuration(const uint8_t * /* categoryEnabledFlag */,
+                                      const char * /* name */,
+                                      SkEventTracer::Handle handle) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // Events drained in the meantime are lost.
+            if (handle <= firstHandle || handle > firstHandle + events.size())
+            {
+                return;
+            }
+            auto &event = events[handle - firstHandle - 1];
+            event.durationMicros = trace_now_micros() - event.timestampMicros;
+        }
+
+        void setRecording(bool value, bool includeDisabledByDefault)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            recording = value;
+            this->includeDisabledByDefault = includeDisabledByDefault;
+            for (auto &entry : categories)
+            {
+                entry.second.flag = flagFor(entry.second.name);
+            }
+        }
+
+        void drain(void *context, void (*callback)(void *context, const SkTraceEventRecord *event))
+        {
+            std::vector<Event> drained;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                drained.swap(events);
+                firstHandle += drained.size();
+            }
+            for (auto &event : drained)
+            {
+                SkTraceEventRecord record{
+                    event.name.c_str(),
+                    event.category.c_str(),
+                    event.phase,
+                    event.threadID,
+                    event.timestampMicros,
+                    event.durationMicros,
+                };
+                callback(context, &record);
+            }
+        }
+
+    private:
+        struct Category
+        {
+            std::string name;
+            uint8_t flag = 0;
+        };
+
+        struct Event
+        {
+            // Names are copied since Skia may pass temporary strings.
+            std::string name;
+            std::string category;
+            char phase;
+            uint64_t threadID;
+            uint64_t timestampMicros;
+            uint64_t durationMicros;
+        };
+
+        uint8_t flagFor(const std::string &name) const
+        {
+            if (!recording)
+            {
+                return 0;
+            }
+            if (!includeDisabledByDefault && name.rfind("disabled-by-default-", 0) == 0)
+            {
+                return 0;
+            }
+            return kEnabledForRecording_CategoryGroupEnabledFlags;
+        }
+
+        const char *getCategoryGroupNameLocked(const uint8_t *categoryEnabledFlag)
+        {
+            for (auto &entry : categories)
+            {
+                if (&entry.second.flag == categoryEnabledFlag)
+                {
+                    return entry.second.name.c_str();
+                }
+            }
+            return "unknown";
+        }
+
+        std::mutex mutex;
+        // Nodes of unordered_map keep their address, so the flags can be
+        // handed out to Skia.
+        std::unordered_map<std::string, Category> categories;
+        std::vector<Event> events;
+        // The number of events drained so far.
+        SkEventTracer::Handle firstHandle = 0;
+        std::atomic<bool> recording{false};
+        bool includeDisabledByDefault = false;
+    };
+
+    ShaftEventTracer *event_tracer = nullptr;
+}
+
+bool sk_trace_install()
+{
+    static std::once_flag once;
+    static bool installed = false;
+    std::call_once(once, []
+                   {
+        auto tracer = new ShaftEventTracer();
+        installed = SkEventTracer::SetInstance(tracer, true);
+        if (installed)
+        {
+            event_tracer = tracer;
+        } });
+    return installed;
+}
+
+void sk_trace_set_recording(bool recording, bool includeDisabledByDefault)
+{
+    if (event_tracer)
+    {
+        event_tracer->setRecording(recording, includeDisabledByDefault);
+    }
+}
+
+void sk_trace_drain(void *context, void (*callback)(void *context, const SkTraceEventRecord *event))
+{
+    if (event_tracer)
+    {
+        event_tracer->drain(context, callback);
+    }
+}
+
+uint64_t sk_trace_now_micros()
+{
+    return trace_now_micros();
+}
+
+// MARK: - Capture
+
+namespace
+{
+    sk_sp<SkData> serialize_typeface(SkTypeface *typeface, void *)
+    {
+        return typeface->serialize(SkTypeface::SerializeBehavior::kDoIncludeData);
+    }
+
+    sk_sp<SkData> serialize_image(SkImage *image, void *)
+    {
+        return SkPngEncoder::Encode(nullptr, image, {});
+    }
+
+    sk_sp<SkTypeface> deserialize_typeface(const void *data, size_t length, void *)
+    {
+        SkMemoryStream stream(data, length);
+        return SkTypeface::MakeDeserialize(&stream, fontMgr);
+    }
+
+    sk_sp<SkImage> deserialize_image(const void *data, size_t length, void *)
+    {
+        return SkImages::DeferredFromEncodedData(SkData::MakeWithCopy(data, length));
+    }
+
+    SkSerialProcs capture_serial_procs()
+    {
+        SkSerialProcs procs;
+        procs.fTypefaceProc = serialize_typeface;
+        procs.fImageProc = serialize_image;
+        return procs;
+    }
+
+    SkDeserialProcs capture_deserial_procs()
+    {
+        SkDeserialProcs procs;
+        procs.fTypefaceProc = deserialize_typeface;
+        procs.fImageProc = deserialize_image;
+        return procs;
+    }
+} // namespace
+
+const void *sk_data_get_bytes(const SkData_sp &data)
+{
+    return data->data();
+}
+
+size_t sk_data_get_size(const SkData_sp &data)
+{
+    return data->size();
+}
+
+SkData_sp sk_picture_serialize(const SkPicture_sp &picture)
+{
+    auto procs = capture_serial_procs();
+    return picture->serialize(&procs);
+}
+
+SkPicture_sp sk_picture_deserialize(const void *data, size_t length)
+{
+    auto procs = capture_deserial_procs();
+    return SkPicture::MakeFromData(data, length, &procs);
+}
+
+SkData_sp sk_text_blob_serialize(const SkTextBlob_sp &blob)
+{
+    return blob->serialize(capture_serial_procs());
+}
+
+SkTextBlob_sp sk_text_blob_deserialize(const void *data, size_t length)
+{
+    return SkTextBlob::Deserialize(data, length, capture_deserial_procs());
+}
+
+SkData_sp sk_path_serialize(const SkPath &path)
+{
+    return path.serialize();
+}
+
+bool sk_path_deserialize(SkPath *path, const void *data, size_t length)
+{
+    return path->readFromMemory(data, length) != 0;
+}
+
+SkData_sp sk_image_encode_png(SkImage_sp &image)
+{
+    if (image->isTextureBacked())
+    {
+        return nullptr;
+    }
+    return SkPngEncoder::Encode(nullptr, image.get(), {});
+}
+
+SkImage_sp sk_image_decode(const void *data, size_t length)
+{
+    auto image = SkImages::DeferredFromEncodedData(SkData::MakeWithCopy(data, length));
+    return image ? image->makeRasterImage() : nullptr;
+}
+
+SkImage_sp sk_image_make_transparent(int width, int height)
+{
+    // Alpha-only pixels are zeroed, which is transparent, and take a quarter
+    // of the memory of N32 pixels.
+    SkBitmap bitmap;
+    if (!bitmap.tryAllocPixels(SkImageInfo::MakeA8(std::max(width, 1), std::max(height, 1))))
+    {
+        return nullptr;
+    }
+    bitmap.eraseColor(SK_ColorTRANSPARENT);
+    bitmap.setImmutable();
+    return bitmap.asImage();
+}
+
 // MARK: - Metal
 
 #if defined(SK_BUILD_FOR_MAC)
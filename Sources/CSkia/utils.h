@@ -11,8 +11,10 @@
 #include "include/codec/SkPngDecoder.h"
 #include "include/codec/SkWbmpDecoder.h"
 #include "include/codec/SkWebpDecoder.h"
+#include "include/core/SkBBHFactory.h"
 #include "include/core/SkBlurTypes.h"
 #include "include/core/SkCanvas.h"
+#include "include/core/SkColorFilter.h"
 #include "include/core/SkColorSpace.h"
 #include "include/core/SkRefCnt.h"
 #include "include/core/SkData.h"
@@ -22,6 +24,8 @@
 #include "include/core/SkMaskFilter.h"
 #include "include/core/SkPath.h"
 #include "include/core/SkPathUtils.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPictureRecorder.h"
 #include "include/core/SkPoint3.h"
 #include "include/core/SkRRect.h"
 #include "include/core/SkStream.h"
@@ -107,6 +111,8 @@ typedef sk_sp<FontCollection> FontCollection_sp;
 typedef sk_sp<ParagraphBuilder> ParagraphBuilder_sp;
 typedef sk_sp<SkTypeface> SkTypeface_sp;
 typedef sk_sp<SkTextBlob> SkTextBlob_sp;
+typedef sk_sp<SkPicture> SkPicture_sp;
+typedef sk_sp<SkData> SkData_sp;
 
 // FontCollection_sp test_font_collection();
 
@@ -136,11 +142,24 @@ bool paragraph_get_glyph_info_at(Paragraph *paragraph, size_t codeUnitIndex, Par
 Paragraph::GlyphInfo paragraph_get_closest_glyph_info_at(Paragraph *paragraph, SkScalar dx, SkScalar dy);
 void paragraph_unref(Paragraph *paragraph);
 
+// MARK: - Data
+
+typedef void (*sk_data_release_proc)(const void *data, void *context);
+
+// Wraps memory owned by the caller without copying it. `release` is called
+// with `context` once Skia no longer references the memory, which may be on
+// any thread.
+SkData_sp sk_data_new_with_proc(const void *data, size_t length, sk_data_release_proc release, void *context);
+
+// Maps the file at `path` into memory. Returns null if the file can't be
+// opened.
+SkData_sp sk_data_new_from_file(const char *path);
+
 // MARK: - Font
 
 FontCollection_sp sk_fontcollection_new();
 void sk_fontcollection_register_typeface(FontCollection_sp &collection, SkTypeface_sp &typeface);
-SkTypeface_sp sk_typeface_create_from_data(const FontCollection_sp &collection, const char *data, size_t length);
+SkTypeface_sp sk_typeface_create_from_data(const FontCollection_sp &collection, const SkData_sp &data);
 std::vector<SkTypeface_sp> sk_fontcollection_find_typefaces(const FontCollection_sp &collection, const std::vector<SkString> &families, SkFontStyle style);
 SkTypeface_sp sk_fontcollection_default_fallback(const FontCollection_sp &collection, SkUnichar unicode, SkFontStyle style, const SkString &locale);
 std::vector<SkGlyphID> sk_typeface_get_glyphs(SkTypeface_sp &typeface, const SkUnichar *text, size_t length);
@@ -179,29 +198,169 @@ void sk_canvas_translate(SkCanvas *canvas, float dx, float dy);
 void sk_canvas_scale(SkCanvas *canvas, float sx, float sy);
 void sk_canvas_rotate(SkCanvas *canvas, float radians);
 
+// MARK: - Effect cache
+
+// Drops all interned effects. Effects still referenced by paints stay alive.
+void sk_effect_cache_purge();
+
+// MARK: - Replay
+
+// Tags of the ops understood by sk_canvas_replay. An op stream is a sequence
+// of 32-bit words: a tag followed by the op's payload. Floats are stored by
+// their bit pattern. Rects are 4 floats (LTRB), rrects are a rect followed by
+// 8 radii floats (TL, TR, BR, BL as x/y pairs), and matrices are 16 floats in
+// row-major order.
+enum class SkReplayOp : uint32_t
+{
+    // antiAlias, color, blendMode, style, strokeWidth, strokeCap, strokeJoin,
+    // strokeMiter, blurStyle (kNoBlur for none), blurSigma, color filter kind,
+    // color filter values (see SkColorFilterKind)
+    kSetPaint,
+    // x0, y0, x1, y1
+    kDrawLine,
+    // rect
+    kDrawRect,
+    // rrect
+    kDrawRRect,
+    // outer rrect, inner rrect
+    kDrawDRRect,
+    // x, y, radius
+    kDrawCircle,
+    kSave,
+    // rect, hasPaint
+    kSaveLayer,
+    kRestore,
+    // dx, dy
+    kTranslate,
+    // sx, sy
+    kScale,
+    // degrees
+    kRotate,
+    // matrix
+    kConcat,
+    // rect, clipOp, doAntiAlias
+    kClipRect,
+    // rrect, clipOp, doAntiAlias
+    kClipRRect,
+    // color
+    kClear,
+};
+
+// Replays the given op stream onto the canvas in a single call. Draw ops use
+// the paint set by the last kSetPaint op in the same stream.
+void sk_canvas_replay(SkCanvas *canvas, const uint32_t *ops, size_t count);
+
+// MARK: - Picture
+
+SkPictureRecorder *sk_picture_recorder_new();
+void sk_picture_recorder_delete(SkPictureRecorder *recorder);
+
+// Starts recording and returns the canvas to draw into. The canvas is owned
+// by the recorder and is valid until sk_picture_recorder_finish is called.
+// The recorded picture has an R-tree so that playback skips ops outside of
+// the clip.
+SkCanvas *sk_picture_recorder_begin(SkPictureRecorder *recorder, const SkRect &bounds);
+SkPicture_sp sk_picture_recorder_finish(SkPictureRecorder *recorder);
+
+void sk_canvas_draw_picture(SkCanvas *canvas, const SkPicture_sp &picture);
+size_t sk_picture_approximate_bytes_used(const SkPicture_sp &picture);
+uint32_t sk_picture_unique_id(const SkPicture_sp &picture);
+
+// Returns the bounds of the current clip in the local coordinates of the
+// canvas, outset by one pixel for antialiasing.
+SkRect sk_canvas_get_local_clip_bounds(SkCanvas *canvas);
+
+// MARK: - Raster cache
+
+SkMatrix sk_canvas_get_total_matrix(SkCanvas *canvas);
+void sk_canvas_concat_matrix(SkCanvas *canvas, const SkMatrix &matrix);
+
+// Creates a surface of the given size that is compatible with the canvas,
+// e.g. a GPU surface in the same context if the canvas is GPU backed.
+SkSurface_sp sk_canvas_make_surface(SkCanvas *canvas, int width, int height);
+SkImage_sp sk_surface_make_image_snapshot(SkSurface_sp &surface);
+
+// Draws the image at the given position in device space, ignoring the
+// current matrix of the canvas. The clip still applies.
+void sk_canvas_draw_image_untransformed(SkCanvas *canvas, SkImage_sp &image, float x, float y);
+size_t sk_image_get_byte_size(SkImage_sp &image);
+
 // MARK: - Paint
 
+// Uses a blur mask filter shared with all paints blurred with the same style
+// and sigma.
 void sk_paint_set_maskfilter_blur(SkPaint *paint, SkBlurStyle style, SkScalar sigma);
 void sk_paint_clear_maskfilter(SkPaint *paint);
 
+// Returns the mask filter of the paint, or null if it has none. Paints blurred
+// with the same style and sigma return the same filter.
+const void *sk_paint_get_maskfilter(const SkPaint &paint);
+
+// Kinds of color filters understood by sk_paint_set_colorfilter and replay op
+// streams. Each kind is followed by its values.
+enum class SkColorFilterKind : uint32_t
+{
+    kNoFilter,
+    // color, blendMode
+    kBlend,
+    // 20 floats of a row-major 5x4 matrix with offsets in the range 0..1
+    kMatrix,
+    kLinearToSrgbGamma,
+    kSrgbToLinearGamma,
+};
+
+// Sets the color filter of the paint. `values` holds the values of the kind
+// as 32-bit words and may be null for kinds without values.
+void sk_paint_set_colorfilter(SkPaint *paint, SkColorFilterKind kind, const uint32_t *values);
+
+// Returns the color filter of the paint, or null if it has none.
+const void *sk_paint_get_colorfilter(const SkPaint &paint);
+
 // MARK: - Path
 
 void sk_path_move_to(SkPath *path, SkScalar x, SkScalar y);
 void sk_path_line_to(SkPath *path, SkScalar x, SkScalar y);
 void sk_path_reset(SkPath *path);
+SkRect sk_path_get_bounds(const SkPath &path);
 
 // MARK: - Surface
 
 SkCanvas *sk_surface_get_canvas(const sk_sp<SkSurface> &surface);
+SkSurface_sp sk_surface_make_raster(int width, int height);
+bool sk_surface_peek_pixels(const SkSurface_sp &surface, SkPixmap *pixmap);
+
+// Copies the content of the surface to the origin of the canvas, replacing
+// the pixels underneath.
+void sk_surface_draw_replacing(SkSurface_sp &surface, SkCanvas *canvas);
 
 // MARK: - Image
 
-SkAnimatedImage_sp sk_animated_image_create(const void *data, size_t length);
+// Decodes at the smallest size the codec can sample to that still covers
+// `targetWidth` x `targetHeight` pixels, which for JPEG skips most of the
+// decode work. Images smaller than the target, or a target of 0 x 0, are
+// decoded at full size. The image keeps a reference to `data`.
+SkAnimatedImage_sp sk_animated_image_create(const SkData_sp &data, int targetWidth, int targetHeight);
 int sk_animated_image_get_frame_count(SkAnimatedImage_sp &image);
 int sk_animated_image_get_repetition_count(SkAnimatedImage_sp &image);
 int sk_animated_image_decode_next_frame(SkAnimatedImage_sp &image);
 SkImage_sp sk_animated_image_get_current_frame(SkAnimatedImage_sp &image);
 
+// The memory used by the decoded frames of `image`. Animations keep the frame
+// being displayed and the one being decoded. The frame some GIFs restore to
+// is allocated only once a frame needs it, and not counted.
+size_t sk_animated_image_get_byte_size(SkAnimatedImage_sp &image);
+
+// Decodes a still image, such as a JPEG, into its Y, U, V (and A) planes
+// instead of RGBA. The returned image is lazy: GPU canvases upload the planes
+// as separate textures and convert them to RGB in a shader, and raster
+// canvases decode `data` to RGBA when drawn. Returns null if the codec can't
+// decode to planes, or if it could decode to fewer pixels than the planes
+// hold by sampling down towards `targetWidth` x `targetHeight`. On success,
+// `byteSize` is set to the memory retained by the image: the planes and
+// `data`, which is kept to decode to RGBA.
+SkImage_sp sk_image_decode_yuva(const SkData_sp &data, int targetWidth, int targetHeight,
+                                size_t *byteSize);
+
 int sk_image_get_width(sk_sp<SkImage> &image);
 int sk_image_get_height(SkImage_sp &image);
 
@@ -212,6 +371,117 @@ GrDirectContext_sp gr_direct_context_make_gl(GrGLInterface_sp &glInterface);
 const GrDirectContext *gr_direct_context_unwrap(GrDirectContext_sp &context);
 void gr_direct_context_flush_and_submit(GrDirectContext_sp &context, GrSyncCpu syncCPU);
 
+// Flushes and submits pending work without waiting for the GPU. `finished`
+// is called with `finishedContext` once the GPU has completed the work. It is
+// called from a later flush, submit or
+// gr_direct_context_check_async_work_completion on the same context.
+void gr_direct_context_flush_and_submit_async(GrDirectContext_sp &context, GrGpuFinishedProc finished, void *finishedContext);
+void gr_direct_context_check_async_work_completion(GrDirectContext_sp &context);
+
+// Creates an offscreen surface on the GPU of `context`.
+SkSurface_sp gr_direct_context_make_render_target(GrDirectContext_sp &context, int width, int height);
+
+// Resource cache of a GPU context. Purging only releases resources that are
+// not used by pending work. `scratchOnly` keeps resources with content that
+// can't be recreated cheaply, such as uploaded images.
+void gr_direct_context_set_resource_cache_limit(GrDirectContext_sp &context, size_t maxResourceBytes);
+size_t gr_direct_context_get_resource_cache_limit(GrDirectContext_sp &context);
+void gr_direct_context_get_resource_cache_usage(GrDirectContext_sp &context, int *resourceCount, size_t *resourceBytes);
+size_t gr_direct_context_get_resource_cache_purgeable_bytes(GrDirectContext_sp &context);
+void gr_direct_context_purge_unlocked_resources(GrDirectContext_sp &context, bool scratchOnly);
+void gr_direct_context_purge_resources_not_used_in_ms(GrDirectContext_sp &context, int64_t ms);
+void gr_direct_context_free_gpu_resources(GrDirectContext_sp &context);
+
+// MARK: - Shader cache
+
+// A GrContextOptions::PersistentCache that stores every entry in its own file
+// under `directory`. Entries of different GPU drivers are kept apart in
+// subdirectories named after a hash of the vendor, renderer and version
+// strings reported by `glInterface`, because program binaries of one driver
+// are rejected by others. When the entries exceed `maxBytes`, the least
+// recently used ones are deleted. The cache must outlive the contexts using
+// it.
+class SkiaShaderCache;
+
+SkiaShaderCache *sk_shader_cache_new_gl(const char *directory, size_t maxBytes, GrGLInterface_sp &glInterface);
+void sk_shader_cache_delete(SkiaShaderCache *cache);
+
+// Creates a cache that stores its entries directly in `directory`, and
+// accesses it the way a GrDirectContext does. Used by tests.
+SkiaShaderCache *sk_shader_cache_new(const char *directory, size_t maxBytes);
+SkData_sp sk_shader_cache_load(SkiaShaderCache *cache, const SkData_sp &key);
+void sk_shader_cache_store(SkiaShaderCache *cache, const SkData_sp &key, const SkData_sp &data);
+
+// Creates a GL context that loads and stores compiled shaders in `cache`. If
+// `cacheSkSL` is true, the cache stores SkSL that can be compiled ahead of
+// time with sk_shader_cache_precompile, otherwise it stores program binaries.
+GrDirectContext_sp gr_direct_context_make_gl_with_shader_cache(GrGLInterface_sp &glInterface, SkiaShaderCache *cache, bool cacheSkSL);
+
+// Compiles the SkSL entries of `cache` with `context`. Returns the number of
+// shaders compiled. Entries that are not SkSL are skipped.
+int sk_shader_cache_precompile(SkiaShaderCache *cache, GrDirectContext_sp &context);
+
+// MARK: - Tracing
+
+// A trace event recorded from Skia. `name` and `category` stay valid until the
+// next sk_trace_drain. Timestamps are microseconds of the monotonic clock
+// (std::chrono::steady_clock).
+struct SkTraceEventRecord
+{
+    const char *name;
+    const char *category;
+    // Chrome trace event phase, such as 'X' for a complete event or 'I' for an
+    // instant event.
+    char phase;
+    uint64_t threadID;
+    uint64_t timestampMicros;
+    uint64_t durationMicros;
+};
+
+// Installs an SkEventTracer that records the trace events emitted by Skia
+// while recording is enabled. Returns false if Skia already uses another
+// tracer, which happens when tracing was used before this call.
+bool sk_trace_install();
+
+// Starts or stops recording events. Categories starting with
+// "disabled-by-default-" are only recorded if `includeDisabledByDefault` is
+// true.
+void sk_trace_set_recording(bool recording, bool includeDisabledByDefault);
+
+// Calls `callback` with every event recorded since the last drain, in the
+// order they started, and clears them.
+void sk_trace_drain(void *context, void (*callback)(void *context, const SkTraceEventRecord *event));
+
+// The current time on the clock used for trace events.
+uint64_t sk_trace_now_micros();
+
+// MARK: - Capture
+
+// Serialization of resources for frame captures. Fonts are embedded and
+// images are encoded as PNG, so that the data can be decoded on another
+// machine. Decoding functions return null or false for invalid data.
+
+const void *sk_data_get_bytes(const SkData_sp &data);
+size_t sk_data_get_size(const SkData_sp &data);
+
+SkData_sp sk_picture_serialize(const SkPicture_sp &picture);
+SkPicture_sp sk_picture_deserialize(const void *data, size_t length);
+
+SkData_sp sk_text_blob_serialize(const SkTextBlob_sp &blob);
+SkTextBlob_sp sk_text_blob_deserialize(const void *data, size_t length);
+
+SkData_sp sk_path_serialize(const SkPath &path);
+bool sk_path_deserialize(SkPath *path, const void *data, size_t length);
+
+// Encodes the pixels of a raster or lazily decoded image. Returns null for
+// images that live on the GPU.
+SkData_sp sk_image_encode_png(SkImage_sp &image);
+SkImage_sp sk_image_decode(const void *data, size_t length);
+
+// A fully transparent image that stands in for an image that could not be
+// encoded, such as a texture-backed one.
+SkImage_sp sk_image_make_transparent(int width, int height);
+
 // MARK: - Metal
 
 #if defined(SK_BUILD_FOR_MAC)
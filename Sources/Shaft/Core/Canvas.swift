@@ -18,6 +18,57 @@ public protocol DirectCanvas: Canvas {
 
     /// Submits painting commands to the underlying graphics API.
     func flush()
+
+    /// The cache used to draw unchanged layers painted on this canvas as
+    /// snapshots, or nil if the canvas doesn't support raster caching.
+    var rasterCache: LayerRasterCache? { get }
+
+    /// Whether the content of the canvas is kept from one frame to the next.
+    /// If true, only the area damaged since the previous frame needs to be
+    /// repainted. See ``DamageTracker``.
+    var preservesContents: Bool { get }
+}
+
+extension DirectCanvas {
+    public var rasterCache: LayerRasterCache? { nil }
+
+    public var preservesContents: Bool { false }
+}
+
+/// A direct canvas that draws into pixels living in CPU memory. The pixels can
+/// be read back after ``DirectCanvas/flush()`` without copying.
+public protocol RasterCanvas: DirectCanvas {
+    /// Calls `body` with the pixels of this canvas. The pixels are only valid
+    /// during the call and must not be accessed while the canvas is being
+    /// painted.
+    func withPixels<R>(_ body: (RasterPixels) throws -> R) rethrows -> R
+}
+
+/// A read-only view of the pixels of a ``RasterCanvas``.
+///
+/// Pixels are stored row by row as 8-bit RGBA with premultiplied alpha. Rows
+/// may be padded, so use ``rowBytes`` rather than the width to step between
+/// rows.
+public struct RasterPixels {
+    public init(baseAddress: UnsafeRawPointer, rowBytes: Int, size: ISize) {
+        self.baseAddress = baseAddress
+        self.rowBytes = rowBytes
+        self.size = size
+    }
+
+    /// The address of the first pixel of the first row.
+    public let baseAddress: UnsafeRawPointer
+
+    /// The number of bytes from the start of one row to the start of the next.
+    public let rowBytes: Int
+
+    /// The size of the pixel buffer in pixels.
+    public let size: ISize
+
+    /// All bytes of the pixel buffer, including row padding.
+    public var bytes: UnsafeRawBufferPointer {
+        UnsafeRawBufferPointer(start: baseAddress, count: rowBytes * size.height)
+    }
 }
 
 extension Canvas {
@@ -3,69 +3,399 @@
 // found in the LICENSE file.
 
 import Foundation
+import SwiftMath
 
+/// An immutable recording of drawing operations.
+///
+/// Operations are encoded into a single contiguous byte buffer. Each op starts
+/// with a one-byte ``DisplayListOpType`` tag followed by a fixed-size payload
+/// of plain values (rects, offsets, floats). Values that can't be stored as
+/// bytes, such as paragraphs or images, live in typed side tables and are
+/// referenced from the payload by index. Paints are deduplicated so that ops
+/// drawn with the same paint share a single entry.
 public struct DisplayList {
-    var buffer: [DisplayListOp]
+    /// The encoded operations.
+    let storage: [UInt8]
+
+    /// Unique paints referenced by the encoded operations.
+    let paints: [Paint]
+
+    var paragraphs: [Paragraph]
+
+    let textBlobs: [TextBlob]
+
+    let paths: [Path]
+
+    let images: [NativeImage]
+
+    var displayLists: [DisplayList]
+
+    /// The number of operations recorded in this display list.
+    public let opCount: Int
+
+    /// An identifier that is unique to this recording. Every call to
+    /// ``DisplayListBuilder/build()`` produces a new identifier, so renderers
+    /// can use it as a key to cache resources derived from the display list.
+    public let uniqueID: UInt64
+
+    /// The byte offset of each op in ``storage``.
+    let opOffsets: [UInt32]
+
+    /// The area each op draws in the coordinate system of the display list.
+    let opBounds: [Rect]
+
+    /// Indices of ops that don't draw but change the state of the canvas,
+    /// such as transforms and clips. These are replayed even when culling.
+    let stateOps: [Int]
+
+    /// Whether drawing every operation with an opacity gives the same result
+    /// as drawing the display list into a layer and compositing the layer
+    /// with that opacity. This is the case when no two drawing operations
+    /// overlap and every operation draws with a source-over paint whose
+    /// alpha can be modulated.
+    public let canApplyGroupOpacity: Bool
+
+    /// Whether adding a color filter to the paint of every operation gives
+    /// the same result as applying the color filter to the display list as a
+    /// whole. Implies ``canApplyGroupOpacity`` and additionally requires
+    /// that no operation already has a color filter.
+    public let canApplyGroupColorFilter: Bool
+
+    /// The area covered by all drawing operations, or nil if some operation
+    /// draws an unknown area that isn't limited by a clip.
+    public let bounds: Rect?
+
+    /// A spatial index over ``opBounds`` of drawing ops. Only built for
+    /// display lists with many ops.
+    let rtree: DlRTree?
+
+    /// Whether this display list contains no operations.
+    public var isEmpty: Bool { opCount == 0 }
+
+    /// The size of the encoded operations in bytes, excluding side tables.
+    public var byteCount: Int { storage.count }
+
+    /// Returns a copy of this display list whose paragraphs, including those
+    /// of nested display lists, are replaced by their
+    /// ``Paragraph/snapshot()``. The copy keeps the ``uniqueID`` so that
+    /// resources cached for this display list are reused.
+    public func snapshot() -> DisplayList {
+        if paragraphs.isEmpty && displayLists.isEmpty {
+            return self
+        }
+        var copy = self
+        copy.paragraphs = paragraphs.map { $0.snapshot() }
+        copy.displayLists = displayLists.map { $0.snapshot() }
+        return copy
+    }
 
     /// Replay recorded operations to the given receiver.
     public func dispatch(to receiver: DlOpReceiver) {
-        for op in buffer {
-            switch op {
-            case let .drawRect(rect, paint):
-                receiver.drawRect(rect, paint)
-            case let .drawLine(p0, p1, paint):
-                receiver.drawLine(p0, p1, paint)
-            case let .drawDisplayList(displayList):
-                receiver.drawDisplayList(displayList)
-            case let .drawParagraph(paragraph, offset):
-                receiver.drawParagraph(paragraph, offset)
-            case let .drawTextBlob(textBlob, offset, paint):
-                receiver.drawTextBlob(textBlob, offset, paint)
-            case let .transform(transform):
-                receiver.transform(transform)
-            case let .drawRRect(rrect, paint):
-                receiver.drawRRect(rrect, paint)
-            case let .drawDRRect(outer, inner, paint):
-                receiver.drawDRRect(outer, inner, paint)
-            case let .drawCircle(center, radius, paint):
-                receiver.drawCircle(center, radius, paint)
-            case let .drawPath(path, paint):
-                receiver.drawPath(path, paint)
-            case let .drawImage(image, offset, paint):
-                receiver.drawImage(image, offset, paint)
-            case let .drawImageRect(image, src, dst, paint):
-                receiver.drawImageRect(image, src, dst, paint)
-            case let .drawImageNine(image, center, dst, paint):
-                receiver.drawImageNine(image, center, dst, paint)
-            case let .clipRect(rect: rect, clipOp: clipOp, doAntiAlias: doAntiAlias):
-                receiver.clipRect(rect, clipOp, doAntiAlias)
-            case let .clipRRect(rrect, doAntiAlias):
-                receiver.clipRRect(rrect, doAntiAlias)
-            case let .translate(dx, dy):
-                receiver.translate(dx, dy)
-            case let .scale(sx, sy):
-                receiver.scale(sx, sy)
-            case let .rotate(radians):
-                receiver.rotate(radians)
-            case .save:
-                receiver.save()
-            case let .saveLayer(bounds, paint):
-                receiver.saveLayer(bounds, paint: paint)
-            case .restore:
-                receiver.restore()
-            case let .clear(color):
-                receiver.clear(color: color)
+        storage.withUnsafeBytes { bytes in
+            var reader = DisplayListReader(bytes)
+            while !reader.isAtEnd {
+                dispatchOne(&reader, to: receiver)
             }
         }
     }
 
-    // private func peek<T>(_: T.Type, offset: Int) -> T {
-    //     storage.withUnsafeBytes { $0.load(fromByteOffset: offset, as: T.self) }
-    // }
+    /// Replay recorded operations to the given receiver, skipping drawing
+    /// operations that fall completely outside of `cullRect`, given in the
+    /// coordinate system of the display list. Operations that change the
+    /// state of the canvas are always replayed.
+    public func dispatch(to receiver: DlOpReceiver, cullRect: Rect) {
+        if let bounds, cullRect.contains(bounds) {
+            dispatch(to: receiver)
+            return
+        }
+
+        let visibleOps = visibleOps(in: cullRect)
+        storage.withUnsafeBytes { bytes in
+            var reader = DisplayListReader(bytes)
+            for index in visibleOps {
+                reader.seek(to: Int(opOffsets[index]))
+                dispatchOne(&reader, to: receiver)
+            }
+        }
+    }
+
+    /// Returns the indices of the ops to replay for `cullRect` in recording
+    /// order.
+    internal func visibleOps(in cullRect: Rect) -> [Int] {
+        guard let rtree else {
+            return (0..<opCount).filter { index in
+                opBounds[index].intersects(cullRect)
+            }
+        }
+
+        // Merge the drawing ops found in the index with the state ops, both of
+        // which are sorted.
+        let drawOps = rtree.search(cullRect)
+        var result: [Int] = []
+        result.reserveCapacity(drawOps.count + stateOps.count)
+        var i = 0
+        var j = 0
+        while i < drawOps.count || j < stateOps.count {
+            if j == stateOps.count || (i < drawOps.count && drawOps[i] < stateOps[j]) {
+                result.append(drawOps[i])
+                i += 1
+            } else {
+                result.append(stateOps[j])
+                j += 1
+            }
+        }
+        return result
+    }
+
+    /// Decodes the op at the current position of `reader` and sends it to
+    /// `receiver`.
+    private func dispatchOne(_ reader: inout DisplayListReader, to receiver: DlOpReceiver) {
+        switch reader.readOpType() {
+        case .drawRect:
+            let rect = reader.read(Rect.self)
+            receiver.drawRect(rect, paints[reader.readIndex()])
+        case .drawLine:
+            let p0 = reader.read(Offset.self)
+            let p1 = reader.read(Offset.self)
+            receiver.drawLine(p0, p1, paints[reader.readIndex()])
+        case .drawDisplayList:
+            receiver.drawDisplayList(displayLists[reader.readIndex()])
+        case .drawParagraph:
+            let paragraph = paragraphs[reader.readIndex()]
+            receiver.drawParagraph(paragraph, reader.read(Offset.self))
+        case .drawTextBlob:
+            let textBlob = textBlobs[reader.readIndex()]
+            let offset = reader.read(Offset.self)
+            receiver.drawTextBlob(textBlob, offset, paints[reader.readIndex()])
+        case .drawRRect:
+            let rrect = reader.read(RRect.self)
+            receiver.drawRRect(rrect, paints[reader.readIndex()])
+        case .drawDRRect:
+            let outer = reader.read(RRect.self)
+            let inner = reader.read(RRect.self)
+            receiver.drawDRRect(outer, inner, paints[reader.readIndex()])
+        case .drawCircle:
+            let center = reader.read(Offset.self)
+            let radius = reader.read(Float.self)
+            receiver.drawCircle(center, radius, paints[reader.readIndex()])
+        case .drawPath:
+            let path = paths[reader.readIndex()]
+            receiver.drawPath(path, paints[reader.readIndex()])
+        case .drawImage:
+            let image = images[reader.readIndex()]
+            let offset = reader.read(Offset.self)
+            receiver.drawImage(image, offset, paints[reader.readIndex()])
+        case .drawImageRect:
+            let image = images[reader.readIndex()]
+            let src = reader.read(Rect.self)
+            let dst = reader.read(Rect.self)
+            receiver.drawImageRect(image, src, dst, paints[reader.readIndex()])
+        case .drawImageNine:
+            let image = images[reader.readIndex()]
+            let center = reader.read(Rect.self)
+            let dst = reader.read(Rect.self)
+            receiver.drawImageNine(image, center, dst, paints[reader.readIndex()])
+        case .transform:
+            receiver.transform(reader.read(Matrix4x4f.self))
+        case .transform2D:
+            receiver.transform(reader.read(DlAffineTransform.self).matrix)
+        case .translate:
+            let dx = reader.read(Float.self)
+            receiver.translate(dx, reader.read(Float.self))
+        case .scale:
+            let sx = reader.read(Float.self)
+            receiver.scale(sx, reader.read(Float.self))
+        case .rotate:
+            receiver.rotate(reader.read(Float.self))
+        case .clipRect:
+            let rect = reader.read(Rect.self)
+            let clipOp = reader.readClipOp()
+            receiver.clipRect(rect, clipOp, reader.readBool())
+        case .clipRRect:
+            let rrect = reader.read(RRect.self)
+            receiver.clipRRect(rrect, reader.readBool())
+        case .save:
+            receiver.save()
+        case .saveLayer:
+            let bounds = reader.read(Rect.self)
+            let paintIndex = reader.read(UInt32.self)
+            receiver.saveLayer(
+                bounds,
+                paint: paintIndex == DisplayListReader.noIndex ? nil : paints[Int(paintIndex)]
+            )
+        case .restore:
+            receiver.restore()
+        case .clear:
+            receiver.clear(color: Color(reader.read(UInt32.self)))
+        }
+    }
+}
+
+/// The tag written in front of every op in the storage of a ``DisplayList``.
+///
+/// The payload that follows each tag is documented on the case. `paint`,
+/// `paragraph`, `textBlob`, `path`, `image` and `displayList` are `UInt32`
+/// indices into the side tables of the display list. Bools and ``ClipOp``s
+/// are stored as a single byte.
+internal enum DisplayListOpType: UInt8 {
+    /// rect: Rect, paint
+    case drawRect
+
+    /// p0: Offset, p1: Offset, paint
+    case drawLine
+
+    /// displayList
+    case drawDisplayList
+
+    /// paragraph, offset: Offset
+    case drawParagraph
+
+    /// textBlob, offset: Offset, paint
+    case drawTextBlob
+
+    /// rrect: RRect, paint
+    case drawRRect
+
+    /// outer: RRect, inner: RRect, paint
+    case drawDRRect
+
+    /// center: Offset, radius: Float, paint
+    case drawCircle
+
+    /// path, paint
+    case drawPath
+
+    /// image, offset: Offset, paint
+    case drawImage
+
+    /// image, src: Rect, dst: Rect, paint
+    case drawImageRect
+
+    /// image, center: Rect, dst: Rect, paint
+    case drawImageNine
+
+    /// transform: Matrix4x4f
+    case transform
+
+    /// transform: DlAffineTransform. Used instead of ``transform`` when the
+    /// matrix has no perspective or z component.
+    case transform2D
+
+    /// dx: Float, dy: Float
+    case translate
+
+    /// sx: Float, sy: Float
+    case scale
+
+    /// radians: Float
+    case rotate
+
+    /// rect: Rect, clipOp, doAntiAlias
+    case clipRect
+
+    /// rrect: RRect, doAntiAlias
+    case clipRRect
+
+    /// (no payload)
+    case save
+
+    /// bounds: Rect, paint or ``DisplayListReader/noIndex``
+    case saveLayer
+
+    /// (no payload)
+    case restore
+
+    /// color: UInt32
+    case clear
+}
+
+/// A 2D affine transform stored as the six meaningful entries of a
+/// ``Matrix4x4f``. This takes 24 bytes instead of the 64 bytes of a full
+/// matrix.
+internal struct DlAffineTransform {
+    var scaleX: Float
+    var skewX: Float
+    var translateX: Float
+    var skewY: Float
+    var scaleY: Float
+    var translateY: Float
+
+    /// Returns nil if the matrix can not be represented as a 2D affine
+    /// transform without losing information.
+    init?(_ m: Matrix4x4f) {
+        // Values are stored in column-major order.
+        guard m[0, 2] == 0.0 && m[0, 3] == 0.0  // col 1
+            && m[1, 2] == 0.0 && m[1, 3] == 0.0  // col 2
+            && m[2, 0] == 0.0 && m[2, 1] == 0.0 && m[2, 2] == 1.0 && m[2, 3] == 0.0  // col 3
+            && m[3, 2] == 0.0 && m[3, 3] == 1.0  // col 4
+        else {
+            return nil
+        }
+        scaleX = m[0, 0]
+        skewX = m[1, 0]
+        translateX = m[3, 0]
+        skewY = m[0, 1]
+        scaleY = m[1, 1]
+        translateY = m[3, 1]
+    }
+
+    var matrix: Matrix4x4f {
+        var m = Matrix4x4f.identity
+        m[0, 0] = scaleX
+        m[1, 0] = skewX
+        m[3, 0] = translateX
+        m[0, 1] = skewY
+        m[1, 1] = scaleY
+        m[3, 1] = translateY
+        return m
+    }
+}
+
+/// Sequentially decodes values from the storage of a ``DisplayList``.
+internal struct DisplayListReader {
+    /// The index stored in place of an absent optional reference.
+    static let noIndex = UInt32.max
+
+    init(_ bytes: UnsafeRawBufferPointer) {
+        self.bytes = bytes
+    }
+
+    let bytes: UnsafeRawBufferPointer
 
-    // private func read<T>(_: T.Type, offset: inout Int) -> T {
-    //     let value = peek(T.self, offset: offset)
-    //     offset += MemoryLayout<T>.size
-    //     return value
-    // }
+    /// The byte offset of the next value to read.
+    private(set) var offset = 0
+
+    var isAtEnd: Bool { offset >= bytes.count }
+
+    /// Moves to the op that starts at byte `offset`.
+    mutating func seek(to offset: Int) {
+        self.offset = offset
+    }
+
+    /// Returns the value at the current position without advancing.
+    func peek<T>(_: T.Type) -> T {
+        bytes.loadUnaligned(fromByteOffset: offset, as: T.self)
+    }
+
+    mutating func read<T>(_: T.Type) -> T {
+        let value = peek(T.self)
+        offset += MemoryLayout<T>.size
+        return value
+    }
+
+    mutating func readOpType() -> DisplayListOpType {
+        DisplayListOpType(rawValue: read(UInt8.self))!
+    }
+
+    mutating func readIndex() -> Int {
+        Int(read(UInt32.self))
+    }
+
+    mutating func readBool() -> Bool {
+        read(UInt8.self) != 0
+    }
+
+    mutating func readClipOp() -> ClipOp {
+        read(UInt8.self) == 0 ? .intersect : .difference
+    }
 }
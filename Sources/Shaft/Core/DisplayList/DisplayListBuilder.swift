@@ -5,134 +5,434 @@
 import Foundation
 import SwiftMath
 
-internal enum DisplayListOp {
-    case drawRect(rect: Rect, paint: Paint)
-    case drawLine(p0: Offset, p1: Offset, paint: Paint)
-    case drawDisplayList(displayList: DisplayList)
-    case drawParagraph(paragraph: Paragraph, offset: Offset)
-    case drawTextBlob(textBlob: TextBlob, offset: Offset, paint: Paint)
-    case drawRRect(rrect: RRect, paint: Paint)
-    case drawDRRect(outer: RRect, inner: RRect, paint: Paint)
-    case drawCircle(center: Offset, radius: Float, paint: Paint)
-    case drawPath(path: Path, paint: Paint)
-    case drawImage(image: NativeImage, offset: Offset, paint: Paint)
-    case drawImageRect(image: NativeImage, src: Rect, dst: Rect, paint: Paint)
-    case drawImageNine(image: NativeImage, center: Rect, dst: Rect, paint: Paint)
-    case transform(transform: Matrix4x4f)
-    case translate(dx: Float, dy: Float)
-    case scale(sx: Float, sy: Float)
-    case rotate(radians: Float)
-    case clipRect(rect: Rect, clipOp: ClipOp, doAntiAlias: Bool)
-    case clipRRect(rrect: RRect, doAntiAlias: Bool)
-    case save
-    case saveLayer(bounds: Rect, paint: Paint?)
-    case restore
-    case clear(color: Color)
-}
-
 public class DisplayListBuilder: DlOpReceiver {
     /// Creates an empty display list ready to receive drawing operations.
     public init() {}
 
-    /// Recorded drawing operations in drawing order.
-    private var buffer = [DisplayListOp]()
+    /// Encoded drawing operations in drawing order. See ``DisplayList`` for the
+    /// encoding.
+    private var storage = [UInt8]()
+
+    private var opCount = 0
+
+    private var paints = [Paint]()
+
+    /// Maps each paint in ``paints`` to its index so that repeated paints are
+    /// only stored once.
+    private var paintIndices = [Paint: UInt32]()
+
+    private var paragraphs = [Paragraph]()
+
+    private var textBlobs = [TextBlob]()
+
+    private var paths = [Path]()
+
+    private var images = [NativeImage]()
+
+    private var displayLists = [DisplayList]()
+
+    /// The byte offset of each op in ``storage``.
+    private var opOffsets = [UInt32]()
+
+    /// The bounds of each op in the coordinate system of the display list,
+    /// after applying the transforms and clips recorded before it. Ops that
+    /// don't draw, such as transforms and clips, have ``unboundedRect``
+    /// bounds so that they are never culled.
+    private var opBounds = [Rect]()
+
+    /// Indices of ops that don't draw.
+    private var stateOps = [Int]()
+
+    /// The union of the bounds of all drawing ops.
+    private var bounds: Rect?
+
+    /// Whether an op was recorded whose bounds are unknown and not limited by
+    /// a clip.
+    private var hasUnboundedOps = false
+
+    /// Whether the drawing ops can be drawn with an opacity applied to each
+    /// of them instead of to the group. See
+    /// ``DisplayList/canApplyGroupOpacity``.
+    private var canApplyGroupOpacity = true
+
+    /// Whether the drawing ops can be drawn with a color filter added to
+    /// each of their paints instead of to the group.
+    private var canApplyGroupColorFilter = true
+
+    /// The bounds of the drawing ops recorded while any group effect can be
+    /// applied, to check new ops for overlap.
+    private var groupOpBounds: [Rect] = []
+
+    /// Display lists with more drawing ops than this are assumed to overlap
+    /// to bound the cost of checking for overlap.
+    static let maxGroupOpCount = 64
+
+    /// The transform at the current op.
+    private var matrix = Matrix4x4f.identity
+
+    /// The bounds of the current clip, or nil if nothing was clipped.
+    private var clipBounds: Rect?
+
+    /// The transforms and clips to return to on ``restore()``.
+    private var stateStack: [(matrix: Matrix4x4f, clipBounds: Rect?)] = []
+
+    /// Stands in for the bounds of ops that have no known bounds. Finite so
+    /// that it can be transformed and intersected like any other rect.
+    static let unboundedRect = Rect(left: -1e9, top: -1e9, right: 1e9, bottom: 1e9)
+
+    /// Ops with at least this many ops get a spatial index. Smaller display
+    /// lists are culled by checking the bounds of every op.
+    static let minRTreeOpCount = 32
 
     /// Builds the display list. After this method is called, the builder is
     /// still usable and can be used to add more operations on top of the
     /// existing display list.
     public func build() -> DisplayList {
-        DisplayList(buffer: buffer)
+        DisplayList(
+            storage: storage,
+            paints: paints,
+            paragraphs: paragraphs,
+            textBlobs: textBlobs,
+            paths: paths,
+            images: images,
+            displayLists: displayLists,
+            opCount: opCount,
+            uniqueID: DisplayListBuilder.nextUniqueID(),
+            opOffsets: opOffsets,
+            opBounds: opBounds,
+            stateOps: stateOps,
+            canApplyGroupOpacity: canApplyGroupOpacity,
+            canApplyGroupColorFilter: canApplyGroupColorFilter,
+            bounds: hasUnboundedOps ? nil : (bounds ?? .zero),
+            rtree: opCount >= Self.minRTreeOpCount
+                ? Self.buildRTree(opBounds: opBounds, stateOps: stateOps) : nil
+        )
+    }
+
+    private static var lastUniqueID: UInt64 = 0
+
+    /// Display lists are built on whatever thread records them or loads a
+    /// capture, not only on the UI thread.
+    private static let uniqueIDLock = NSLock()
+
+    static func nextUniqueID() -> UInt64 {
+        uniqueIDLock.lock()
+        defer { uniqueIDLock.unlock() }
+        lastUniqueID += 1
+        return lastUniqueID
     }
 
     public func drawLine(_ p0: Offset, _ p1: Offset, _ paint: Paint) {
-        push(.drawLine(p0: p0, p1: p1, paint: paint))
+        let bounds = Rect.fromPoints(p0, p1).inflate(strokeOutset(paint, isStroked: true))
+        push(.drawLine, bounds: bounds, paint: paint)
+        write(p0)
+        write(p1)
+        write(paint)
     }
 
     public func drawRect(_ rect: Rect, _ paint: Paint) {
-        push(.drawRect(rect: rect, paint: paint))
+        push(.drawRect, bounds: rect.inflate(strokeOutset(paint)), paint: paint)
+        write(rect)
+        write(paint)
     }
 
     public func drawDisplayList(_ displayList: DisplayList) {
-        push(.drawDisplayList(displayList: displayList))
+        push(.drawDisplayList, bounds: displayList.bounds)
+        canApplyGroupOpacity = canApplyGroupOpacity && displayList.canApplyGroupOpacity
+        canApplyGroupColorFilter =
+            canApplyGroupColorFilter && displayList.canApplyGroupColorFilter
+        write(append(displayList, to: &displayLists))
     }
 
     public func drawParagraph(_ paragraph: Paragraph, _ offset: Offset) {
-        push(.drawParagraph(paragraph: paragraph, offset: offset))
+        // Glyphs, decorations and shadows may draw outside of the line boxes,
+        // so outset the box by up to a line height or so.
+        let box = Rect(
+            left: offset.dx,
+            top: offset.dy,
+            width: max(paragraph.width, paragraph.longestLine),
+            height: paragraph.height
+        )
+        push(.drawParagraph, bounds: box.inflate(min(paragraph.height, Self.maxTextOverhang)))
+        write(append(paragraph, to: &paragraphs))
+        write(offset)
     }
 
     public func drawTextBlob(_ textBlob: TextBlob, _ offset: Offset, _ paint: Paint) {
-        push(.drawTextBlob(textBlob: textBlob, offset: offset, paint: paint))
+        // Text blobs don't expose their glyph bounds.
+        push(.drawTextBlob, bounds: nil, paint: paint)
+        write(append(textBlob, to: &textBlobs))
+        write(offset)
+        write(paint)
     }
 
     public func drawRRect(_ rrect: RRect, _ paint: Paint) {
-        push(.drawRRect(rrect: rrect, paint: paint))
+        push(.drawRRect, bounds: rrect.outerRect.inflate(strokeOutset(paint)), paint: paint)
+        write(rrect)
+        write(paint)
     }
 
     public func drawDRRect(_ outer: RRect, _ inner: RRect, _ paint: Paint) {
-        push(.drawDRRect(outer: outer, inner: inner, paint: paint))
+        push(.drawDRRect, bounds: outer.outerRect.inflate(strokeOutset(paint)), paint: paint)
+        write(outer)
+        write(inner)
+        write(paint)
     }
 
     public func drawCircle(_ center: Offset, _ radius: Float, _ paint: Paint) {
-        push(.drawCircle(center: center, radius: radius, paint: paint))
+        let rect = Rect.fromCenter(center: center, width: radius * 2, height: radius * 2)
+        push(.drawCircle, bounds: rect.inflate(strokeOutset(paint)), paint: paint)
+        write(center)
+        write(radius)
+        write(paint)
     }
 
     public func drawPath(_ path: Path, _ paint: Paint) {
-        push(.drawPath(path: path, paint: paint))
+        push(.drawPath, bounds: path.getBounds().inflate(strokeOutset(paint)), paint: paint)
+        write(append(path, to: &paths))
+        write(paint)
     }
 
     public func drawImage(_ image: NativeImage, _ offset: Offset, _ paint: Paint) {
-        push(.drawImage(image: image, offset: offset, paint: paint))
+        let rect = Rect(
+            left: offset.dx,
+            top: offset.dy,
+            width: Float(image.width),
+            height: Float(image.height)
+        )
+        push(.drawImage, bounds: rect.inflate(strokeOutset(paint)), paint: paint)
+        write(append(image, to: &images))
+        write(offset)
+        write(paint)
     }
 
     public func drawImageRect(_ image: NativeImage, _ src: Rect, _ dst: Rect, _ paint: Paint) {
-        push(.drawImageRect(image: image, src: src, dst: dst, paint: paint))
+        push(.drawImageRect, bounds: dst.inflate(strokeOutset(paint)), paint: paint)
+        write(append(image, to: &images))
+        write(src)
+        write(dst)
+        write(paint)
     }
 
     public func drawImageNine(_ image: NativeImage, _ center: Rect, _ dst: Rect, _ paint: Paint) {
-        push(.drawImageNine(image: image, center: center, dst: dst, paint: paint))
+        push(.drawImageNine, bounds: dst.inflate(strokeOutset(paint)), paint: paint)
+        write(append(image, to: &images))
+        write(center)
+        write(dst)
+        write(paint)
     }
 
+    /// Records the transform in the most compact form that represents it
+    /// exactly: a translation, a 2D affine transform, or a full matrix.
     public func transform(_ transform: Matrix4x4f) {
-        push(.transform(transform: transform))
+        if let translation = MatrixUtils.getAsTranslation(transform) {
+            translate(translation.dx, translation.dy)
+        } else if let affine = DlAffineTransform(transform) {
+            push(.transform2D)
+            write(affine)
+            matrix = matrix * transform
+        } else {
+            push(.transform)
+            write(transform)
+            matrix = matrix * transform
+        }
     }
 
     public func translate(_ dx: Float, _ dy: Float) {
-        push(.translate(dx: dx, dy: dy))
+        push(.translate)
+        write(dx)
+        write(dy)
+        matrix.translate(dx, dy)
     }
 
     public func scale(_ sx: Float, _ sy: Float) {
-        push(.scale(sx: sx, sy: sy))
+        push(.scale)
+        write(sx)
+        write(sy)
+        matrix.scale(sx, sy, 1)
     }
 
     public func rotate(_ radians: Float) {
-        push(.rotate(radians: radians))
+        push(.rotate)
+        write(radians)
+        matrix.rotateZ(Angle(radians: radians))
     }
 
     public func clipRect(_ rect: Rect, _ clipOp: ClipOp, _ doAntiAlias: Bool) {
-        push(.clipRect(rect: rect, clipOp: clipOp, doAntiAlias: doAntiAlias))
+        push(.clipRect)
+        write(rect)
+        write(clipOp == .intersect ? UInt8(0) : UInt8(1))
+        write(doAntiAlias)
+        if clipOp == .intersect {
+            intersectClip(rect)
+        }
     }
 
     public func clipRRect(_ rrect: RRect, _ doAntiAlias: Bool) {
-        push(.clipRRect(rrect: rrect, doAntiAlias: doAntiAlias))
+        push(.clipRRect)
+        write(rrect)
+        write(doAntiAlias)
+        intersectClip(rrect.outerRect)
     }
 
     public func save() {
         push(.save)
+        stateStack.append((matrix, clipBounds))
     }
 
     public func saveLayer(_ bounds: Rect, paint: Paint?) {
-        push(.saveLayer(bounds: bounds, paint: paint))
+        push(.saveLayer)
+        canApplyGroupOpacity = false
+        canApplyGroupColorFilter = false
+        write(bounds)
+        if let paint {
+            write(paint)
+        } else {
+            write(DisplayListReader.noIndex)
+        }
+        stateStack.append((matrix, clipBounds))
     }
 
     public func restore() {
         push(.restore)
+        if let state = stateStack.popLast() {
+            (matrix, clipBounds) = state
+        }
     }
 
     public func clear(color: Color) {
-        push(.clear(color: color))
+        push(.clear, bounds: nil)
+        write(color.value)
+    }
+
+    // MARK: - Bounds
+
+    /// The maximum distance text is assumed to draw outside of its paragraph
+    /// box.
+    static let maxTextOverhang: Float = 32
+
+    /// Returns how far the geometry drawn with `paint` extends outside of the
+    /// shape being drawn.
+    private func strokeOutset(_ paint: Paint, isStroked: Bool = false) -> Float {
+        var outset: Float = 0
+        if isStroked || paint.style == .stroke {
+            // Hairlines are one pixel wide. Miter joins and square caps can
+            // extend further than half the stroke width.
+            let halfWidth = max(paint.strokeWidth, 1) / 2
+            outset = halfWidth * max(paint.strokeMiterLimit, Float(2).squareRoot())
+        }
+        if let maskFilter = paint.maskFilter {
+            outset += maskFilter.sigma * 3
+        }
+        return outset
+    }
+
+    /// Indexes the drawing ops. State ops are left out, since they are
+    /// always replayed from ``DisplayList/stateOps``.
+    static func buildRTree(opBounds: [Rect], stateOps: [Int]) -> DlRTree {
+        let stateOps = Set(stateOps)
+        let drawOps = opBounds.indices.filter { !stateOps.contains($0) }
+        return DlRTree(drawOps.map { opBounds[$0] }, indices: drawOps)
+    }
+
+    /// Updates whether group effects can still be applied to individual ops
+    /// after recording an op that covers `opBounds`.
+    private func updateGroupEffects(_ type: DisplayListOpType, _ opBounds: Rect, _ paint: Paint?) {
+        if !canApplyGroupOpacity && !canApplyGroupColorFilter {
+            return
+        }
+        if let paint {
+            if paint.blendMode != .srcOver {
+                canApplyGroupOpacity = false
+                canApplyGroupColorFilter = false
+            }
+            if paint.colorFilter != nil {
+                canApplyGroupColorFilter = false
+            }
+        } else if type != .drawDisplayList {
+            canApplyGroupOpacity = false
+            canApplyGroupColorFilter = false
+        }
+
+        if opBounds.isEmpty {
+            return
+        }
+        let overlaps =
+            groupOpBounds.count >= Self.maxGroupOpCount
+            || groupOpBounds.contains { $0.intersects(opBounds) }
+        if overlaps {
+            canApplyGroupOpacity = false
+            canApplyGroupColorFilter = false
+            groupOpBounds = []
+        } else {
+            groupOpBounds.append(opBounds)
+        }
+    }
+
+    private func intersectClip(_ rect: Rect) {
+        let deviceRect = MatrixUtils.transformRect(matrix, rect)
+        clipBounds = clipBounds?.intersect(deviceRect) ?? deviceRect
+    }
+
+    // MARK: - Encoding
+
+    /// Starts a new op that doesn't draw by writing its tag.
+    private func push(_ type: DisplayListOpType) {
+        stateOps.append(opCount)
+        opOffsets.append(UInt32(storage.count))
+        opBounds.append(Self.unboundedRect)
+        storage.append(type.rawValue)
+        opCount += 1
+    }
+
+    /// Starts a new drawing op that covers `localBounds` in the current
+    /// coordinate system, or an unknown area if nil. `paint` is the paint the
+    /// op draws with, which group effects are applied to. Ops without a paint
+    /// other than nested display lists don't support group effects.
+    private func push(_ type: DisplayListOpType, bounds localBounds: Rect?, paint: Paint? = nil) {
+        var opBounds =
+            localBounds.map { MatrixUtils.transformRect(matrix, $0) } ?? Self.unboundedRect
+        if let clipBounds {
+            opBounds = opBounds.intersect(clipBounds)
+        } else if localBounds == nil {
+            hasUnboundedOps = true
+        }
+
+        opOffsets.append(UInt32(storage.count))
+        self.opBounds.append(opBounds)
+        if !opBounds.isEmpty {
+            bounds = bounds?.union(opBounds) ?? opBounds
+        }
+        updateGroupEffects(type, opBounds, paint)
+        storage.append(type.rawValue)
+        opCount += 1
+    }
+
+    /// Appends the raw bytes of a plain value to the storage.
+    private func write<T>(_ value: T) {
+        withUnsafeBytes(of: value) { storage.append(contentsOf: $0) }
+    }
+
+    private func write(_ value: Bool) {
+        storage.append(value ? 1 : 0)
+    }
+
+    /// Writes the index of the given paint, adding it to the paint table if an
+    /// equal paint has not been recorded yet.
+    private func write(_ paint: Paint) {
+        if let index = paintIndices[paint] {
+            write(index)
+            return
+        }
+        let index = UInt32(paints.count)
+        paints.append(paint)
+        paintIndices[paint] = index
+        write(index)
     }
 
-    private func push(_ value: DisplayListOp) {
-        buffer.append(value)
+    /// Appends a value to the given side table and returns its index.
+    private func append<T>(_ value: T, to table: inout [T]) -> UInt32 {
+        table.append(value)
+        return UInt32(table.count - 1)
     }
 }
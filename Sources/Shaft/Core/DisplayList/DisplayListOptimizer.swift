@@ -0,0 +1,613 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+import SwiftMath
+
+/// Counts of ops seen and removed by a ``DisplayListOptimizer``.
+public struct DisplayListOptimizerStats: Equatable {
+    public init() {}
+
+    /// The number of display lists passed to the optimizer.
+    public var displayListCount = 0
+
+    /// The number of ops in the display lists before optimizing.
+    public var opsBefore = 0
+
+    /// The number of ops in the display lists after optimizing.
+    public var opsAfter = 0
+
+    /// The number of ops removed by optimizing.
+    public var opsRemoved: Int { opsBefore - opsAfter }
+}
+
+/// Rewrites recorded display lists into equivalent ones with fewer ops.
+///
+/// The optimizer runs the following passes:
+///
+/// * Draw ops that are completely covered by a later opaque rectangle are
+///   removed, as long as the rectangle covers whole pixels. See
+///   ``removeOverdraw(_:_:)``.
+/// * `saveLayer` with a nil paint is replaced by `save` when everything drawn
+///   into the layer uses source-over blending, since compositing such a layer
+///   has no visible effect.
+/// * `translate` and positive `scale` ops are folded into the geometry of the
+///   ops that follow them where the result is the same, and only emitted in
+///   front of ops that can't absorb them.
+/// * Adjacent intersecting `clipRect`s are merged into one.
+/// * `save`/`restore` pairs that enclose no drawing are removed together with
+///   everything between them.
+public final class DisplayListOptimizer {
+    public static let shared = DisplayListOptimizer()
+
+    public init() {}
+
+    /// Whether ``optimize(_:)`` rewrites display lists. When false, display
+    /// lists are returned unchanged.
+    public var isEnabled = true
+
+    /// Called with the statistics of each frame in ``endFrame()``.
+    public var onFrameStats: ((DisplayListOptimizerStats) -> Void)?
+
+    /// The statistics of the most recently ended frame.
+    public private(set) var lastFrameStats = DisplayListOptimizerStats()
+
+    /// Statistics accumulated since the last call to ``endFrame()``.
+    public private(set) var currentFrameStats = DisplayListOptimizerStats()
+
+    /// Returns a display list that draws the same as `displayList` with as
+    /// few ops as possible. Returns `displayList` itself if the rewritten
+    /// display list would be larger.
+    public func optimize(_ displayList: DisplayList) -> DisplayList {
+        if !isEnabled || displayList.isEmpty {
+            return displayList
+        }
+
+        let collector = DlOpCollector()
+        displayList.dispatch(to: collector)
+        var ops = collector.ops
+
+        removeOverdraw(&ops, displayList.opBounds)
+        replaceTransparentLayers(&ops)
+
+        let builder = DisplayListBuilder()
+        for op in foldState(ops) {
+            op.dispatch(to: builder)
+        }
+        let optimized = builder.build()
+
+        let result = optimized.opCount <= displayList.opCount ? optimized : displayList
+        currentFrameStats.displayListCount += 1
+        currentFrameStats.opsBefore += displayList.opCount
+        currentFrameStats.opsAfter += result.opCount
+        return result
+    }
+
+    /// Ends the statistics of the current frame and reports them to
+    /// ``onFrameStats``.
+    public func endFrame() {
+        lastFrameStats = currentFrameStats
+        currentFrameStats = DisplayListOptimizerStats()
+        onFrameStats?(lastFrameStats)
+    }
+
+    // MARK: - Overdraw
+
+    /// Removes draw ops whose bounds are covered by an opaque rectangle drawn
+    /// after them outside of any save, clip or non axis-aligned transform.
+    ///
+    /// An anti-aliased rectangle only covers the pixels along its edges
+    /// partly, so it must be aligned to whole pixels. A rectangle that is not
+    /// anti-aliased fills every pixel whose center it contains, which also
+    /// fills the pixels of covered ops that are not anti-aliased, but not
+    /// the partly covered edge pixels of anti-aliased ones. Pixels are those
+    /// of the coordinate system of the display list, which stay whole under
+    /// integral device pixel ratios.
+    private func removeOverdraw(_ ops: inout [DlOp?], _ opBounds: [Rect]) {
+        var depth = 0
+        var isAxisAligned = true
+        var isClipped = false
+        var liveDrawOps: [Int] = []
+
+        for index in ops.indices {
+            guard let op = ops[index] else {
+                continue
+            }
+            switch op {
+            case .save, .saveLayer:
+                depth += 1
+            case .restore:
+                depth -= 1
+            case .rotate, .transform:
+                isAxisAligned = isAxisAligned && depth > 0
+            case .clipRect, .clipRRect:
+                isClipped = isClipped || depth == 0
+            case .translate, .scale:
+                break
+            case .drawRect(_, let paint)
+            where depth == 0 && isAxisAligned && !isClipped && isOpaque(paint)
+                && (!paint.isAntiAlias || isPixelAligned(opBounds[index])):
+                let covered = opBounds[index]
+                let coversEdges = isPixelAligned(covered)
+                liveDrawOps.removeAll { other in
+                    let isAntiAlias = ops[other]!.paint?.isAntiAlias ?? true
+                    if (coversEdges || !isAntiAlias) && covered.contains(opBounds[other]) {
+                        ops[other] = nil
+                        return true
+                    }
+                    return false
+                }
+                liveDrawOps.append(index)
+            default:
+                liveDrawOps.append(index)
+            }
+        }
+    }
+
+    /// Whether all edges of `rect` lie on whole pixels.
+    private func isPixelAligned(_ rect: Rect) -> Bool {
+        rect.left == rect.left.rounded() && rect.top == rect.top.rounded()
+            && rect.right == rect.right.rounded() && rect.bottom == rect.bottom.rounded()
+    }
+
+    /// Whether a rectangle drawn with `paint` replaces everything under it.
+    private func isOpaque(_ paint: Paint) -> Bool {
+        paint.style == .fill && paint.maskFilter == nil && paint.colorFilter == nil
+            && paint.color.alpha == 0xFF
+            && (paint.blendMode == .srcOver || paint.blendMode == .src)
+    }
+
+    // MARK: - Layers
+
+    /// An open `save` or `saveLayer` in ``replaceTransparentLayers(_:)``.
+    private struct OpenLayer {
+        /// The index of the `saveLayer` op, or nil for a `save`.
+        var layerIndex: Int?
+
+        /// Whether the layer has a nil paint and nothing drawn into it
+        /// depends on being drawn into a separate layer.
+        var isReplaceable: Bool
+    }
+
+    /// Replaces `saveLayer` with a nil paint by `save` when compositing the
+    /// layer makes no difference.
+    private func replaceTransparentLayers(_ ops: inout [DlOp?]) {
+        var stack: [OpenLayer] = []
+
+        /// Marks the innermost save or layer as containing content that
+        /// depends on the layer it is drawn into.
+        func markIrreplaceable() {
+            if !stack.isEmpty {
+                stack[stack.count - 1].isReplaceable = false
+            }
+        }
+
+        for index in ops.indices {
+            guard let op = ops[index] else {
+                continue
+            }
+            switch op {
+            case .save:
+                stack.append(OpenLayer(layerIndex: nil, isReplaceable: true))
+            case .saveLayer(_, let paint):
+                if let paint, paint.blendMode != .srcOver {
+                    markIrreplaceable()
+                }
+                stack.append(OpenLayer(layerIndex: index, isReplaceable: paint == nil))
+            case .restore:
+                guard let open = stack.popLast() else {
+                    continue
+                }
+                if let layerIndex = open.layerIndex {
+                    if open.isReplaceable {
+                        ops[layerIndex] = .save
+                    }
+                } else if !open.isReplaceable {
+                    // Content of a save is drawn into the enclosing layer.
+                    markIrreplaceable()
+                }
+            case .clear, .drawDisplayList:
+                markIrreplaceable()
+            default:
+                if let paint = op.paint, paint.blendMode != .srcOver {
+                    markIrreplaceable()
+                }
+            }
+        }
+    }
+
+    // MARK: - State
+
+    /// A pending transform that maps `p` to `p * scale + translation`.
+    private struct PendingTransform: Equatable {
+        var sx: Float = 1
+        var sy: Float = 1
+        var tx: Float = 0
+        var ty: Float = 0
+
+        var hasScale: Bool { sx != 1 || sy != 1 }
+
+        var hasTranslation: Bool { tx != 0 || ty != 0 }
+
+        func map(_ offset: Offset) -> Offset {
+            Offset(offset.dx * sx + tx, offset.dy * sy + ty)
+        }
+
+        func map(_ rect: Rect) -> Rect {
+            Rect(
+                left: rect.left * sx + tx,
+                top: rect.top * sy + ty,
+                right: rect.right * sx + tx,
+                bottom: rect.bottom * sy + ty
+            )
+        }
+
+        func map(_ rrect: RRect) -> RRect {
+            RRect(
+                left: rrect.left * sx + tx,
+                top: rrect.top * sy + ty,
+                right: rrect.right * sx + tx,
+                bottom: rrect.bottom * sy + ty,
+                tlRadiusX: rrect.tlRadiusX * sx,
+                tlRadiusY: rrect.tlRadiusY * sy,
+                trRadiusX: rrect.trRadiusX * sx,
+                trRadiusY: rrect.trRadiusY * sy,
+                blRadiusX: rrect.blRadiusX * sx,
+                blRadiusY: rrect.blRadiusY * sy,
+                brRadiusX: rrect.brRadiusX * sx,
+                brRadiusY: rrect.brRadiusY * sy
+            )
+        }
+    }
+
+    /// An open `save` or `saveLayer` in ``foldState(_:)``.
+    private struct SaveFrame {
+        /// The index of the save op in the output.
+        var outputIndex: Int
+
+        /// The pending transform when the save was recorded.
+        var transform: PendingTransform
+
+        /// Whether anything was drawn since the save.
+        var hasDrawing = false
+    }
+
+    /// Folds transforms into geometry, merges clips and drops saves that
+    /// enclose no drawing.
+    private func foldState(_ ops: [DlOp?]) -> [DlOp] {
+        var output: [DlOp] = []
+        output.reserveCapacity(ops.count)
+        var pending = PendingTransform()
+        var frames: [SaveFrame] = []
+
+        /// Emits the pending transform so that the next op is drawn with the
+        /// real transform.
+        func materialize() {
+            if pending.hasTranslation {
+                output.append(.translate(pending.tx, pending.ty))
+            }
+            if pending.hasScale {
+                output.append(.scale(pending.sx, pending.sy))
+            }
+            pending = PendingTransform()
+        }
+
+        func emitDrawing(_ op: DlOp) {
+            if let folded = fold(op, pending) {
+                output.append(folded)
+            } else {
+                materialize()
+                output.append(op)
+            }
+            if !frames.isEmpty {
+                frames[frames.count - 1].hasDrawing = true
+            }
+        }
+
+        for case let op? in ops {
+            switch op {
+            case .translate(let dx, let dy):
+                pending.tx += pending.sx * dx
+                pending.ty += pending.sy * dy
+            case .scale(let sx, let sy):
+                if sx > 0 && sy > 0 {
+                    pending.sx *= sx
+                    pending.sy *= sy
+                } else {
+                    materialize()
+                    output.append(op)
+                }
+            case .rotate, .transform:
+                materialize()
+                output.append(op)
+            case .clipRect(let rect, let clipOp, let doAntiAlias):
+                let rect = pending.map(rect)
+                if clipOp == .intersect,
+                    case .clipRect(let previous, .intersect, doAntiAlias) = output.last
+                {
+                    output[output.count - 1] = .clipRect(
+                        intersection(previous, rect),
+                        .intersect,
+                        doAntiAlias
+                    )
+                } else {
+                    output.append(.clipRect(rect, clipOp, doAntiAlias))
+                }
+            case .clipRRect(let rrect, let doAntiAlias):
+                output.append(.clipRRect(pending.map(rrect), doAntiAlias))
+            case .save:
+                frames.append(SaveFrame(outputIndex: output.count, transform: pending))
+                output.append(op)
+            case .saveLayer(let bounds, let paint):
+                frames.append(SaveFrame(outputIndex: output.count, transform: pending))
+                output.append(.saveLayer(pending.map(bounds), paint))
+            case .restore:
+                guard let frame = frames.popLast() else {
+                    output.append(op)
+                    continue
+                }
+                if frame.hasDrawing {
+                    output.append(op)
+                    if !frames.isEmpty {
+                        frames[frames.count - 1].hasDrawing = true
+                    }
+                } else {
+                    output.removeSubrange(frame.outputIndex...)
+                }
+                pending = frame.transform
+            case .clear:
+                // Clearing ignores the transform.
+                output.append(op)
+                if !frames.isEmpty {
+                    frames[frames.count - 1].hasDrawing = true
+                }
+            default:
+                emitDrawing(op)
+            }
+        }
+
+        // The transform at the end of the display list is visible to ops
+        // drawn after it on the same canvas.
+        materialize()
+        return output
+    }
+
+    /// Returns `op` with `transform` applied to its geometry, or nil if the
+    /// result would draw differently than `op` under `transform`.
+    private func fold(_ op: DlOp, _ transform: PendingTransform) -> DlOp? {
+        if transform == PendingTransform() {
+            return op
+        }
+        let translationOnly = !transform.hasScale
+
+        switch op {
+        case .drawRect(let rect, let paint) where translationOnly || scalesExactly(paint):
+            return .drawRect(transform.map(rect), paint)
+        case .drawRRect(let rrect, let paint) where translationOnly || scalesExactly(paint):
+            return .drawRRect(transform.map(rrect), paint)
+        case .drawDRRect(let outer, let inner, let paint)
+        where translationOnly || scalesExactly(paint):
+            return .drawDRRect(transform.map(outer), transform.map(inner), paint)
+        case .drawCircle(let center, let radius, let paint)
+        where translationOnly || (transform.sx == transform.sy && scalesExactly(paint)):
+            return .drawCircle(transform.map(center), radius * transform.sx, paint)
+        case .drawImageRect(let image, let src, let dst, let paint)
+        where translationOnly || paint.maskFilter == nil:
+            return .drawImageRect(image, src, transform.map(dst), paint)
+        case .drawLine(let p0, let p1, let paint) where translationOnly:
+            return .drawLine(transform.map(p0), transform.map(p1), paint)
+        case .drawParagraph(let paragraph, let offset) where translationOnly:
+            return .drawParagraph(paragraph, transform.map(offset))
+        case .drawTextBlob(let textBlob, let offset, let paint) where translationOnly:
+            return .drawTextBlob(textBlob, transform.map(offset), paint)
+        case .drawImage(let image, let offset, let paint) where translationOnly:
+            return .drawImage(image, transform.map(offset), paint)
+        case .drawImageNine(let image, let center, let dst, let paint) where translationOnly:
+            return .drawImageNine(image, center, transform.map(dst), paint)
+        default:
+            return nil
+        }
+    }
+
+    /// Whether a shape drawn with `paint` looks the same when its geometry is
+    /// scaled instead of the canvas. Strokes and blurs are sized in local
+    /// coordinates, so they would change.
+    private func scalesExactly(_ paint: Paint) -> Bool {
+        paint.style == .fill && paint.maskFilter == nil
+    }
+
+    /// Returns the intersection of two rects, or an empty rect if they don't
+    /// overlap.
+    private func intersection(_ a: Rect, _ b: Rect) -> Rect {
+        let result = a.intersect(b)
+        if result.width < 0 || result.height < 0 {
+            return Rect(left: result.left, top: result.top, right: result.left, bottom: result.top)
+        }
+        return result
+    }
+}
+
+/// A decoded display list op, used to rewrite display lists.
+internal enum DlOp {
+    case drawRect(Rect, Paint)
+    case drawLine(Offset, Offset, Paint)
+    case drawDisplayList(DisplayList)
+    case drawParagraph(Paragraph, Offset)
+    case drawTextBlob(TextBlob, Offset, Paint)
+    case drawRRect(RRect, Paint)
+    case drawDRRect(RRect, RRect, Paint)
+    case drawCircle(Offset, Float, Paint)
+    case drawPath(Path, Paint)
+    case drawImage(NativeImage, Offset, Paint)
+    case drawImageRect(NativeImage, Rect, Rect, Paint)
+    case drawImageNine(NativeImage, Rect, Rect, Paint)
+    case transform(Matrix4x4f)
+    case translate(Float, Float)
+    case scale(Float, Float)
+    case rotate(Float)
+    case clipRect(Rect, ClipOp, Bool)
+    case clipRRect(RRect, Bool)
+    case save
+    case saveLayer(Rect, Paint?)
+    case restore
+    case clear(Color)
+
+    /// The paint the op draws with, if any.
+    var paint: Paint? {
+        switch self {
+        case .drawRect(_, let paint), .drawLine(_, _, let paint), .drawTextBlob(_, _, let paint),
+            .drawRRect(_, let paint), .drawDRRect(_, _, let paint), .drawCircle(_, _, let paint),
+            .drawPath(_, let paint), .drawImage(_, _, let paint),
+            .drawImageRect(_, _, _, let paint), .drawImageNine(_, _, _, let paint):
+            return paint
+        case .saveLayer(_, let paint):
+            return paint
+        default:
+            return nil
+        }
+    }
+
+    func dispatch(to receiver: DlOpReceiver) {
+        switch self {
+        case .drawRect(let rect, let paint):
+            receiver.drawRect(rect, paint)
+        case .drawLine(let p0, let p1, let paint):
+            receiver.drawLine(p0, p1, paint)
+        case .drawDisplayList(let displayList):
+            receiver.drawDisplayList(displayList)
+        case .drawParagraph(let paragraph, let offset):
+            receiver.drawParagraph(paragraph, offset)
+        case .drawTextBlob(let textBlob, let offset, let paint):
+            receiver.drawTextBlob(textBlob, offset, paint)
+        case .drawRRect(let rrect, let paint):
+            receiver.drawRRect(rrect, paint)
+        case .drawDRRect(let outer, let inner, let paint):
+            receiver.drawDRRect(outer, inner, paint)
+        case .drawCircle(let center, let radius, let paint):
+            receiver.drawCircle(center, radius, paint)
+        case .drawPath(let path, let paint):
+            receiver.drawPath(path, paint)
+        case .drawImage(let image, let offset, let paint):
+            receiver.drawImage(image, offset, paint)
+        case .drawImageRect(let image, let src, let dst, let paint):
+            receiver.drawImageRect(image, src, dst, paint)
+        case .drawImageNine(let image, let center, let dst, let paint):
+            receiver.drawImageNine(image, center, dst, paint)
+        case .transform(let transform):
+            receiver.transform(transform)
+        case .translate(let dx, let dy):
+            receiver.translate(dx, dy)
+        case .scale(let sx, let sy):
+            receiver.scale(sx, sy)
+        case .rotate(let radians):
+            receiver.rotate(radians)
+        case .clipRect(let rect, let clipOp, let doAntiAlias):
+            receiver.clipRect(rect, clipOp, doAntiAlias)
+        case .clipRRect(let rrect, let doAntiAlias):
+            receiver.clipRRect(rrect, doAntiAlias)
+        case .save:
+            receiver.save()
+        case .saveLayer(let bounds, let paint):
+            receiver.saveLayer(bounds, paint: paint)
+        case .restore:
+            receiver.restore()
+        case .clear(let color):
+            receiver.clear(color: color)
+        }
+    }
+}
+
+/// Collects the ops of a display list in recording order. Nested display
+/// lists are kept as a single op.
+private final class DlOpCollector: DlOpReceiver {
+    var ops: [DlOp?] = []
+
+    func drawDisplayList(_ displayList: DisplayList) {
+        ops.append(.drawDisplayList(displayList))
+    }
+
+    func save() {
+        ops.append(.save)
+    }
+
+    func saveLayer(_ bounds: Rect, paint: Paint?) {
+        ops.append(.saveLayer(bounds, paint))
+    }
+
+    func restore() {
+        ops.append(.restore)
+    }
+
+    func translate(_ dx: Float, _ dy: Float) {
+        ops.append(.translate(dx, dy))
+    }
+
+    func scale(_ sx: Float, _ sy: Float) {
+        ops.append(.scale(sx, sy))
+    }
+
+    func rotate(_ radians: Float) {
+        ops.append(.rotate(radians))
+    }
+
+    func transform(_ transform: Matrix4x4f) {
+        ops.append(.transform(transform))
+    }
+
+    func clipRect(_ rect: Rect, _ clipOp: ClipOp, _ doAntiAlias: Bool) {
+        ops.append(.clipRect(rect, clipOp, doAntiAlias))
+    }
+
+    func clipRRect(_ rrect: RRect, _ doAntiAlias: Bool) {
+        ops.append(.clipRRect(rrect, doAntiAlias))
+    }
+
+    func drawLine(_ p0: Offset, _ p1: Offset, _ paint: Paint) {
+        ops.append(.drawLine(p0, p1, paint))
+    }
+
+    func drawRect(_ rect: Rect, _ paint: Paint) {
+        ops.append(.drawRect(rect, paint))
+    }
+
+    func drawRRect(_ rrect: RRect, _ paint: Paint) {
+        ops.append(.drawRRect(rrect, paint))
+    }
+
+    func drawDRRect(_ outer: RRect, _ inner: RRect, _ paint: Paint) {
+        ops.append(.drawDRRect(outer, inner, paint))
+    }
+
+    func drawCircle(_ center: Offset, _ radius: Float, _ paint: Paint) {
+        ops.append(.drawCircle(center, radius, paint))
+    }
+
+    func drawPath(_ path: Path, _ paint: Paint) {
+        ops.append(.drawPath(path, paint))
+    }
+
+    func drawImage(_ image: NativeImage, _ offset: Offset, _ paint: Paint) {
+        ops.append(.drawImage(image, offset, paint))
+    }
+
+    func drawImageRect(_ image: NativeImage, _ src: Rect, _ dst: Rect, _ paint: Paint) {
+        ops.append(.drawImageRect(image, src, dst, paint))
+    }
+
+    func drawImageNine(_ image: NativeImage, _ center: Rect, _ dst: Rect, _ paint: Paint) {
+        ops.append(.drawImageNine(image, center, dst, paint))
+    }
+
+    func drawParagraph(_ paragraph: Paragraph, _ offset: Offset) {
+        ops.append(.drawParagraph(paragraph, offset))
+    }
+
+    func drawTextBlob(_ blob: TextBlob, _ offset: Offset, _ paint: Paint) {
+        ops.append(.drawTextBlob(blob, offset, paint))
+    }
+
+    func clear(color: Color) {
+        ops.append(.clear(color))
+    }
+}
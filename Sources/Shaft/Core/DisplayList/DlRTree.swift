@@ -0,0 +1,88 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+/// A static R-tree over the bounds of the ops of a ``DisplayList``.
+///
+/// Leaves are packed in recording order rather than sorted spatially. Content
+/// is usually painted in reading order, so neighbouring ops tend to be close
+/// on screen, and searches return op indices in drawing order without
+/// sorting.
+internal struct DlRTree {
+    /// The maximum number of children of a node.
+    static let fanout = 8
+
+    private struct Node {
+        var bounds: Rect
+
+        /// The range of children in the level below, or of leaves for the
+        /// lowest level.
+        var start: Int
+        var end: Int
+    }
+
+    /// Indexes `leaves`, which are the bounds of the ops at `indices`.
+    /// `indices` must be ascending.
+    init(_ leaves: [Rect], indices: [Int]) {
+        assert(leaves.count == indices.count)
+        self.leaves = leaves
+        self.indices = indices
+
+        var level = stride(from: 0, to: leaves.count, by: Self.fanout).map { start in
+            let end = min(start + Self.fanout, leaves.count)
+            return Node(bounds: Self.union(leaves[start..<end]), start: start, end: end)
+        }
+        levels = [level]
+        while level.count > 1 {
+            let children = level
+            level = stride(from: 0, to: children.count, by: Self.fanout).map { start in
+                let end = min(start + Self.fanout, children.count)
+                return Node(
+                    bounds: Self.union(children[start..<end].map(\.bounds)),
+                    start: start,
+                    end: end
+                )
+            }
+            levels.append(level)
+        }
+    }
+
+    private let leaves: [Rect]
+
+    /// The op index of each leaf.
+    private let indices: [Int]
+
+    /// Levels of nodes from the lowest, whose children are leaves, to the
+    /// root level, which has a single node.
+    private var levels: [[Node]]
+
+    /// Returns the op indices of the leaves that intersect `rect` in
+    /// ascending order.
+    func search(_ rect: Rect) -> [Int] {
+        var result: [Int] = []
+        guard let root = levels.last?.first else {
+            return result
+        }
+        search(rect, root, level: levels.count - 1, into: &result)
+        return result
+    }
+
+    private func search(_ rect: Rect, _ node: Node, level: Int, into result: inout [Int]) {
+        if !node.bounds.intersects(rect) {
+            return
+        }
+        if level == 0 {
+            for leaf in node.start..<node.end where leaves[leaf].intersects(rect) {
+                result.append(indices[leaf])
+            }
+            return
+        }
+        for child in levels[level - 1][node.start..<node.end] {
+            search(rect, child, level: level - 1, into: &result)
+        }
+    }
+
+    private static func union<C: Collection>(_ rects: C) -> Rect where C.Element == Rect {
+        rects.dropFirst().reduce(rects.first!) { $0.union($1) }
+    }
+}
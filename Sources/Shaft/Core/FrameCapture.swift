@@ -0,0 +1,637 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+import SwiftMath
+
+/// Converts renderer-specific resources referenced by display lists, such as
+/// paragraphs and images, to bytes and back, so that frames can be captured
+/// and replayed in another process. Implemented by renderers.
+///
+/// Decoded resources only need to support drawing on a canvas of the same
+/// renderer. For example, a decoded paragraph may be a recording of the
+/// glyphs it painted that can't be laid out again.
+public protocol CaptureResourceCodec: AnyObject {
+    func encodeParagraph(_ paragraph: Paragraph) -> Data?
+
+    func encodeTextBlob(_ textBlob: TextBlob) -> Data?
+
+    func encodePath(_ path: Path) -> Data?
+
+    func encodeImage(_ image: NativeImage) -> Data?
+
+    func decodeParagraph(_ data: Data) -> Paragraph?
+
+    func decodeTextBlob(_ data: Data) -> TextBlob?
+
+    func decodePath(_ data: Data) -> Path?
+
+    func decodeImage(_ data: Data) -> NativeImage?
+
+    /// Returns a transparent image of the given size. Used in place of images
+    /// that could not be encoded or decoded, so that the rest of the frame can
+    /// still be replayed.
+    func makePlaceholderImage(width: UInt, height: UInt) -> NativeImage?
+}
+
+public enum FrameCaptureError: Error {
+    /// The renderer doesn't implement ``CaptureResourceCodec``.
+    case unsupportedRenderer
+
+    /// The file is not a capture or was written by an incompatible version.
+    case invalidFile(String)
+
+    /// A resource of a display list could not be encoded when capturing or
+    /// decoded when loading.
+    case unavailableResource(kind: String, id: Int)
+}
+
+/// A frame loaded from a capture file by ``FrameCapture/load(from:codec:)``.
+public struct CapturedFrame {
+    /// The layer tree as it was submitted to the view. Layer animations are
+    /// frozen at their value at the time of the capture.
+    public let layerTree: LayerTree
+
+    /// The physical size of the view the frame was rendered to.
+    public let physicalSize: ISize
+
+    public let devicePixelRatio: Float
+
+    /// The time since the capture started at which the frame was submitted.
+    public let timestamp: Duration
+}
+
+/// Captures every ``LayerTree`` submitted to a view, including the display
+/// lists of its picture layers and their paragraphs, text blobs, paths and
+/// images, into a file. Captured frames can be loaded into another process
+/// and rasterized again without the app that produced them, for example to
+/// investigate a slow frame or to compare renderer changes on real content.
+///
+/// Display lists and resources are written once and shared by all frames
+/// that use them, so layers that are not repainted cost nothing in later
+/// frames. Encoding resources is slow, so capturing affects frame times.
+///
+/// ```swift
+/// try FrameCapture.start(to: url)
+/// // ...
+/// try FrameCapture.stop()
+/// ```
+///
+/// Only call these methods on the UI thread.
+public enum FrameCapture {
+    private static var writer: FrameCaptureWriter?
+
+    /// Whether layer trees are being captured.
+    public static var isCapturing: Bool { writer != nil }
+
+    /// Starts capturing frames to a new file at `url`, replacing any
+    /// existing file. Resources are encoded with `codec`, which defaults to
+    /// the renderer of the current ``backend``.
+    public static func start(to url: URL, codec: CaptureResourceCodec? = nil) throws {
+        guard let codec = codec ?? backend.renderer as? CaptureResourceCodec else {
+            throw FrameCaptureError.unsupportedRenderer
+        }
+        try stop()
+        writer = try FrameCaptureWriter(url: url, codec: codec)
+    }
+
+    /// Stops capturing and closes the file. Does nothing if no capture is
+    /// running.
+    public static func stop() throws {
+        guard let writer else {
+            return
+        }
+        self.writer = nil
+        try writer.close()
+    }
+
+    /// Writes `layerTree` to the capture file if a capture is running.
+    /// Called by ``RenderView`` before submitting a frame to `view`.
+    static func capture(_ layerTree: LayerTree, view: NativeView) {
+        capture(layerTree, physicalSize: view.physicalSize, devicePixelRatio: view.devicePixelRatio)
+    }
+
+    static func capture(_ layerTree: LayerTree, physicalSize: ISize, devicePixelRatio: Float) {
+        guard let writer else {
+            return
+        }
+        do {
+            try writer.write(
+                layerTree,
+                physicalSize: physicalSize,
+                devicePixelRatio: devicePixelRatio
+            )
+        } catch {
+            assertionFailure("Failed to capture frame: \(error)")
+            self.writer = nil
+            try? writer.close()
+        }
+    }
+
+    /// Reads all frames of the capture file at `url`, decoding resources
+    /// with `codec`. Frames that share display lists in the capture share
+    /// them after loading, so caches keyed by display lists behave as they
+    /// did in the captured app.
+    public static func load(from url: URL, codec: CaptureResourceCodec) throws -> [CapturedFrame] {
+        try FrameCaptureReader(data: Data(contentsOf: url, options: .mappedIfSafe), codec: codec)
+            .readFrames()
+    }
+}
+
+// MARK: - File format
+
+// A capture file starts with ``captureMagic`` and ``captureVersion`` followed
+// by records. Each record is a little-endian `UInt32` byte count followed by
+// a ``CaptureRecord`` encoded as a binary property list. Records only refer
+// to display lists and resources written by earlier records.
+
+private let captureMagic = Data("SHAFTCAP".utf8)
+
+private let captureVersion: UInt32 = 1
+
+private enum CaptureRecord: Codable {
+    /// `width` and `height` are recorded for images, so that images missing
+    /// `data` can be replaced by a placeholder of the same size.
+    case resource(kind: CaptureResourceKind, id: Int, data: Data?, width: UInt?, height: UInt?)
+    case displayList(CapturedDisplayList)
+    case frame(CapturedFrameRecord)
+}
+
+private enum CaptureResourceKind: String, Codable {
+    case paragraph
+    case textBlob
+    case path
+    case image
+}
+
+/// A ``CaptureRecord/resource(kind:id:data:width:height:)`` record that has
+/// not been decoded yet.
+private struct CapturedResource {
+    var kind: CaptureResourceKind
+
+    var data: Data?
+
+    var width: UInt?
+
+    var height: UInt?
+}
+
+/// The fields of a ``DisplayList``. Plain values are stored as raw bytes
+/// like in the storage of the display list itself, and side table entries
+/// are identifiers of earlier records.
+private struct CapturedDisplayList: Codable {
+    var id: UInt64
+    var storage: Data
+    var paints: [Paint]
+    var paragraphs: [Int]
+    var textBlobs: [Int]
+    var paths: [Int]
+    var images: [Int]
+    var displayLists: [UInt64]
+    var opCount: Int
+    var opOffsets: Data
+    var opBounds: Data
+    var stateOps: [Int]
+    var canApplyGroupOpacity: Bool
+    var canApplyGroupColorFilter: Bool
+    var bounds: Data?
+    var hasRTree: Bool
+}
+
+private struct CapturedFrameRecord: Codable {
+    var width: Int
+    var height: Int
+    var devicePixelRatio: Float
+    var timestampMicroseconds: Int64
+    var root: CapturedLayer
+}
+
+/// A layer and its children. Geometry is stored as raw bytes.
+private indirect enum CapturedLayer: Codable {
+    case container(children: [CapturedLayer])
+    case offset(offset: Data, children: [CapturedLayer])
+    case transform(transform: Data, offset: Data, children: [CapturedLayer])
+    case opacity(alpha: UInt8, offset: Data, children: [CapturedLayer])
+    case clipRect(rect: Data, clipBehavior: Clip, children: [CapturedLayer])
+    case clipRRect(rrect: Data, clipBehavior: Clip, children: [CapturedLayer])
+    case colorFilter(colorFilter: ColorFilter, children: [CapturedLayer])
+    case picture(canvasBounds: Data, displayList: UInt64?)
+}
+
+extension Data {
+    /// The raw bytes of `values`, which must be plain values.
+    fileprivate init<T>(plain values: [T]) {
+        self = values.withUnsafeBytes { Data($0) }
+    }
+
+    fileprivate init<T>(plainValue value: T) {
+        self.init(plain: [value])
+    }
+
+    /// Reads values written by ``init(plain:)`` or ``init(plainValue:)``.
+    fileprivate func plainValues<T>(_: T.Type) -> [T] {
+        withUnsafeBytes { bytes in
+            (0..<bytes.count / MemoryLayout<T>.size).map { index in
+                bytes.loadUnaligned(fromByteOffset: index * MemoryLayout<T>.size, as: T.self)
+            }
+        }
+    }
+
+    fileprivate func plainValue<T>(_: T.Type) throws -> T {
+        guard count == MemoryLayout<T>.size else {
+            throw FrameCaptureError.invalidFile(
+                "Expected \(MemoryLayout<T>.size) bytes for \(T.self)"
+            )
+        }
+        return plainValues(T.self)[0]
+    }
+}
+
+// MARK: - Writing
+
+private final class FrameCaptureWriter {
+    init(url: URL, codec: CaptureResourceCodec) throws {
+        FileManager.default.createFile(atPath: url.path, contents: nil)
+        self.handle = try FileHandle(forWritingTo: url)
+        self.codec = codec
+        self.encoder.outputFormat = .binary
+
+        var header = captureMagic
+        header.append(Data(plainValue: captureVersion.littleEndian))
+        try handle.write(contentsOf: header)
+    }
+
+    private let handle: FileHandle
+
+    private let codec: CaptureResourceCodec
+
+    private let encoder = PropertyListEncoder()
+
+    private let startTime = ContinuousClock.now
+
+    private var writtenDisplayLists: Set<UInt64> = []
+
+    private var resourceIDs: [ObjectIdentifier: Int] = [:]
+
+    /// Resources that have been written. Retained so that their identifiers
+    /// are not reused by new objects during the capture.
+    private var writtenResources: [AnyObject] = []
+
+    func write(_ layerTree: LayerTree, physicalSize: ISize, devicePixelRatio: Float) throws {
+        let time = ContinuousClock.now
+        let root = try encode(layerTree.root, at: time)
+        try write(
+            .frame(
+                CapturedFrameRecord(
+                    width: physicalSize.width,
+                    height: physicalSize.height,
+                    devicePixelRatio: devicePixelRatio,
+                    timestampMicroseconds: (time - startTime).inMicroseconds,
+                    root: root
+                )
+            )
+        )
+    }
+
+    func close() throws {
+        try handle.close()
+    }
+
+    private func write(_ record: CaptureRecord) throws {
+        let payload = try encoder.encode(record)
+        var chunk = Data(plainValue: UInt32(payload.count).littleEndian)
+        chunk.append(payload)
+        try handle.write(contentsOf: chunk)
+    }
+
+    /// Encodes `layer` with the values of its animations at `time`.
+    private func encode(_ layer: Layer, at time: ContinuousClock.Instant) throws -> CapturedLayer {
+        if let picture = layer as? PictureLayer {
+            if let displayList = picture.picture {
+                try writeDisplayList(displayList)
+            }
+            return .picture(
+                canvasBounds: Data(plainValue: picture.canvasBounds),
+                displayList: picture.picture?.uniqueID
+            )
+        }
+
+        guard let container = layer as? ContainerLayer else {
+            assertionFailure("Unknown layer type \(type(of: layer))")
+            return .container(children: [])
+        }
+        let children = try container.children.map { try encode($0, at: time) }
+        func offset(of layer: OffsetLayer) -> Data {
+            Data(plainValue: layer.offsetAnimation?.value(at: time) ?? layer.offset)
+        }
+
+        switch container {
+        case let layer as OpacityLayer:
+            return .opacity(
+                alpha: layer.alphaAnimation?.value(at: time) ?? layer.alpha,
+                offset: offset(of: layer),
+                children: children
+            )
+        case let layer as TransformLayer:
+            return .transform(
+                transform: Data(
+                    plainValue: layer.transformAnimation?.value(at: time) ?? layer.transform
+                ),
+                offset: offset(of: layer),
+                children: children
+            )
+        case let layer as OffsetLayer:
+            return .offset(
+                offset: offset(of: layer),
+                children: children
+            )
+        case let layer as ClipRectLayer:
+            return .clipRect(
+                rect: Data(plainValue: layer.clipRect),
+                clipBehavior: layer.clipBehavior,
+                children: children
+            )
+        case let layer as ClipRRectLayer:
+            return .clipRRect(
+                rrect: Data(plainValue: layer.clipRRect),
+                clipBehavior: layer.clipBehavior,
+                children: children
+            )
+        case let layer as ColorFilterLayer:
+            return .colorFilter(colorFilter: layer.colorFilter, children: children)
+        default:
+            return .container(children: children)
+        }
+    }
+
+    /// Writes `displayList`, the display lists it draws and its resources
+    /// unless they were written before.
+    private func writeDisplayList(_ displayList: DisplayList) throws {
+        if writtenDisplayLists.contains(displayList.uniqueID) {
+            return
+        }
+        for child in displayList.displayLists {
+            try writeDisplayList(child)
+        }
+
+        let record = CapturedDisplayList(
+            id: displayList.uniqueID,
+            storage: Data(displayList.storage),
+            paints: displayList.paints,
+            paragraphs: try displayList.paragraphs.map { paragraph in
+                try writeResource(paragraph as AnyObject, .paragraph) {
+                    codec.encodeParagraph(paragraph)
+                }
+            },
+            textBlobs: try displayList.textBlobs.map { textBlob in
+                try writeResource(textBlob as AnyObject, .textBlob) {
+                    codec.encodeTextBlob(textBlob)
+                }
+            },
+            paths: try displayList.paths.map { path in
+                try writeResource(path as AnyObject, .path) { codec.encodePath(path) }
+            },
+            images: try displayList.images.map { image in
+                try writeResource(image, .image, size: (image.width, image.height)) {
+                    codec.encodeImage(image)
+                }
+            },
+            displayLists: displayList.displayLists.map(\.uniqueID),
+            opCount: displayList.opCount,
+            opOffsets: Data(plain: displayList.opOffsets),
+            opBounds: Data(plain: displayList.opBounds),
+            stateOps: displayList.stateOps,
+            canApplyGroupOpacity: displayList.canApplyGroupOpacity,
+            canApplyGroupColorFilter: displayList.canApplyGroupColorFilter,
+            bounds: displayList.bounds.map { Data(plainValue: $0) },
+            hasRTree: displayList.rtree != nil
+        )
+        try write(.displayList(record))
+        writtenDisplayLists.insert(displayList.uniqueID)
+    }
+
+    /// Writes `resource` unless it was written before and returns its
+    /// identifier in the capture.
+    private func writeResource(
+        _ resource: AnyObject,
+        _ kind: CaptureResourceKind,
+        size: (width: UInt, height: UInt)? = nil,
+        encode: () -> Data?
+    ) throws -> Int {
+        let key = ObjectIdentifier(resource)
+        if let id = resourceIDs[key] {
+            return id
+        }
+        let id = writtenResources.count
+        try write(
+            .resource(
+                kind: kind,
+                id: id,
+                data: encode(),
+                width: size?.width,
+                height: size?.height
+            )
+        )
+        resourceIDs[key] = id
+        writtenResources.append(resource)
+        return id
+    }
+}
+
+// MARK: - Reading
+
+private struct FrameCaptureReader {
+    init(data: Data, codec: CaptureResourceCodec) {
+        self.data = data
+        self.codec = codec
+    }
+
+    let data: Data
+
+    let codec: CaptureResourceCodec
+
+    private let decoder = PropertyListDecoder()
+
+    private var resources: [Int: CapturedResource] = [:]
+
+    private var decodedResources: [Int: Any] = [:]
+
+    private var displayLists: [UInt64: DisplayList] = [:]
+
+    mutating func readFrames() throws -> [CapturedFrame] {
+        let headerSize = captureMagic.count + MemoryLayout<UInt32>.size
+        guard data.count >= headerSize, data.prefix(captureMagic.count) == captureMagic else {
+            throw FrameCaptureError.invalidFile("Not a frame capture")
+        }
+        let versionStart = data.startIndex + captureMagic.count
+        let version = UInt32(
+            littleEndian: try data[versionStart..<versionStart + 4].plainValue(UInt32.self)
+        )
+        guard version == captureVersion else {
+            throw FrameCaptureError.invalidFile("Unsupported capture version \(version)")
+        }
+
+        var frames: [CapturedFrame] = []
+        var offset = data.startIndex + headerSize
+        while offset < data.endIndex {
+            guard data.endIndex - offset >= 4 else {
+                throw FrameCaptureError.invalidFile("Truncated record")
+            }
+            let length = Int(
+                UInt32(littleEndian: try data[offset..<offset + 4].plainValue(UInt32.self))
+            )
+            offset += 4
+            guard data.endIndex - offset >= length else {
+                throw FrameCaptureError.invalidFile("Truncated record")
+            }
+            let record = try decoder.decode(
+                CaptureRecord.self,
+                from: Data(data[offset..<offset + length])
+            )
+            offset += length
+
+            switch record {
+            case .resource(let kind, let id, let data, let width, let height):
+                resources[id] = CapturedResource(
+                    kind: kind,
+                    data: data,
+                    width: width,
+                    height: height
+                )
+            case .displayList(let record):
+                displayLists[record.id] = try decode(record)
+            case .frame(let record):
+                frames.append(
+                    CapturedFrame(
+                        layerTree: LayerTree(root: try decode(record.root)),
+                        physicalSize: ISize(record.width, record.height),
+                        devicePixelRatio: record.devicePixelRatio,
+                        timestamp: .microseconds(record.timestampMicroseconds)
+                    )
+                )
+            }
+        }
+        return frames
+    }
+
+    /// Decodes the resource `id` once and shares it between display lists.
+    private mutating func resource<T>(
+        _ id: Int,
+        _ kind: CaptureResourceKind,
+        decode: (Data) -> T?
+    ) throws -> T {
+        if let resource = decodedResources[id] as? T {
+            return resource
+        }
+        guard let entry = resources[id], entry.kind == kind, let data = entry.data,
+            let resource = decode(data)
+        else {
+            throw FrameCaptureError.unavailableResource(kind: kind.rawValue, id: id)
+        }
+        decodedResources[id] = resource
+        return resource
+    }
+
+    /// Decodes the image `id`, or replaces it by a transparent image of its
+    /// size if it was not captured, such as a texture-backed image.
+    private mutating func image(_ id: Int) throws -> NativeImage {
+        if let image = try? resource(id, .image, decode: codec.decodeImage) {
+            return image
+        }
+        guard let entry = resources[id], entry.kind == .image,
+            let image = codec.makePlaceholderImage(
+                width: entry.width ?? 1,
+                height: entry.height ?? 1
+            )
+        else {
+            throw FrameCaptureError.unavailableResource(kind: "image", id: id)
+        }
+        decodedResources[id] = image
+        return image
+    }
+
+    private mutating func decode(_ record: CapturedDisplayList) throws -> DisplayList {
+        let opBounds = record.opBounds.plainValues(Rect.self)
+        let stateOps = record.stateOps
+        return DisplayList(
+            storage: [UInt8](record.storage),
+            paints: record.paints,
+            paragraphs: try record.paragraphs.map {
+                try resource($0, .paragraph, decode: codec.decodeParagraph)
+            },
+            textBlobs: try record.textBlobs.map {
+                try resource($0, .textBlob, decode: codec.decodeTextBlob)
+            },
+            paths: try record.paths.map {
+                try resource($0, .path, decode: codec.decodePath)
+            },
+            images: try record.images.map { try image($0) },
+            displayLists: try record.displayLists.map { id in
+                guard let displayList = displayLists[id] else {
+                    throw FrameCaptureError.invalidFile("Missing display list \(id)")
+                }
+                return displayList
+            },
+            opCount: record.opCount,
+            uniqueID: DisplayListBuilder.nextUniqueID(),
+            opOffsets: record.opOffsets.plainValues(UInt32.self),
+            opBounds: opBounds,
+            stateOps: stateOps,
+            canApplyGroupOpacity: record.canApplyGroupOpacity,
+            canApplyGroupColorFilter: record.canApplyGroupColorFilter,
+            bounds: try record.bounds?.plainValue(Rect.self),
+            rtree: record.hasRTree
+                ? DisplayListBuilder.buildRTree(opBounds: opBounds, stateOps: stateOps) : nil
+        )
+    }
+
+    private func decode(_ layer: CapturedLayer) throws -> Layer {
+        func container<L: ContainerLayer>(_ result: L, _ children: [CapturedLayer]) throws -> L {
+            for child in children {
+                result.append(try decode(child))
+            }
+            return result
+        }
+
+        switch layer {
+        case .container(let children):
+            return try container(ContainerLayer(), children)
+        case .offset(let offset, let children):
+            return try container(OffsetLayer(offset: try offset.plainValue(Offset.self)), children)
+        case .transform(let transform, let offset, let children):
+            let result = TransformLayer(transform: try transform.plainValue(Matrix4x4f.self))
+            result.offset = try offset.plainValue(Offset.self)
+            return try container(result, children)
+        case .opacity(let alpha, let offset, let children):
+            return try container(
+                OpacityLayer(alpha: alpha, offset: try offset.plainValue(Offset.self)),
+                children
+            )
+        case .clipRect(let rect, let clipBehavior, let children):
+            return try container(
+                ClipRectLayer(clipRect: try rect.plainValue(Rect.self), clipBehavior: clipBehavior),
+                children
+            )
+        case .clipRRect(let rrect, let clipBehavior, let children):
+            return try container(
+                ClipRRectLayer(
+                    clipRRect: try rrect.plainValue(RRect.self),
+                    clipBehavior: clipBehavior
+                ),
+                children
+            )
+        case .colorFilter(let colorFilter, let children):
+            return try container(ColorFilterLayer(colorFilter: colorFilter), children)
+        case .picture(let canvasBounds, let displayListID):
+            let result = PictureLayer(canvasBounds: try canvasBounds.plainValue(Rect.self))
+            if let displayListID {
+                guard let displayList = displayLists[displayListID] else {
+                    throw FrameCaptureError.invalidFile("Missing display list \(displayListID)")
+                }
+                result.picture = displayList
+            }
+            return result
+        }
+    }
+}
@@ -335,6 +335,8 @@ extension TSize where T: Comparable {
     }
 }
 
+extension TSize: Hashable where T: Hashable {}
+
 public typealias Size = TSize<Float>
 
 public typealias ISize = TSize<Int>
@@ -6,32 +6,293 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+import Foundation
 import SwiftMath
 
 /// A place for layers to paint themselves.
 public struct LayerPaintContext {
-    public init(canvas: Canvas) {
+    public init(canvas: Canvas, rasterCache: LayerRasterCache? = nil, cullRect: Rect? = nil) {
         self.canvas = canvas
+        self.rasterCache = rasterCache
+        self.cullRect = cullRect
     }
 
     var canvas: Canvas
+
+    /// Snapshots of layers that have not changed in recent frames. Nil if the
+    /// canvas doesn't support raster caching.
+    var rasterCache: LayerRasterCache?
+
+    /// The visible area of the canvas in the coordinate system of the root
+    /// layer. When set, ``LayerTree/paint(context:)`` prerolls the tree and
+    /// layers found outside of this area are not painted. Nil when all layers
+    /// must be painted, such as when creating a snapshot for the raster cache.
+    var cullRect: Rect?
+
+    /// An opacity that layers apply to everything they paint on behalf of an
+    /// ancestor ``OpacityLayer`` that didn't allocate an offscreen layer. Only
+    /// passed to layers whose ``Layer/canInheritOpacity`` is true.
+    var inheritedOpacity: Float = 1
+
+    /// A color filter that layers add to everything they paint on behalf of
+    /// an ancestor ``ColorFilterLayer`` that didn't allocate an offscreen
+    /// layer. Only passed to layers whose ``Layer/canInheritColorFilter`` is
+    /// true.
+    var inheritedColorFilter: ColorFilter?
+
+    /// Whether layers must apply an inherited effect when painting.
+    var hasInheritedEffects: Bool {
+        inheritedOpacity < 1 || inheritedColorFilter != nil
+    }
+
+    /// Returns this context without inherited effects, for painting into an
+    /// offscreen layer that applies the effects when composited.
+    func withoutInheritedEffects() -> LayerPaintContext {
+        var context = self
+        context.inheritedOpacity = 1
+        context.inheritedColorFilter = nil
+        return context
+    }
+
+    /// Returns a paint that applies the inherited effects when compositing an
+    /// offscreen layer.
+    func inheritedEffectsPaint() -> Paint {
+        var paint = Paint()
+        paint.color = paint.color.withOpacity(inheritedOpacity)
+        paint.colorFilter = inheritedColorFilter
+        return paint
+    }
+}
+
+/// State passed down the layer tree by ``Layer/preroll(context:)``.
+public struct LayerPrerollContext {
+    public init(cullRect: Rect) {
+        self.cullRect = cullRect
+    }
+
+    /// The visible area in the coordinate system of the current layer.
+    public var cullRect: Rect
+
+    /// Returns whether content with the given bounds is at least partly
+    /// inside ``cullRect``.
+    func isVisible(_ bounds: Rect) -> Bool {
+        !bounds.isEmpty && !cullRect.isEmpty && bounds.intersects(cullRect)
+    }
+
+    /// Returns a context whose cull rect is in the coordinate system of
+    /// children that are painted with `transform` applied.
+    func transformed(_ transform: Matrix4x4f) -> LayerPrerollContext {
+        let hasPerspective =
+            transform[0, 3] != 0 || transform[1, 3] != 0 || transform[2, 3] != 0
+            || transform[3, 3] != 1
+        if hasPerspective {
+            // The inverse of a perspective transform may map the cull rect
+            // through the viewer, so don't cull below it.
+            return LayerPrerollContext(cullRect: Self.unboundedCullRect)
+        }
+        let cullRect = MatrixUtils.inverseTransformRect(transform, self.cullRect)
+        if cullRect.hasNaN {
+            // The transform is not invertible, so nothing below it is visible.
+            return LayerPrerollContext(cullRect: .zero)
+        }
+        return LayerPrerollContext(cullRect: cullRect)
+    }
+
+    /// Returns a context whose cull rect is in the coordinate system of
+    /// children that are painted at `offset`.
+    func shifted(_ offset: Offset) -> LayerPrerollContext {
+        LayerPrerollContext(cullRect: cullRect.shift(-offset))
+    }
+
+    /// Returns a context whose cull rect is limited to `clip`.
+    func clipped(_ clip: Rect) -> LayerPrerollContext {
+        let cullRect = cullRect.intersect(clip)
+        return LayerPrerollContext(cullRect: cullRect.isEmpty ? .zero : cullRect)
+    }
+
+    /// A cull rect that contains all content. Finite so that it can be
+    /// transformed like any other rect.
+    static let unboundedCullRect = Rect(left: -1e9, top: -1e9, right: 1e9, bottom: 1e9)
+}
+
+/// Snapshots the output of layers whose content stayed the same over several
+/// frames so that they can be drawn as a single image. Layers that only moved,
+/// for example by a change of ``OffsetLayer/offset`` or
+/// ``TransformLayer/transform`` of themselves or their ancestors, keep their
+/// snapshot.
+///
+/// Renderers provide an implementation through ``DirectCanvas/rasterCache``.
+public protocol LayerRasterCache: AnyObject {
+    /// Draws the content identified by `key` onto `canvas` from its snapshot.
+    /// `key` is a hash of the content of the layer `layerID`. Snapshots are
+    /// only drawn for the layer they were created for, so content of another
+    /// layer with a colliding hash is never drawn in its place.
+    ///
+    /// `bounds` are the bounds of the content in the current coordinate
+    /// system of `canvas`. `paint` paints the content onto the given context
+    /// and is used to create the snapshot. Returns false if no snapshot is
+    /// available, in which case the caller must paint the content itself.
+    func draw(
+        key: Int,
+        layerID: Int,
+        bounds: Rect,
+        canvas: Canvas,
+        paint: (LayerPaintContext) -> Void
+    ) -> Bool
+
+    /// Marks the start of painting a layer tree of UI frame `uiFrame`.
+    /// Snapshots not drawn recently are evicted.
+    ///
+    /// A cache shared by several views is painted to several times per UI
+    /// frame and only advances on the first tree of each frame. A nil
+    /// `uiFrame` always starts a new frame.
+    func beginFrame(_ uiFrame: Int?)
 }
 
 public struct LayerTree {
     let root: Layer
 
-    public init(root: Layer) {
+    /// The frame that produced this tree, for reporting its rasterization
+    /// with ``FrameTimingRecorder/reportRaster(frameNumber:raster:gpuFlush:)``.
+    /// Nil for frames that are not recorded.
+    public let frameNumber: Int?
+
+    /// The UI frame that produced this tree, counted by
+    /// ``RendererBinding/frameCount``. Trees of all views produced by the
+    /// same frame share it. Nil for trees that don't come from the rendering
+    /// pipeline, such as replayed captures.
+    public let uiFrame: Int?
+
+    public init(root: Layer, frameNumber: Int? = nil, uiFrame: Int? = nil) {
         self.root = root
+        self.frameNumber = frameNumber
+        self.uiFrame = uiFrame
     }
 
     public func paint(context: LayerPaintContext) {
+        if let cullRect = context.cullRect {
+            preroll(cullRect: cullRect)
+        }
+        context.rasterCache?.beginFrame(uiFrame)
         root.paint(context: context)
     }
+
+    /// Computes the paint bounds of all layers and marks the layers that are
+    /// completely outside of `cullRect`, given in the coordinate system of
+    /// the root layer.
+    public func preroll(cullRect: Rect) {
+        _ = root.preroll(context: LayerPrerollContext(cullRect: cullRect))
+    }
+
+    /// Returns a copy of this tree that is not affected by later changes to
+    /// its layers, so that it can be painted on another thread while the next
+    /// frame is being built.
+    public func snapshot() -> LayerTree {
+        LayerTree(root: root.snapshot(), frameNumber: frameNumber, uiFrame: uiFrame)
+    }
+
+    /// Whether any layer in the tree has a ``LayerAnimation`` attached.
+    public var hasAnimations: Bool {
+        root.hasAnimations
+    }
+
+    /// Sets every animated layer property to its value at `time`. Returns
+    /// whether any animation is still running, in which case the tree should
+    /// be painted again on the next frame.
+    ///
+    /// Ticking mutates the layers, so views tick a snapshot of the tree
+    /// rather than the layers owned by the UI thread.
+    @discardableResult
+    public func tickAnimations(at time: ContinuousClock.Instant) -> Bool {
+        root.tickAnimations(at: time)
+    }
+}
+
+private var lastLayerID = 0
+
+private let layerIDLock = NSLock()
+
+/// Returns a new identifier for a layer. Layers are mostly created on the UI
+/// thread, but captures can be loaded and replayed on any thread.
+private func nextLayerID() -> Int {
+    layerIDLock.lock()
+    defer { layerIDLock.unlock() }
+    lastLayerID += 1
+    return lastLayerID
+}
+
+/// Records that `layer` is a child of `parent`.
+private func setParent(of layer: Layer, to parent: ContainerLayer?) {
+    if let layer = layer as? ContainerLayer {
+        layer.parent = parent
+    } else if let layer = layer as? PictureLayer {
+        layer.parent = parent
+    }
 }
 
 /// A composited layer.
 public protocol Layer: AnyObject {
+    /// Computes the paint bounds of this layer and its descendants, and
+    /// records for each of them whether it is visible inside
+    /// ``LayerPrerollContext/cullRect``. Returns the paint bounds of this
+    /// layer in the coordinate system of its parent.
+    func preroll(context: LayerPrerollContext) -> Rect
+
+    /// Whether the last ``preroll(context:)`` found this layer at least
+    /// partly visible. Parents skip children that don't need painting when
+    /// the paint context has a cull rect.
+    var needsPainting: Bool { get }
+
     func paint(context: LayerPaintContext)
+
+    /// A conservative estimate of the area this layer paints, in the
+    /// coordinate system of its parent.
+    var paintBounds: Rect { get }
+
+    /// Feeds everything that affects the output of this layer, including its
+    /// own properties and the content of its descendants, into `hasher`.
+    /// Layers that produce the same hash draw the same pixels.
+    func hashContent(into hasher: inout Hasher)
+
+    /// The result of ``hashContent(into:)``. Containers cache it until they
+    /// or one of their descendants change, so nested layers drawn through the
+    /// raster cache don't rehash their subtrees every frame.
+    var contentHash: Int { get }
+
+    /// The container this layer was last appended to, which is notified when
+    /// the content of this layer changes.
+    var parent: ContainerLayer? { get }
+
+    /// Records the areas this layer paints into `context`, applying the same
+    /// transforms and clips as ``paint(context:)``.
+    func diff(context: DiffContext)
+
+    /// Identifies this layer across frames. Snapshots have the same identifier
+    /// as the layer they were created from.
+    var layerID: Int { get }
+
+    /// Returns a copy of this layer and its descendants that is not affected
+    /// by later changes to this layer.
+    func snapshot() -> Layer
+
+    /// Whether this layer can apply ``LayerPaintContext/inheritedOpacity``
+    /// to what it paints, which lets an ancestor ``OpacityLayer`` skip
+    /// allocating an offscreen layer.
+    var canInheritOpacity: Bool { get }
+
+    /// Whether this layer can apply
+    /// ``LayerPaintContext/inheritedColorFilter`` to what it paints, which
+    /// lets an ancestor ``ColorFilterLayer`` skip allocating an offscreen
+    /// layer.
+    var canInheritColorFilter: Bool { get }
+
+    /// Whether this layer or a descendant has a ``LayerAnimation`` attached.
+    var hasAnimations: Bool { get }
+
+    /// Sets the animated properties of this layer and its descendants to
+    /// their values at `time`. Returns whether any animation is still
+    /// running.
+    func tickAnimations(at time: ContinuousClock.Instant) -> Bool
 }
 
 /// A composited layer that has a list of children.
@@ -40,7 +301,15 @@ public protocol Layer: AnyObject {
 /// into the composited rendering in order. There are subclasses of
 /// ``ContainerLayer`` which apply more elaborate effects in the process.
 public class ContainerLayer: Layer {
-    var children: [Layer] = []
+    public init() {}
+
+    public fileprivate(set) var layerID = nextLayerID()
+
+    public fileprivate(set) weak var parent: ContainerLayer?
+
+    var children: [Layer] = [] {
+        didSet { markContentChanged() }
+    }
 
     /// Returns whether this layer has at least one child layer.
     var hasChildren: Bool {
@@ -48,22 +317,204 @@ public class ContainerLayer: Layer {
     }
 
     public func removeAllChildren() {
+        for child in children where child.parent === self {
+            setParent(of: child, to: nil)
+        }
         children.removeAll()
     }
 
     public func append(_ child: Layer) {
+        child.parent?.markContentChanged()
+        setParent(of: child, to: self)
         children.append(child)
     }
 
+    /// The hash of ``hashContent(into:)``, or nil if this layer or one of its
+    /// descendants changed since it was last computed.
+    private var cachedContentHash: Int?
+
+    public var contentHash: Int {
+        if let cachedContentHash {
+            return cachedContentHash
+        }
+        var hasher = Hasher()
+        hashContent(into: &hasher)
+        let hash = hasher.finalize()
+        cachedContentHash = hash
+        return hash
+    }
+
+    /// Drops the cached ``contentHash`` of this layer and its ancestors.
+    /// Subclasses call this when a property that affects
+    /// ``hashContent(into:)`` changes.
+    func markContentChanged() {
+        // Ancestors can only have cached a hash after this layer did.
+        if cachedContentHash == nil {
+            return
+        }
+        cachedContentHash = nil
+        parent?.markContentChanged()
+    }
+
+    public private(set) var needsPainting = true
+
+    /// Prerolls all children and returns the union of their paint bounds.
+    func prerollChildren(context: LayerPrerollContext) -> Rect {
+        var bounds: Rect?
+        for child in children {
+            let childBounds = child.preroll(context: context)
+            bounds = bounds?.union(childBounds) ?? childBounds
+        }
+        return bounds ?? .zero
+    }
+
+    /// Records whether `bounds`, the paint bounds of this layer, are visible
+    /// in `context` and returns them.
+    func finishPreroll(_ bounds: Rect, _ context: LayerPrerollContext) -> Rect {
+        needsPainting = context.isVisible(bounds)
+        return bounds
+    }
+
+    public func preroll(context: LayerPrerollContext) -> Rect {
+        finishPreroll(prerollChildren(context: context), context)
+    }
+
+    /// Containers with more children than this don't check their children
+    /// for overlap and never inherit effects.
+    static let maxInheritingChildCount = 16
+
+    /// Returns whether the children don't overlap each other and each of
+    /// them can inherit the given effects. Painting each child with an
+    /// effect then gives the same result as painting them into a layer and
+    /// compositing it with the effect.
+    func childrenCanInherit(opacity: Bool, colorFilter: Bool) -> Bool {
+        if children.count > Self.maxInheritingChildCount {
+            return false
+        }
+        var childBounds: [Rect] = []
+        for child in children {
+            if (opacity && !child.canInheritOpacity)
+                || (colorFilter && !child.canInheritColorFilter)
+            {
+                return false
+            }
+            let bounds = child.paintBounds
+            if childBounds.contains(where: { $0.intersects(bounds) }) {
+                return false
+            }
+            childBounds.append(bounds)
+        }
+        return true
+    }
+
+    public var canInheritOpacity: Bool {
+        childrenCanInherit(opacity: true, colorFilter: false)
+    }
+
+    public var canInheritColorFilter: Bool {
+        childrenCanInherit(opacity: false, colorFilter: true)
+    }
+
+    public var hasAnimations: Bool {
+        children.contains { $0.hasAnimations }
+    }
+
+    public func tickAnimations(at time: ContinuousClock.Instant) -> Bool {
+        var isRunning = false
+        for child in children where child.tickAnimations(at: time) {
+            isRunning = true
+        }
+        return isRunning
+    }
+
     func paintChildren(context: LayerPaintContext) {
         for child in children {
+            if context.cullRect != nil && !child.needsPainting {
+                continue
+            }
             child.paint(context: context)
         }
     }
 
+    /// Paints the children from a snapshot in the raster cache of `context`
+    /// if they have not changed recently, or paints them directly otherwise.
+    func paintChildrenWithRasterCache(context: LayerPaintContext) {
+        if let rasterCache = context.rasterCache, hasChildren, !context.hasInheritedEffects {
+            var hasher = Hasher()
+            hashChildren(into: &hasher)
+            let drawn = rasterCache.draw(
+                key: hasher.finalize(),
+                layerID: layerID,
+                bounds: childPaintBounds,
+                canvas: context.canvas,
+                paint: { paintChildren(context: $0) }
+            )
+            if drawn {
+                return
+            }
+        }
+        paintChildren(context: context)
+    }
+
     public func paint(context: LayerPaintContext) {
         paintChildren(context: context)
     }
+
+    /// The union of the paint bounds of all children.
+    var childPaintBounds: Rect {
+        var bounds: Rect?
+        for child in children {
+            bounds = bounds?.union(child.paintBounds) ?? child.paintBounds
+        }
+        return bounds ?? .zero
+    }
+
+    public var paintBounds: Rect {
+        childPaintBounds
+    }
+
+    func hashChildren(into hasher: inout Hasher) {
+        for child in children {
+            hasher.combine(child.layerID)
+            hasher.combine(child.contentHash)
+        }
+    }
+
+    public func hashContent(into hasher: inout Hasher) {
+        hashChildren(into: &hasher)
+    }
+
+    func diffChildren(context: DiffContext) {
+        context.withChildren {
+            for child in children {
+                child.diff(context: context)
+            }
+        }
+    }
+
+    public func diff(context: DiffContext) {
+        diffChildren(context: context)
+    }
+
+    /// Gives `copy` the identity of this layer and snapshots of its children.
+    /// Subclasses call this from ``snapshot()`` after copying their own
+    /// properties.
+    ///
+    /// The content hash is computed here, on the thread that owns this layer,
+    /// so that it stays cached across frames and the copy does not need to
+    /// compute it again.
+    func snapshotChildren<T: ContainerLayer>(into copy: T) -> T {
+        copy.layerID = layerID
+        for child in children {
+            copy.append(child.snapshot())
+        }
+        copy.cachedContentHash = contentHash
+        return copy
+    }
+
+    public func snapshot() -> Layer {
+        snapshotChildren(into: ContainerLayer())
+    }
 }
 
 /// A layer that is displayed at an offset from its parent layer.
@@ -80,14 +531,61 @@ public class OffsetLayer: ContainerLayer {
         self.offset = offset
     }
 
-    public var offset: Offset
+    public var offset: Offset {
+        didSet { markContentChanged() }
+    }
 
+    /// Animates ``offset`` in the compositor. While attached, the animation
+    /// overrides the offset set by the UI thread.
+    public var offsetAnimation: LayerAnimation<Offset>?
+
+    public override var hasAnimations: Bool {
+        offsetAnimation != nil || super.hasAnimations
+    }
+
+    public override func tickAnimations(at time: ContinuousClock.Instant) -> Bool {
+        var isRunning = super.tickAnimations(at: time)
+        if let offsetAnimation {
+            offset = offsetAnimation.value(at: time)
+            isRunning = isRunning || !offsetAnimation.isCompleted(at: time)
+        }
+        return isRunning
+    }
+
+    /// Children of offset layers are drawn through the raster cache, so a
+    /// repaint boundary that only moved is drawn as a single image.
     public override func paint(context: LayerPaintContext) {
         context.canvas.save()
         context.canvas.translate(offset.dx, offset.dy)
-        super.paint(context: context)
+        paintChildrenWithRasterCache(context: context)
         context.canvas.restore()
     }
+
+    public override func preroll(context: LayerPrerollContext) -> Rect {
+        let childBounds = prerollChildren(context: context.shifted(offset))
+        return finishPreroll(childBounds.shift(offset), context)
+    }
+
+    public override var paintBounds: Rect {
+        childPaintBounds.shift(offset)
+    }
+
+    public override func hashContent(into hasher: inout Hasher) {
+        hasher.combine(offset)
+        super.hashContent(into: &hasher)
+    }
+
+    public override func diff(context: DiffContext) {
+        context.withTransform(Matrix4x4f.translate(tx: offset.dx, ty: offset.dy, tz: 0)) {
+            diffChildren(context: context)
+        }
+    }
+
+    public override func snapshot() -> Layer {
+        let copy = OffsetLayer(offset: offset)
+        copy.offsetAnimation = offsetAnimation
+        return snapshotChildren(into: copy)
+    }
 }
 
 /// A composited layer that applies a given transformation matrix to its
@@ -100,18 +598,74 @@ public class TransformLayer: OffsetLayer {
         self.transform = transform
     }
 
-    public var transform: Matrix4x4f
+    public var transform: Matrix4x4f {
+        didSet { markContentChanged() }
+    }
 
-    public override func paint(context: LayerPaintContext) {
-        let effectiveTransform =
-            offset == Offset.zero
+    /// Animates ``transform`` in the compositor. While attached, the
+    /// animation overrides the transform set by the UI thread.
+    public var transformAnimation: LayerAnimation<Matrix4x4f>?
+
+    public override var hasAnimations: Bool {
+        transformAnimation != nil || super.hasAnimations
+    }
+
+    public override func tickAnimations(at time: ContinuousClock.Instant) -> Bool {
+        var isRunning = super.tickAnimations(at: time)
+        if let transformAnimation {
+            transform = transformAnimation.value(at: time)
+            isRunning = isRunning || !transformAnimation.isCompleted(at: time)
+        }
+        return isRunning
+    }
+
+    /// The transform applied to the canvas, including the offset.
+    private var effectiveTransform: Matrix4x4f {
+        offset == Offset.zero
             ? transform
             : Matrix4x4f.translate(tx: offset.dx, ty: offset.dy, tz: 0) * transform
+    }
+
+    public override func paint(context: LayerPaintContext) {
         context.canvas.save()
         context.canvas.transform(effectiveTransform)
         super.paint(context: context)
         context.canvas.restore()
     }
+
+    public override func preroll(context: LayerPrerollContext) -> Rect {
+        // Children are painted with the effective transform followed by the
+        // offset applied by the superclass.
+        let childContext = context.transformed(effectiveTransform).shifted(offset)
+        let childBounds = prerollChildren(context: childContext)
+        return finishPreroll(
+            MatrixUtils.transformRect(effectiveTransform, childBounds.shift(offset)),
+            context
+        )
+    }
+
+    public override var paintBounds: Rect {
+        MatrixUtils.transformRect(effectiveTransform, childPaintBounds.shift(offset))
+    }
+
+    public override func hashContent(into hasher: inout Hasher) {
+        hasher.combine(transform)
+        super.hashContent(into: &hasher)
+    }
+
+    public override func diff(context: DiffContext) {
+        context.withTransform(effectiveTransform) {
+            super.diff(context: context)
+        }
+    }
+
+    public override func snapshot() -> Layer {
+        let copy = TransformLayer(transform: transform)
+        copy.offset = offset
+        copy.offsetAnimation = offsetAnimation
+        copy.transformAnimation = transformAnimation
+        return snapshotChildren(into: copy)
+    }
 }
 
 /// A composited layer containing a ``DisplayList``.
@@ -120,17 +674,100 @@ public class TransformLayer: OffsetLayer {
 public class PictureLayer: Layer {
     let canvasBounds: Rect
 
-    var picture: DisplayList?
+    var picture: DisplayList? {
+        didSet { parent?.markContentChanged() }
+    }
+
+    public private(set) var layerID = nextLayerID()
+
+    public fileprivate(set) weak var parent: ContainerLayer?
+
+    public private(set) var needsPainting = true
 
     public init(canvasBounds: Rect) {
         self.canvasBounds = canvasBounds
     }
 
+    /// Pictures with fewer ops than this are cheap enough to replay that
+    /// snapshotting them is not worth the memory.
+    static let minRasterCacheOpCount = 32
+
     public func paint(context: LayerPaintContext) {
+        guard let picture else {
+            return
+        }
+        if context.hasInheritedEffects {
+            picture.dispatch(
+                to: InheritedEffectsReceiver(
+                    context.canvas,
+                    opacity: context.inheritedOpacity,
+                    colorFilter: context.inheritedColorFilter
+                )
+            )
+            return
+        }
+        if let rasterCache = context.rasterCache, picture.opCount >= Self.minRasterCacheOpCount {
+            let drawn = rasterCache.draw(
+                key: contentHash,
+                layerID: layerID,
+                bounds: canvasBounds,
+                canvas: context.canvas,
+                paint: { $0.canvas.drawDisplayList(picture) }
+            )
+            if drawn {
+                return
+            }
+        }
+        context.canvas.drawDisplayList(picture)
+    }
+
+    public func preroll(context: LayerPrerollContext) -> Rect {
+        let bounds = paintBounds
+        needsPainting = picture != nil && context.isVisible(bounds)
+        return bounds
+    }
+
+    /// The area drawn by the picture, or ``canvasBounds`` if the picture
+    /// draws an unknown area.
+    public var paintBounds: Rect {
+        picture?.bounds ?? canvasBounds
+    }
+
+    public var canInheritOpacity: Bool {
+        picture?.canApplyGroupOpacity ?? true
+    }
+
+    public var canInheritColorFilter: Bool {
+        picture?.canApplyGroupColorFilter ?? true
+    }
+
+    public var hasAnimations: Bool { false }
+
+    public func tickAnimations(at time: ContinuousClock.Instant) -> Bool { false }
+
+    public func hashContent(into hasher: inout Hasher) {
+        hasher.combine(picture?.uniqueID)
+    }
+
+    /// Not cached since hashing the picture is as cheap as a lookup.
+    public var contentHash: Int {
+        var hasher = Hasher()
+        hashContent(into: &hasher)
+        return hasher.finalize()
+    }
+
+    public func diff(context: DiffContext) {
         if let picture {
-            context.canvas.drawDisplayList(picture)
+            context.addPaint(key: Int(truncatingIfNeeded: picture.uniqueID), bounds: paintBounds)
         }
     }
+
+    public func snapshot() -> Layer {
+        let copy = PictureLayer(canvasBounds: canvasBounds)
+        copy.layerID = layerID
+        copy.picture = picture?.snapshot()
+        return copy
+    }
 }
 
 /// A composite layer that clips its children using a rectangle.
@@ -141,12 +778,16 @@ public class ClipRectLayer: ContainerLayer {
     }
 
     /// The rectangle to clip in the parent's coordinate system.
-    public var clipRect: Rect
+    public var clipRect: Rect {
+        didSet { markContentChanged() }
+    }
 
     /// Controls how to clip.
     ///
     /// Must not be set to null or ``Clip/none``.
-    public var clipBehavior: Clip = .hardEdge
+    public var clipBehavior: Clip = .hardEdge {
+        didSet { markContentChanged() }
+    }
 
     public override func paint(context: LayerPaintContext) {
         context.canvas.save()
@@ -160,6 +801,34 @@ public class ClipRectLayer: ContainerLayer {
         }
         context.canvas.restore()
     }
+
+    public override func preroll(context: LayerPrerollContext) -> Rect {
+        let childBounds = prerollChildren(context: context.clipped(clipRect))
+        return finishPreroll(childBounds.intersect(clipRect), context)
+    }
+
+    public override var paintBounds: Rect {
+        childPaintBounds.intersect(clipRect)
+    }
+
+    public override func hashContent(into hasher: inout Hasher) {
+        hasher.combine(clipRect)
+        hasher.combine(clipBehavior)
+        super.hashContent(into: &hasher)
+    }
+
+    public override func diff(context: DiffContext) {
+        var hasher = Hasher()
+        hasher.combine(clipRect)
+        hasher.combine(clipBehavior)
+        context.withClip(clipRect, key: hasher.finalize()) {
+            diffChildren(context: context)
+        }
+    }
+
+    public override func snapshot() -> Layer {
+        snapshotChildren(into: ClipRectLayer(clipRect: clipRect, clipBehavior: clipBehavior))
+    }
 }
 
 /// A composite layer that clips its children using a rounded rectangle.
@@ -170,12 +839,16 @@ public class ClipRRectLayer: ContainerLayer {
     }
 
     /// The rounded rectangle to clip in the parent's coordinate system.
-    public var clipRRect: RRect
+    public var clipRRect: RRect {
+        didSet { markContentChanged() }
+    }
 
     /// Controls how to clip.
     ///
     /// Must not be set to null or ``Clip/none``.
-    public var clipBehavior: Clip = .hardEdge
+    public var clipBehavior: Clip = .hardEdge {
+        didSet { markContentChanged() }
+    }
 
     public override func paint(context: LayerPaintContext) {
         context.canvas.save()
@@ -189,4 +862,331 @@ public class ClipRRectLayer: ContainerLayer {
         }
         context.canvas.restore()
     }
+
+    public override func preroll(context: LayerPrerollContext) -> Rect {
+        let childBounds = prerollChildren(context: context.clipped(clipRRect.outerRect))
+        return finishPreroll(childBounds.intersect(clipRRect.outerRect), context)
+    }
+
+    public override var paintBounds: Rect {
+        childPaintBounds.intersect(clipRRect.outerRect)
+    }
+
+    public override func hashContent(into hasher: inout Hasher) {
+        hasher.combine(clipRRect)
+        hasher.combine(clipBehavior)
+        super.hashContent(into: &hasher)
+    }
+
+    public override func diff(context: DiffContext) {
+        var hasher = Hasher()
+        hasher.combine(clipRRect)
+        hasher.combine(clipBehavior)
+        context.withClip(clipRRect.outerRect, key: hasher.finalize()) {
+            diffChildren(context: context)
+        }
+    }
+
+    public override func snapshot() -> Layer {
+        snapshotChildren(into: ClipRRectLayer(clipRRect: clipRRect, clipBehavior: clipBehavior))
+    }
+}
+
+/// A composited layer that makes its children partially transparent.
+///
+/// When the children don't overlap and can all apply an opacity to what they
+/// paint, such as a single picture whose ops don't overlap, the opacity is
+/// passed down to them. Otherwise the children are painted into an offscreen
+/// layer that is composited with the opacity.
+public class OpacityLayer: OffsetLayer {
+    public init(alpha: UInt8 = 255, offset: Offset = Offset.zero) {
+        self.alpha = alpha
+        super.init(offset: offset)
+    }
+
+    /// The amount to multiply into the alpha channel.
+    ///
+    /// The opacity is expressed as an integer from 0 to 255, where 0 is fully
+    /// transparent and 255 is fully opaque.
+    public var alpha: UInt8 {
+        didSet { markContentChanged() }
+    }
+
+    /// Animates ``alpha`` in the compositor. While attached, the animation
+    /// overrides the alpha set by the UI thread.
+    public var alphaAnimation: LayerAnimation<UInt8>?
+
+    public override var hasAnimations: Bool {
+        alphaAnimation != nil || super.hasAnimations
+    }
+
+    public override func tickAnimations(at time: ContinuousClock.Instant) -> Bool {
+        var isRunning = super.tickAnimations(at: time)
+        if let alphaAnimation {
+            alpha = alphaAnimation.value(at: time)
+            isRunning = isRunning || !alphaAnimation.isCompleted(at: time)
+        }
+        return isRunning
+    }
+
+    public override func paint(context: LayerPaintContext) {
+        if alpha == 0 {
+            return
+        }
+
+        let opacity = context.inheritedOpacity * Float(alpha) / 255
+        let needsOpacity = opacity < 1
+        let needsColorFilter = context.inheritedColorFilter != nil
+
+        context.canvas.save()
+        context.canvas.translate(offset.dx, offset.dy)
+        if (!needsOpacity && !needsColorFilter)
+            || childrenCanInherit(opacity: needsOpacity, colorFilter: needsColorFilter)
+        {
+            var childContext = context
+            childContext.inheritedOpacity = opacity
+            paintChildrenWithRasterCache(context: childContext)
+        } else {
+            var paint = context.inheritedEffectsPaint()
+            paint.color = paint.color.withOpacity(opacity)
+            context.canvas.saveLayer(childPaintBounds, paint: paint)
+            paintChildrenWithRasterCache(context: context.withoutInheritedEffects())
+            context.canvas.restore()
+        }
+        context.canvas.restore()
+    }
+
+    /// Opacity layers fall back to an offscreen layer that applies inherited
+    /// effects when their children can't inherit them.
+    public override var canInheritOpacity: Bool { true }
+
+    public override var canInheritColorFilter: Bool { true }
+
+    public override func hashContent(into hasher: inout Hasher) {
+        hasher.combine(alpha)
+        super.hashContent(into: &hasher)
+    }
+
+    public override func diff(context: DiffContext) {
+        context.withEffect(key: Int(alpha)) {
+            super.diff(context: context)
+        }
+    }
+
+    public override func snapshot() -> Layer {
+        let copy = OpacityLayer(alpha: alpha, offset: offset)
+        copy.offsetAnimation = offsetAnimation
+        copy.alphaAnimation = alphaAnimation
+        return snapshotChildren(into: copy)
+    }
+}
+
+/// A composited layer that applies a ``ColorFilter`` to its children.
+///
+/// Like ``OpacityLayer``, the filter is added to the paints of the children
+/// when they don't overlap, and applied to an offscreen layer otherwise.
+public class ColorFilterLayer: ContainerLayer {
+    public init(colorFilter: ColorFilter) {
+        self.colorFilter = colorFilter
+    }
+
+    /// The color filter to apply when compositing this layer.
+    public var colorFilter: ColorFilter {
+        didSet { markContentChanged() }
+    }
+
+    public override func paint(context: LayerPaintContext) {
+        // Parents never pass inherited effects since this layer can't inherit
+        // them.
+        assert(!context.hasInheritedEffects)
+
+        if !colorFilter.modifiesTransparentBlack
+            && childrenCanInherit(opacity: false, colorFilter: true)
+        {
+            var childContext = context
+            childContext.inheritedColorFilter = colorFilter
+            paintChildren(context: childContext)
+        } else {
+            var paint = Paint()
+            paint.colorFilter = colorFilter
+            context.canvas.saveLayer(childPaintBounds, paint: paint)
+            paintChildren(context: context)
+            context.canvas.restore()
+        }
+    }
+
+    /// An opacity of an ancestor must be applied after the filter, but a
+    /// paint applies its opacity before its color filter. Any opacity
+    /// inherited together with a color filter therefore comes from a
+    /// descendant, which ``InheritedEffectsReceiver`` relies on.
+    public override var canInheritOpacity: Bool { false }
+
+    /// Paints can only hold a single color filter.
+    public override var canInheritColorFilter: Bool { false }
+
+    public override func hashContent(into hasher: inout Hasher) {
+        hasher.combine(colorFilter)
+        super.hashContent(into: &hasher)
+    }
+
+    public override func diff(context: DiffContext) {
+        context.withEffect(key: colorFilter.hashValue) {
+            diffChildren(context: context)
+        }
+    }
+
+    public override func snapshot() -> Layer {
+        snapshotChildren(into: ColorFilterLayer(colorFilter: colorFilter))
+    }
+}
+
+/// Forwards ops to a canvas with an inherited opacity and color filter
+/// applied to every paint. The opacity is applied first, since it comes from
+/// layers below the ``ColorFilterLayer``.
+private final class InheritedEffectsReceiver: DlOpReceiver {
+    init(_ canvas: Canvas, opacity: Float, colorFilter: ColorFilter?) {
+        self.canvas = canvas
+        self.opacity = opacity
+        self.colorFilter = colorFilter
+    }
+
+    private let canvas: Canvas
+
+    private let opacity: Float
+
+    private let colorFilter: ColorFilter?
+
+    private func apply(_ paint: Paint) -> Paint {
+        var paint = paint
+        if opacity < 1 {
+            paint.color = paint.color.withAlpha(UInt8((Float(paint.color.alpha) * opacity).rounded()))
+        }
+        if let colorFilter {
+            paint.colorFilter = colorFilter
+        }
+        return paint
+    }
+
+    func drawDisplayList(_ displayList: DisplayList) {
+        displayList.dispatch(to: self)
+    }
+
+    func save() {
+        canvas.save()
+    }
+
+    func saveLayer(_ bounds: Rect, paint: Paint?) {
+        canvas.saveLayer(bounds, paint: paint.map(apply))
+    }
+
+    func restore() {
+        canvas.restore()
+    }
+
+    func translate(_ dx: Float, _ dy: Float) {
+        canvas.translate(dx, dy)
+    }
+
+    func scale(_ sx: Float, _ sy: Float) {
+        canvas.scale(sx, sy)
+    }
+
+    func rotate(_ radians: Float) {
+        canvas.rotate(radians)
+    }
+
+    func transform(_ transform: Matrix4x4f) {
+        canvas.transform(transform)
+    }
+
+    func clipRect(_ rect: Rect, _ clipOp: ClipOp, _ doAntiAlias: Bool) {
+        canvas.clipRect(rect, clipOp, doAntiAlias)
+    }
+
+    func clipRRect(_ rrect: RRect, _ doAntiAlias: Bool) {
+        canvas.clipRRect(rrect, doAntiAlias)
+    }
+
+    func drawLine(_ p0: Offset, _ p1: Offset, _ paint: Paint) {
+        canvas.drawLine(p0, p1, apply(paint))
+    }
+
+    func drawRect(_ rect: Rect, _ paint: Paint) {
+        canvas.drawRect(rect, apply(paint))
+    }
+
+    func drawRRect(_ rrect: RRect, _ paint: Paint) {
+        canvas.drawRRect(rrect, apply(paint))
+    }
+
+    func drawDRRect(_ outer: RRect, _ inner: RRect, _ paint: Paint) {
+        canvas.drawDRRect(outer, inner, apply(paint))
+    }
+
+    func drawCircle(_ center: Offset, _ radius: Float, _ paint: Paint) {
+        canvas.drawCircle(center, radius, apply(paint))
+    }
+
+    func drawPath(_ path: Path, _ paint: Paint) {
+        canvas.drawPath(path, apply(paint))
+    }
+
+    func drawImage(_ image: NativeImage, _ offset: Offset, _ paint: Paint) {
+        canvas.drawImage(image, offset, apply(paint))
+    }
+
+    func drawImageRect(_ image: NativeImage, _ src: Rect, _ dst: Rect, _ paint: Paint) {
+        canvas.drawImageRect(image, src, dst, apply(paint))
+    }
+
+    func drawImageNine(_ image: NativeImage, _ center: Rect, _ dst: Rect, _ paint: Paint) {
+        canvas.drawImageNine(image, center, dst, apply(paint))
+    }
+
+    func drawParagraph(_ paragraph: Paragraph, _ offset: Offset) {
+        // Display lists with paragraphs can't apply group effects.
+        canvas.drawParagraph(paragraph, offset)
+    }
+
+    func drawTextBlob(_ blob: TextBlob, _ offset: Offset, _ paint: Paint) {
+        canvas.drawTextBlob(blob, offset, apply(paint))
+    }
+
+    func clear(color: Color) {
+        canvas.clear(color: color)
+    }
+}
+
+extension Hasher {
+    fileprivate mutating func combine(_ offset: Offset) {
+        combine(offset.dx)
+        combine(offset.dy)
+    }
+
+    fileprivate mutating func combine(_ rect: Rect) {
+        combine(rect.left)
+        combine(rect.top)
+        combine(rect.right)
+        combine(rect.bottom)
+    }
+
+    fileprivate mutating func combine(_ rrect: RRect) {
+        combine(rrect.outerRect)
+        combine(rrect.tlRadiusX)
+        combine(rrect.tlRadiusY)
+        combine(rrect.trRadiusX)
+        combine(rrect.trRadiusY)
+        combine(rrect.brRadiusX)
+        combine(rrect.brRadiusY)
+        combine(rrect.blRadiusX)
+        combine(rrect.blRadiusY)
+    }
+
+    fileprivate mutating func combine(_ matrix: Matrix4x4f) {
+        for column in 0..<4 {
+            for row in 0..<4 {
+                combine(matrix[column, row])
+            }
+        }
+    }
 }
@@ -0,0 +1,122 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import SwiftMath
+
+/// A layer property that can be animated by the compositor.
+public protocol LayerAnimatable {
+    /// Returns the value a fraction `t` of the way from this value to `end`.
+    func interpolated(to end: Self, _ t: Float) -> Self
+}
+
+extension Offset: LayerAnimatable {
+    public func interpolated(to end: Offset, _ t: Float) -> Offset {
+        self + (end - self) * t
+    }
+}
+
+extension UInt8: LayerAnimatable {
+    public func interpolated(to end: UInt8, _ t: Float) -> UInt8 {
+        UInt8(lerpFloat(Float(self), Float(end), t: t).rounded().clamped(to: 0...255))
+    }
+}
+
+extension Matrix4x4f: LayerAnimatable {
+    /// Interpolates each entry of the matrix. This is exact for translations
+    /// and scales, but rotations between the two matrices pass through skewed
+    /// and shrunk states, so prefer small rotation steps.
+    public func interpolated(to end: Matrix4x4f, _ t: Float) -> Matrix4x4f {
+        var result = self
+        for column in 0..<4 {
+            for row in 0..<4 {
+                result[column, row] = lerpFloat(self[column, row], end[column, row], t: t)
+            }
+        }
+        return result
+    }
+}
+
+/// An animation of a layer property that is evaluated by the compositor on
+/// every frame it rasterizes, without running build, layout or paint.
+///
+/// Attach an animation to a layer, such as ``OffsetLayer/offsetAnimation``,
+/// and submit the layer tree once, for example with
+/// ``RenderObject/markNeedsCompositedLayerUpdate()``. Views keep rasterizing
+/// the last submitted tree until all of its animations have completed, even
+/// while the UI thread is busy.
+///
+/// The animation only depends on the time, so the same animation painted by
+/// a later frame from the UI thread continues where the compositor left off.
+public struct LayerAnimation<Value: LayerAnimatable> {
+    /// What happens when an animation reaches its end.
+    public enum RepeatMode {
+        /// Stop at the end value.
+        case none
+
+        /// Jump back to the begin value and run again, forever.
+        case restart
+
+        /// Run back to the begin value and forth again, forever.
+        case reverse
+    }
+
+    public init(
+        from begin: Value,
+        to end: Value,
+        duration: Duration,
+        curve: Curve = Curves.linear,
+        repeatMode: RepeatMode = .none,
+        startTime: ContinuousClock.Instant = .now
+    ) {
+        assert(duration > .zero)
+        self.begin = begin
+        self.end = end
+        self.duration = duration
+        self.curve = curve
+        self.repeatMode = repeatMode
+        self.startTime = startTime
+    }
+
+    /// The value at ``startTime``.
+    public let begin: Value
+
+    /// The value after ``duration``.
+    public let end: Value
+
+    /// The time to run from ``begin`` to ``end``.
+    public let duration: Duration
+
+    /// The easing curve applied to the progress of the animation.
+    public let curve: Curve
+
+    public let repeatMode: RepeatMode
+
+    /// The time at which the animation is at ``begin``. Earlier times also
+    /// evaluate to ``begin``.
+    public let startTime: ContinuousClock.Instant
+
+    /// Whether the animation has reached its final value at `time`. Repeating
+    /// animations never complete.
+    public func isCompleted(at time: ContinuousClock.Instant) -> Bool {
+        repeatMode == .none && time - startTime >= duration
+    }
+
+    /// Returns the value of the animated property at `time`.
+    public func value(at time: ContinuousClock.Instant) -> Value {
+        let elapsed = max(time - startTime, .zero)
+        var progress = elapsed / duration
+        switch repeatMode {
+        case .none:
+            progress = min(progress, 1)
+        case .restart:
+            progress = progress.truncatingRemainder(dividingBy: 1)
+        case .reverse:
+            progress = progress.truncatingRemainder(dividingBy: 2)
+            if progress > 1 {
+                progress = 2 - progress
+            }
+        }
+        return begin.interpolated(to: end, Float(curve.transform(progress)))
+    }
+}
@@ -0,0 +1,173 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import SwiftMath
+
+/// Collects the areas painted by the layers of a tree in device space, so that
+/// two frames can be compared by ``DamageTracker``.
+///
+/// Each painted area is recorded with a key that identifies everything that
+/// affects its pixels: the content, the transforms and clips of its ancestors,
+/// and the area painted before it in the same container. Areas whose key
+/// appears in only one of two frames are damaged.
+public final class DiffContext {
+    init(bounds: Rect) {
+        self.clipBounds = bounds
+    }
+
+    /// The transform from the coordinate system of the current layer to
+    /// device pixels.
+    private(set) var transform = Matrix4x4f.identity
+
+    /// The bounds of the current clip in device pixels.
+    private(set) var clipBounds: Rect
+
+    /// A hash of the transforms and clips of the ancestors of the current
+    /// layer.
+    private var state = 0
+
+    /// The key of the area most recently painted.
+    private var previousKey = 0
+
+    /// Painted areas in device pixels keyed by everything that affects their
+    /// pixels.
+    private(set) var records: [Int: Rect] = [:]
+
+    /// Calls `body` with `transform` applied on top of the current transform.
+    public func withTransform(_ transform: Matrix4x4f, _ body: () -> Void) {
+        let saved = (self.transform, state)
+        self.transform = self.transform * transform
+        state = combine(state, transform)
+        body()
+        (self.transform, state) = saved
+    }
+
+    /// Calls `body` with an effect identified by `key`, such as an opacity,
+    /// applied to everything painted in it.
+    public func withEffect(key: Int, _ body: () -> Void) {
+        let saved = state
+        state = combine(state, key)
+        body()
+        state = saved
+    }
+
+    /// Calls `body` with the current clip intersected with `rect`, given in
+    /// the coordinate system of the current layer. `key` identifies the kind
+    /// of clip, such as the shape of a rounded rectangle.
+    public func withClip(_ rect: Rect, key: Int, _ body: () -> Void) {
+        let saved = (clipBounds, state)
+        clipBounds = clipBounds.intersect(MatrixUtils.transformRect(transform, rect))
+        state = combine(state, key)
+        if !clipBounds.isEmpty {
+            body()
+        }
+        (clipBounds, state) = saved
+    }
+
+    /// Records that content identified by `key` paints `bounds`, given in
+    /// the coordinate system of the current layer.
+    public func addPaint(key: Int, bounds: Rect) {
+        let deviceBounds = MatrixUtils.transformRect(transform, bounds).intersect(clipBounds)
+        if deviceBounds.isEmpty || deviceBounds.hasNaN {
+            return
+        }
+        var hasher = Hasher()
+        hasher.combine(state)
+        hasher.combine(key)
+        hasher.combine(previousKey)
+        let recordKey = hasher.finalize()
+        records[recordKey] = deviceBounds
+        previousKey = recordKey
+    }
+
+    /// Calls `body` for the children of a container. The order of areas is
+    /// only tracked within the same container, so inserting a layer does not
+    /// damage everything painted after its container.
+    public func withChildren(_ body: () -> Void) {
+        let saved = previousKey
+        previousKey = state
+        body()
+        previousKey = saved
+    }
+
+    private func combine(_ state: Int, _ key: Int) -> Int {
+        var hasher = Hasher()
+        hasher.combine(state)
+        hasher.combine(key)
+        return hasher.finalize()
+    }
+
+    private func combine(_ state: Int, _ matrix: Matrix4x4f) -> Int {
+        var hasher = Hasher()
+        hasher.combine(state)
+        for column in 0..<4 {
+            for row in 0..<4 {
+                hasher.combine(matrix[column, row])
+            }
+        }
+        return hasher.finalize()
+    }
+}
+
+/// Computes the area of a view that changed since the previous frame by
+/// diffing the layer trees of the two frames.
+///
+/// Renderers whose canvas keeps its content between frames (see
+/// ``DirectCanvas/preservesContents``) only need to repaint the damaged area.
+public final class DamageTracker {
+    public init() {}
+
+    private var previousRecords: [Int: Rect]?
+
+    private var previousSize: ISize?
+
+    /// Returns the area of `layerTree` in physical pixels that differs from
+    /// the layer tree passed to the previous call. The whole view is damaged
+    /// on the first frame, after a resize and after ``reset()``. An empty
+    /// rect means that nothing changed.
+    public func computeDamage(_ layerTree: LayerTree, size: ISize) -> Rect {
+        let bounds = Rect(left: 0, top: 0, right: Float(size.width), bottom: Float(size.height))
+
+        let context = DiffContext(bounds: bounds)
+        layerTree.root.diff(context: context)
+        let records = context.records
+
+        defer {
+            previousRecords = records
+            previousSize = size
+        }
+
+        guard let previousRecords, previousSize == size else {
+            return bounds
+        }
+
+        var damage: Rect?
+        for (key, rect) in records where previousRecords[key] == nil {
+            damage = damage?.union(rect) ?? rect
+        }
+        for (key, rect) in previousRecords where records[key] == nil {
+            damage = damage?.union(rect) ?? rect
+        }
+
+        guard let damage else {
+            return .zero
+        }
+
+        // Clip to whole pixels so that no partially covered pixel is left
+        // stale.
+        return Rect(
+            left: damage.left.rounded(.down),
+            top: damage.top.rounded(.down),
+            right: damage.right.rounded(.up),
+            bottom: damage.bottom.rounded(.up)
+        ).intersect(bounds)
+    }
+
+    /// Forgets the previous frame, so that the next frame is fully damaged.
+    /// Call this when the content of the canvas was lost.
+    public func reset() {
+        previousRecords = nil
+        previousSize = nil
+    }
+}
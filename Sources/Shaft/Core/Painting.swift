@@ -87,7 +87,7 @@ private func scaleAlpha(_ a: Color, _ factor: Float) -> Color {
 ///
 ///  * [Paint.blendMode], which uses [BlendMode] to define the compositing
 ///    strategy.
-public enum BlendMode {
+public enum BlendMode: Codable {
     // This list comes from Skia's SkXfermode.h and the values (order) should be
     // kept in sync.
     // See: https://skia.org/docs/user/api/skpaint_overview/#SkXfermode
@@ -517,7 +517,7 @@ public enum BlendMode {
 
 /// Styles to use for blurs in [MaskFilter] objects.
 // These enum values must be kept in sync with DlBlurStyle.
-public enum BlurStyle {
+public enum BlurStyle: Codable {
     /// Fuzzy inside and outside. This is useful for painting shadows that are
     /// offset from the shape that ostensibly is casting the shadow.
     case normal
@@ -538,7 +538,7 @@ public enum BlurStyle {
 }
 
 /// An immutable 32 bit color value in ARGB format.
-public struct Color: Hashable {
+public struct Color: Hashable, Codable {
     public init(_ value: UInt32) {
         self.value = value
     }
@@ -735,7 +735,7 @@ extension Color: CustomStringConvertible {
 }
 
 /// Different ways to clip a widget's content.
-public enum Clip {
+public enum Clip: Codable {
     /// No clip at all.
     ///
     /// This is the default option for most widgets: if the content does not
@@ -838,7 +838,7 @@ public enum Clip {
 ///  * [Canvas.drawImageRect].
 ///  * [Canvas.drawImageNine].
 ///  * [Canvas.drawAtlas].
-public enum FilterQuality {
+public enum FilterQuality: Codable {
     // This list and the values (order) should be kept in sync with the equivalent list
     // in lib/ui/painting/image_filter.cc
 
@@ -883,7 +883,7 @@ public enum FilterQuality {
 ///
 /// Instances of this class are used with [Paint.maskFilter] on [Paint] objects.
 /// A blur is an expensive operation and should therefore be used sparingly.
-public struct MaskFilter: Equatable {
+public struct MaskFilter: Hashable, Codable {
     /// Creates a mask filter that takes the shape being drawn and blurs it.
     ///
     /// This is commonly used to approximate shadows.
@@ -911,11 +911,69 @@ public struct MaskFilter: Equatable {
     public let sigma: Float
 }
 
+/// A description of a color filter to apply when drawing a shape or
+/// compositing a layer with a particular [Paint]. A color filter is a function
+/// that takes two colors, and outputs one color.
+public enum ColorFilter: Hashable, Codable {
+    /// Blends `color` with the colors being drawn using `blendMode`. `color`
+    /// is the source and the drawn colors are the destination.
+    case mode(Color, BlendMode)
+
+    /// Transforms colors by a 5x4 matrix given as 20 values in row-major
+    /// order. The fifth column is added to the result and is in the range
+    /// 0..255. For example, this inverts colors:
+    ///
+    /// ```swift
+    /// .matrix([
+    ///   -1, 0, 0, 0, 255,
+    ///   0, -1, 0, 0, 255,
+    ///   0, 0, -1, 0, 255,
+    ///   0, 0, 0, 1, 0,
+    /// ])
+    /// ```
+    case matrix([Float])
+
+    /// Applies the sRGB gamma curve to colors, converting linear colors to
+    /// sRGB.
+    case linearToSrgbGamma
+
+    /// Applies the inverse of the sRGB gamma curve to colors, converting sRGB
+    /// colors to linear.
+    case srgbToLinearGamma
+}
+
+extension ColorFilter {
+    /// Whether the filter turns transparent pixels into visible ones. Such a
+    /// filter colors the whole area of a layer it's applied to, not only the
+    /// shapes drawn into it, so it can't be added to the paints of the
+    /// shapes instead.
+    public var modifiesTransparentBlack: Bool {
+        switch self {
+        case .mode(let color, let blendMode):
+            if color.alpha == 0 {
+                return false
+            }
+            switch blendMode {
+            case .clear, .dst, .srcIn, .dstIn, .srcATop, .dstOut, .modulate:
+                return false
+            default:
+                return true
+            }
+        case .matrix(let matrix):
+            // Transparent black is mapped to the fifth column, of which only
+            // a visible alpha matters.
+            return matrix.count == 20 && matrix[19] > 0
+        case .linearToSrgbGamma, .srgbToLinearGamma:
+            return false
+        }
+    }
+}
+
 /// Strategies for painting shapes and paths on a canvas.
 ///
 /// See [Paint.style].
 // These enum values must be kept in sync with DlDrawStyle.
-public enum PaintingStyle {
+public enum PaintingStyle: Codable {
     // This list comes from dl_paint.h and the values (order) should be kept
     // in sync.
 
@@ -935,7 +993,7 @@ private enum PaintOffset: Int, CaseIterable {
     case color = 0
 }
 
-public struct Paint: Equatable {
+public struct Paint: Hashable, Codable {
     public init() {}
 
     /// Whether to apply anti-aliasing to lines and images drawn on the
@@ -1020,7 +1078,7 @@ public struct Paint: Equatable {
     /// composited.
     ///
     /// See [ColorFilter] for details.
-    // public var colorFilter: ColorFilter?
+    public var colorFilter: ColorFilter?
 
     /// The [ImageFilter] to use when drawing raster images.
     ///
@@ -1094,7 +1152,7 @@ public struct Shadow: Equatable {
 ///  * [Paint.strokeCap] for how this value is used.
 ///  * [StrokeJoin] for the different kinds of line segment joins.
 // These enum values must be kept in sync with DlStrokeCap.
-public enum StrokeCap {
+public enum StrokeCap: Codable {
     /// Begin and end contours with a flat edge and no extension.
     ///
     /// ![A butt cap ends line segments with a square end that stops at the end
@@ -1143,7 +1201,7 @@ public enum StrokeCap {
 ///   used.
 /// * [StrokeCap] for the different kinds of line endings.
 // These enum values must be kept in sync with DlStrokeJoin.
-public enum StrokeJoin {
+public enum StrokeJoin: Codable {
     /// Joins between line segments form sharp corners.
     ///
     /// {@animation 300 300 https://flutter.github.io/assets-for-api-docs/assets/dart-ui/miter_4_join.mp4}
@@ -1207,6 +1265,11 @@ public protocol AnimatedImage: AnyObject {
     ///
     /// Returns nil if there is an error decoding the image.
     func getNextFrame() -> FrameInfo?
+
+    /// The memory retained by this image, including decoded frames and any
+    /// encoded data kept to decode further frames. Images decoded into YUVA
+    /// planes use less than 4 bytes per pixel.
+    var byteCount: Int { get }
 }
 
 /// Information for a single frame of an animation.
@@ -1490,7 +1553,7 @@ public protocol Path {
     /// therefore ends up grossly overestimating the actual area covered by the
     /// circle.
     // see https://skia.org/user/api/SkPath_Reference#SkPath_getBounds
-    // func getBounds() -> Rect
+    func getBounds() -> Rect
 
     /// Creates a [PathMetrics] object for this path, which can describe various
     /// properties about the contours of the path.
@@ -11,17 +11,133 @@ public protocol Renderer {
 
     func createTextBlob(_ glyphs: [GlyphID], positions: [Offset], font: Font) -> TextBlob
 
-    func decodeImageFromData(_ data: Data) -> AnimatedImage?
+    /// Decodes an encoded image. If `targetSize` is given, the image is
+    /// decoded at a reduced size that still covers `targetSize` pixels in
+    /// both dimensions, when the codec supports it. Images are never decoded
+    /// larger than their full size.
+    func decodeImageFromData(_ data: Data, targetSize: ISize?) -> AnimatedImage?
+
+    /// Decodes the image file at `url` like ``decodeImageFromData(_:targetSize:)``.
+    /// Returns nil if the file can't be read. Implementations may map the
+    /// file into memory instead of reading it.
+    func decodeImageFromFile(_ url: URL, targetSize: ISize?) -> AnimatedImage?
 
     func createPath() -> Path
 
     var fontCollection: FontCollection { get }
 }
 
+extension Renderer {
+    /// Decodes an encoded image at its full size.
+    public func decodeImageFromData(_ data: Data) -> AnimatedImage? {
+        decodeImageFromData(data, targetSize: nil)
+    }
+
+    public func decodeImageFromFile(_ url: URL, targetSize: ISize?) -> AnimatedImage? {
+        guard let data = try? Data(contentsOf: url, options: .alwaysMapped) else {
+            return nil
+        }
+        return decodeImageFromData(data, targetSize: targetSize)
+    }
+}
+
 public protocol GLRenderer: Renderer {
     func createGLCanvas(fbo: UInt, size: ISize) -> DirectCanvas
 }
 
+/// A renderer that rasterizes on the CPU into memory owned by the renderer.
+/// Does not require a GPU or a window, which makes it suitable for headless
+/// rendering such as thumbnails, render tests and benchmarks.
+///
+/// Canvases created by a raster renderer are independent of each other and
+/// can be painted on different threads concurrently.
+public protocol RasterRenderer: Renderer {
+    /// Creates a canvas backed by a newly allocated pixel buffer of the given
+    /// size in pixels. The pixels are initialized to transparent black.
+    func createRasterCanvas(size: ISize) -> RasterCanvas
+}
+
+/// A renderer that keeps GPU resources, such as textures of images, glyph
+/// atlases and offscreen layers, in a cache across frames.
+///
+/// The cache grows up to ``resourceCacheLimit`` and then evicts the least
+/// recently used resources. Resources used by pending GPU work are never
+/// evicted, so the cache may exceed the limit for the duration of a frame.
+///
+/// The GPU context is only used on the thread that rasterizes frames. Changes
+/// to the cache are applied on that thread through ``gpuContextExecutor``,
+/// or when the next frame is flushed if there is none.
+public protocol GPUResourceCacheRenderer: Renderer, AnyObject {
+    /// The number of bytes the cache may hold before it evicts resources.
+    var resourceCacheLimit: Int { get set }
+
+    /// Runs changes to the cache on a thread where the GPU context can be
+    /// used, so that they take effect while no frames are drawn, such as
+    /// when the app is hidden. Set by views, and not retained.
+    var gpuContextExecutor: GPUContextExecutor? { get set }
+
+    /// The usage of the cache as of the last frame, or nil if no frame has
+    /// been flushed yet.
+    var resourceCacheUsage: GPUResourceCacheUsage? { get }
+
+    /// Releases all resources that are not used by pending GPU work. If
+    /// `scratchOnly` is true, resources whose content can't be recreated
+    /// without the original data, such as uploaded images, are kept.
+    func purgeUnlockedResources(scratchOnly: Bool)
+
+    /// Releases resources that have not been used for `duration`.
+    func purgeResources(notUsedFor duration: Duration)
+}
+
+/// Runs work on a thread where the GPU context of a renderer is current,
+/// typically the raster thread of a view.
+public protocol GPUContextExecutor: AnyObject {
+    /// Runs `work` asynchronously with the GPU context current. Returns false
+    /// if it can't be run, for example because the view was destroyed.
+    func runWithGPUContext(_ work: @escaping () -> Void) -> Bool
+}
+
+/// A snapshot of the resource cache of a ``GPUResourceCacheRenderer``.
+public struct GPUResourceCacheUsage: Equatable {
+    public init(resourceCount: Int, resourceBytes: Int, purgeableBytes: Int, limit: Int) {
+        self.resourceCount = resourceCount
+        self.resourceBytes = resourceBytes
+        self.purgeableBytes = purgeableBytes
+        self.limit = limit
+    }
+
+    /// The number of resources in the cache.
+    public var resourceCount: Int
+
+    /// The GPU memory held by the resources in the cache, in bytes.
+    public var resourceBytes: Int
+
+    /// The part of ``resourceBytes`` that can be purged right away.
+    public var purgeableBytes: Int
+
+    /// The ``GPUResourceCacheRenderer/resourceCacheLimit`` of the cache.
+    public var limit: Int
+}
+
+extension GPUResourceCacheRenderer {
+    /// Releases GPU memory that the app doesn't need in `state`. Hidden apps
+    /// keep their images so that they can be shown again without decoding
+    /// them, while paused and detached apps release everything they can.
+    ///
+    /// Called by ``WidgetsBinding`` when the lifecycle state of the app
+    /// changes.
+    public func purgeResources(for state: AppLifecycleState) {
+        switch state {
+        case .resumed, .inactive:
+            break
+        case .hidden:
+            purgeUnlockedResources(scratchOnly: true)
+        case .paused, .detached:
+            purgeUnlockedResources(scratchOnly: false)
+        }
+    }
+}
+
 #if canImport(Metal)
 
     import Foundation
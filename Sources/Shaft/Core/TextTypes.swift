@@ -1336,6 +1336,13 @@ public protocol Paragraph: AnyObject {
     /// The ``ParagraphConstraints`` control how wide the text is allowed to be.
     func layout(_ constraints: ParagraphConstraints)
 
+    /// Returns a paragraph that paints what this paragraph paints with its
+    /// current layout and is not affected by later calls to ``layout``.
+    ///
+    /// Used to paint the paragraph on a raster thread while the UI thread
+    /// may lay it out again for the next frame.
+    func snapshot() -> Paragraph
+
     /// Returns a list of text boxes that enclose the given text range.
     ///
     /// The ``boxHeightStyle`` and ``boxWidthStyle`` parameters allow customization
@@ -1619,6 +1626,12 @@ public protocol FontCollection {
     /// Creates a typeface from the provided font file data.
     func makeTypefaceFrom(_ data: Data) -> Typeface
 
+    /// Creates a typeface from the font file at `url`, or returns nil if the
+    /// file can't be read or isn't a font. Unlike loading the file into
+    /// ``Data`` first, implementations may map the file into memory so that
+    /// only the parts of the font in use become resident.
+    func makeTypefaceFrom(contentsOf url: URL) -> Typeface?
+
     /// Registers a typeface with the font collection. After registering a
     /// typeface, it becomes available for use in text rendering and can be
     /// found by family name when specifying text styles.
@@ -1633,6 +1646,15 @@ public protocol FontCollection {
     func findTypefaceFor(_ codepoint: UInt32) -> Typeface?
 }
 
+extension FontCollection {
+    public func makeTypefaceFrom(contentsOf url: URL) -> Typeface? {
+        guard let data = try? Data(contentsOf: url, options: .alwaysMapped) else {
+            return nil
+        }
+        return makeTypefaceFrom(data)
+    }
+}
+
 /// A typeface in Shaft is typically a loaded font file. It can be used to
 /// create a font object with a specific size and style or to retrieve the
 /// glyph id for a specific code point.
@@ -0,0 +1,289 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+
+#if os(Windows)
+    import WinSDK
+#endif
+
+/// An event on the timeline recorded by ``Timeline``.
+public struct TimelineEvent {
+    public enum Kind {
+        /// A span of `duration` starting at ``TimelineEvent/timestamp``.
+        case complete(duration: Duration)
+
+        /// A single point in time.
+        case instant
+    }
+
+    public init(
+        name: String,
+        category: String,
+        kind: Kind,
+        timestamp: Duration,
+        threadID: UInt64,
+        arguments: [String: String] = [:]
+    ) {
+        self.name = name
+        self.category = category
+        self.kind = kind
+        self.timestamp = timestamp
+        self.threadID = threadID
+        self.arguments = arguments
+    }
+
+    public let name: String
+
+    public let category: String
+
+    public let kind: Kind
+
+    /// The time since an arbitrary point of the monotonic clock returned by
+    /// ``Timeline/now``.
+    public let timestamp: Duration
+
+    /// The thread that recorded the event, as returned by
+    /// ``Timeline/currentThreadID``.
+    public let threadID: UInt64
+
+    public let arguments: [String: String]
+}
+
+/// Provides events recorded outside of Shaft, such as by a graphics library,
+/// to ``Timeline``.
+public protocol TimelineSource: AnyObject {
+    /// Called when ``Timeline/startRecording()`` is called.
+    func startRecording()
+
+    /// Called when ``Timeline/stopRecording()`` is called. Returns the events
+    /// recorded since ``startRecording()``.
+    func stopRecording() -> [TimelineEvent]
+}
+
+/// Records spans of work on a timeline that can be inspected with
+/// `chrome://tracing` or the Perfetto UI.
+///
+/// Shaft records its pipeline phases, such as build, layout, paint and
+/// rasterization. Backends add the events of their graphics library with
+/// ``addSource(_:)``. Recording is off by default and costs a single check
+/// per span while off.
+///
+/// ```swift
+/// Timeline.startRecording()
+/// // ...
+/// try Timeline.stopRecording().writeChromeTrace(to: url)
+/// ```
+public enum Timeline {
+    /// Whether events are being recorded.
+    public private(set) static var isRecording = false
+
+    private static let lock = NSLock()
+
+    private static var events: [TimelineEvent] = []
+
+    private static var sources: [TimelineSource] = []
+
+    private static var threadNames: [UInt64: String] = [:]
+
+    /// Adds a source of external events whose events are merged into every
+    /// recording.
+    public static func addSource(_ source: TimelineSource) {
+        lock.lock()
+        defer { lock.unlock() }
+        if !sources.contains(where: { $0 === source }) {
+            sources.append(source)
+            if isRecording {
+                source.startRecording()
+            }
+        }
+    }
+
+    /// Starts recording events. Events recorded before are discarded.
+    public static func startRecording() {
+        lock.lock()
+        defer { lock.unlock() }
+        events.removeAll()
+        threadNames.removeAll()
+        isRecording = true
+        for source in sources {
+            source.startRecording()
+        }
+    }
+
+    /// Stops recording and returns everything recorded since
+    /// ``startRecording()``.
+    public static func stopRecording() -> TimelineTrace {
+        lock.lock()
+        defer { lock.unlock() }
+        isRecording = false
+        var recorded = events
+        for source in sources {
+            recorded += source.stopRecording()
+        }
+        events.removeAll()
+        recorded.sort { $0.timestamp < $1.timestamp }
+        return TimelineTrace(events: recorded, threadNames: threadNames)
+    }
+
+    /// Runs `body` and records it as a span named `name`.
+    @inline(__always)
+    public static func timeSync<T>(
+        _ name: @autoclosure () -> String,
+        category: String = "shaft",
+        arguments: [String: String] = [:],
+        _ body: () throws -> T
+    ) rethrows -> T {
+        if !isRecording {
+            return try body()
+        }
+        let start = now
+        defer {
+            add(
+                TimelineEvent(
+                    name: name(),
+                    category: category,
+                    kind: .complete(duration: now - start),
+                    timestamp: start,
+                    threadID: currentThreadID,
+                    arguments: arguments
+                )
+            )
+        }
+        return try body()
+    }
+
+    /// Records an event that happened at the current time.
+    public static func instantSync(
+        _ name: @autoclosure () -> String,
+        category: String = "shaft",
+        arguments: [String: String] = [:]
+    ) {
+        if !isRecording {
+            return
+        }
+        add(
+            TimelineEvent(
+                name: name(),
+                category: category,
+                kind: .instant,
+                timestamp: now,
+                threadID: currentThreadID,
+                arguments: arguments
+            )
+        )
+    }
+
+    private static func add(_ event: TimelineEvent) {
+        lock.lock()
+        defer { lock.unlock() }
+        if !isRecording {
+            return
+        }
+        events.append(event)
+        if threadNames[event.threadID] == nil {
+            threadNames[event.threadID] =
+                Thread.isMainThread ? "main" : (Thread.current.name ?? "")
+        }
+    }
+
+    /// The current time on the monotonic clock used for timestamps. Sources
+    /// that use another clock should convert their timestamps by comparing
+    /// their clock to this one.
+    public static var now: Duration {
+        .nanoseconds(Int64(DispatchTime.now().uptimeNanoseconds))
+    }
+
+    /// An identifier of the current thread that matches the `pthread_t` of
+    /// the thread, or its thread ID on Windows, so that events from C
+    /// libraries can be attributed to the same threads.
+    public static var currentThreadID: UInt64 {
+        #if canImport(Darwin)
+            UInt64(UInt(bitPattern: pthread_self()))
+        #elseif os(Windows)
+            UInt64(GetCurrentThreadId())
+        #else
+            UInt64(pthread_self())
+        #endif
+    }
+}
+
+/// Events recorded by ``Timeline`` between ``Timeline/startRecording()`` and
+/// ``Timeline/stopRecording()``.
+public struct TimelineTrace {
+    /// The recorded events, ordered by their start time.
+    public let events: [TimelineEvent]
+
+    /// Names of the threads that recorded events, where known.
+    public let threadNames: [UInt64: String]
+
+    /// Encodes the trace in the Chrome trace event JSON format, which is
+    /// understood by `chrome://tracing` and the Perfetto UI.
+    public func chromeTraceJSON() throws -> Data {
+        let pid = Int(ProcessInfo.processInfo.processIdentifier)
+        var traceEvents = threadNames.map { threadID, name in
+            ChromeTraceEvent(
+                name: "thread_name",
+                cat: "__metadata",
+                ph: "M",
+                ts: 0,
+                dur: nil,
+                pid: pid,
+                tid: threadID,
+                s: nil,
+                args: ["name": name]
+            )
+        }
+        for event in events {
+            let ph: String
+            var dur: Double?
+            var s: String?
+            switch event.kind {
+            case .complete(let duration):
+                ph = "X"
+                dur = Double(duration.inMicroseconds)
+            case .instant:
+                ph = "i"
+                s = "t"
+            }
+            traceEvents.append(
+                ChromeTraceEvent(
+                    name: event.name,
+                    cat: event.category,
+                    ph: ph,
+                    ts: Double(event.timestamp.inMicroseconds),
+                    dur: dur,
+                    pid: pid,
+                    tid: event.threadID,
+                    s: s,
+                    args: event.arguments.isEmpty ? nil : event.arguments
+                )
+            )
+        }
+        return try JSONEncoder().encode(ChromeTrace(traceEvents: traceEvents))
+    }
+
+    /// Writes the trace to `url` in the Chrome trace event JSON format.
+    public func writeChromeTrace(to url: URL) throws {
+        try chromeTraceJSON().write(to: url)
+    }
+}
+
+private struct ChromeTrace: Encodable {
+    let traceEvents: [ChromeTraceEvent]
+
+    var displayTimeUnit = "ms"
+}
+
+private struct ChromeTraceEvent: Encodable {
+    let name: String
+    let cat: String
+    let ph: String
+    let ts: Double
+    let dur: Double?
+    let pid: Int
+    let tid: UInt64
+    let s: String?
+    let args: [String: String]?
+}
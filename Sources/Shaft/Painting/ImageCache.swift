@@ -0,0 +1,497 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+
+/// A cache of decoded images shared by all ``ImageProvider``s that resolve
+/// through it, keyed by the provider and the ``ImageConfiguration`` it was
+/// resolved with.
+///
+/// Every image is decoded once no matter how many widgets show it. Resolves
+/// of an image that is still being fetched or decoded wait for that decode
+/// instead of starting another one, and animated images advance once for all
+/// of their streams. Decodes run on ``decodePool``. A fetch or decode that
+/// no stream is waiting for anymore is cancelled.
+///
+/// Images that are shown by at least one stream are _live_ and are never
+/// dropped. When an image is no longer shown it stays in the cache until it
+/// is evicted, least recently used first, to keep the cache within
+/// ``maximumSize`` images and ``byteBudget`` bytes. Images larger than the
+/// whole budget are not kept after they stop being shown.
+public final class ImageCache {
+    /// The cache used by the image providers of Shaft.
+    public static let shared = ImageCache()
+
+    public init(decodePool: ImageDecodePool = .shared) {
+        self.decodePool = decodePool
+    }
+
+    /// The workers that decode the images of this cache.
+    public let decodePool: ImageDecodePool
+
+    /// The maximum number of images kept in the cache.
+    public var maximumSize: Int {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return _maximumSize
+        }
+        set {
+            lock.lock()
+            defer { lock.unlock() }
+            _maximumSize = newValue
+            evict(toFit: 0)
+        }
+    }
+
+    private var _maximumSize = 1000
+
+    /// The maximum memory used by images in the cache, as reported by
+    /// ``AnimatedImage/byteCount``.
+    public var byteBudget: Int {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return _byteBudget
+        }
+        set {
+            lock.lock()
+            defer { lock.unlock() }
+            _byteBudget = newValue
+            evict(toFit: 0)
+        }
+    }
+
+    private var _byteBudget = 100 * 1024 * 1024
+
+    /// The memory used by images in the cache. Live images that were evicted
+    /// are not counted.
+    public var byteCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return entries.values.reduce(0) { $0 + $1.byteCount }
+    }
+
+    /// The number of images in the cache.
+    public var count: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return entries.count
+    }
+
+    /// The number of images that are shown by at least one stream.
+    public var liveImageCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return liveImages.count
+    }
+
+    /// The number of images that are being fetched or decoded.
+    public var pendingImageCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return pendingImages.count
+    }
+
+    /// The number of resolves that reused an image that was cached, live or
+    /// pending.
+    public var hitCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return _hitCount
+    }
+
+    private var _hitCount = 0
+
+    /// The number of resolves that started a new decode.
+    public var missCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return _missCount
+    }
+
+    private var _missCount = 0
+
+    /// Returns a stream of the frames of the image of `provider` for
+    /// `configuration`. The current frame is delivered right away if the
+    /// image has been decoded before. Otherwise, the encoded image, or where
+    /// to find it, is loaded with `fetch` and decoded with `decode` on
+    /// ``decodePool``, unless a
+    /// decode of the same image is already in flight. The image is not cached
+    /// if either fails.
+    ///
+    /// A decode that is queued with `priority` is promoted when the same
+    /// image is resolved again with a higher priority.
+    public func resolve<Source>(
+        _ provider: any ImageProvider,
+        configuration: ImageConfiguration,
+        priority: ImageDecodePriority = .visible,
+        fetch: @escaping () async throws -> Source,
+        decode: @escaping (Source) -> AnimatedImage?
+    ) -> AsyncStream<NativeImage> {
+        let key = Key(provider: AnyHashable(provider), configuration: configuration)
+
+        lock.lock()
+        let completer: ImageStreamCompleter
+        var isNew = false
+        if let entry = entries[key] {
+            useCount += 1
+            entries[key]!.lastUsed = useCount
+            completer = entry.completer
+            _hitCount += 1
+        } else if let existing = pendingImages[key] ?? liveImages[key] {
+            completer = existing
+            _hitCount += 1
+        } else {
+            completer = ImageStreamCompleter(cache: self, key: key, priority: priority)
+            pendingImages[key] = completer
+            _missCount += 1
+            isNew = true
+        }
+
+        // Listeners are added with the lock held, so that a decode is never
+        // cancelled for lack of listeners while a resolve is joining it.
+        let (stream, becameLive) = completer.addListener(priority: priority)
+        if becameLive, entries[key]?.completer === completer {
+            liveImages[key] = completer
+        }
+        lock.unlock()
+
+        if isNew {
+            completer.load(fetch: fetch, decode: decode)
+        }
+        if becameLive {
+            completer.startAnimationIfNeeded()
+        }
+        return stream
+    }
+
+    /// Removes the image of `provider` from the cache, for all configurations
+    /// if `configuration` is nil. Streams that show the image keep showing
+    /// it, but later resolves decode it again. Returns whether an image was
+    /// removed.
+    @discardableResult
+    public func evict(_ provider: any ImageProvider, configuration: ImageConfiguration? = nil)
+        -> Bool
+    {
+        let provider = AnyHashable(provider)
+        func matches(_ key: Key) -> Bool {
+            key.provider == provider && (configuration == nil || key.configuration == configuration)
+        }
+
+        lock.lock()
+        defer { lock.unlock() }
+        let keys = Set(entries.keys.filter(matches)).union(liveImages.keys.filter(matches))
+        for key in keys {
+            entries.removeValue(forKey: key)
+            liveImages.removeValue(forKey: key)
+        }
+        return !keys.isEmpty
+    }
+
+    /// Removes all images from the cache. Live images stay live until they
+    /// are no longer shown.
+    public func clear() {
+        lock.lock()
+        defer { lock.unlock() }
+        entries.removeAll()
+    }
+
+    /// Resets the hit and miss counters to zero.
+    public func resetCounters() {
+        lock.lock()
+        defer { lock.unlock() }
+        _hitCount = 0
+        _missCount = 0
+    }
+
+    struct Key: Hashable {
+        var provider: AnyHashable
+
+        var configuration: ImageConfiguration
+    }
+
+    private struct Entry {
+        var completer: ImageStreamCompleter
+
+        var byteCount: Int
+
+        /// The value of ``useCount`` when the image was last resolved.
+        var lastUsed: Int
+    }
+
+    private var entries: [Key: Entry] = [:]
+
+    private var pendingImages: [Key: ImageStreamCompleter] = [:]
+
+    private var liveImages: [Key: ImageStreamCompleter] = [:]
+
+    private var useCount = 0
+
+    /// Images are resolved on the UI thread but decoded on other threads.
+    private let lock = NSLock()
+
+    /// Called when the image of `completer` has been decoded, or has failed
+    /// to decode if `byteCount` is nil.
+    fileprivate func didLoad(_ completer: ImageStreamCompleter, byteCount: Int?) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard pendingImages[completer.key] === completer else {
+            return
+        }
+        pendingImages.removeValue(forKey: completer.key)
+        guard let byteCount else {
+            return
+        }
+
+        if completer.listenerCount > 0 {
+            liveImages[completer.key] = completer
+        }
+        if byteCount <= _byteBudget {
+            evict(toFit: byteCount)
+            useCount += 1
+            entries[completer.key] = Entry(
+                completer: completer,
+                byteCount: byteCount,
+                lastUsed: useCount
+            )
+        }
+    }
+
+    /// Called when the last stream of `completer` has ended. Images that
+    /// are still loading are abandoned, and decoded ones are no longer live.
+    fileprivate func didRemoveLastListener(_ completer: ImageStreamCompleter) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        // A resolve may have added a listener since.
+        guard completer.listenerCount == 0 else {
+            return
+        }
+        if pendingImages[completer.key] === completer {
+            pendingImages.removeValue(forKey: completer.key)
+            completer.cancelLoad()
+        } else if liveImages[completer.key] === completer {
+            liveImages.removeValue(forKey: completer.key)
+        }
+    }
+
+    /// Evicts the least recently used images until one more image of `bytes`
+    /// fits. Must be called with ``lock`` held.
+    private func evict(toFit bytes: Int) {
+        var byteCount = entries.values.reduce(0) { $0 + $1.byteCount }
+        let reserved = bytes > 0 ? 1 : 0
+        guard entries.count + reserved > _maximumSize || byteCount + bytes > _byteBudget else {
+            return
+        }
+        for (key, entry) in entries.sorted(by: { $0.value.lastUsed < $1.value.lastUsed }) {
+            if entries.count + reserved <= _maximumSize && byteCount + bytes <= _byteBudget {
+                break
+            }
+            entries.removeValue(forKey: key)
+            byteCount -= entry.byteCount
+        }
+    }
+}
+
+/// Decodes an image once and delivers its frames to any number of streams.
+/// Animated images advance only while at least one stream is listening.
+final class ImageStreamCompleter {
+    fileprivate init(cache: ImageCache, key: ImageCache.Key, priority: ImageDecodePriority) {
+        self.cache = cache
+        self.key = key
+        self.decodePool = cache.decodePool
+        self.decodeJob = ImageDecodeJob(priority: priority)
+    }
+
+    private weak var cache: ImageCache?
+
+    let key: ImageCache.Key
+
+    private let decodePool: ImageDecodePool
+
+    private let decodeJob: ImageDecodeJob
+
+    /// Fetches and decodes the image until the first frame is shown.
+    private var loadTask: Task<Void, Never>?
+
+    private var isLoadCancelled = false
+
+    private var listeners: [Int: AsyncStream<NativeImage>.Continuation] = [:]
+
+    private var nextListenerID = 0
+
+    /// The most recent frame of the image.
+    private var currentImage: NativeImage?
+
+    /// The image that produces the next frames, if it's animated.
+    private var animatedImage: AnimatedImage?
+
+    /// How long ``currentImage`` is shown before the next frame.
+    private var currentFrameDuration: Duration?
+
+    private var animation: Task<Void, Never>?
+
+    private var isFailed = false
+
+    private let lock = NSLock()
+
+    var listenerCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return listeners.count
+    }
+
+    /// Returns a new stream that starts with the current frame, if any, and
+    /// whether the image became live, which is when a decoded image gets its
+    /// first stream. The stream is finished right away if the image failed
+    /// to decode.
+    func addListener(
+        priority: ImageDecodePriority
+    ) -> (stream: AsyncStream<NativeImage>, becameLive: Bool) {
+        var becameLive = false
+        let stream = AsyncStream<NativeImage> { continuation in
+            lock.lock()
+            if isFailed {
+                lock.unlock()
+                continuation.finish()
+                return
+            }
+            let id = nextListenerID
+            nextListenerID += 1
+            listeners[id] = continuation
+            becameLive = listeners.count == 1 && currentImage != nil
+            if let currentImage {
+                continuation.yield(currentImage)
+            }
+            lock.unlock()
+
+            continuation.onTermination = { [weak self] _ in
+                self?.removeListener(id)
+            }
+        }
+        decodePool.promote(decodeJob, to: priority)
+        return (stream, becameLive)
+    }
+
+    private func removeListener(_ id: Int) {
+        lock.lock()
+        guard listeners.removeValue(forKey: id) != nil else {
+            lock.unlock()
+            return
+        }
+        let isIdle = listeners.isEmpty
+        if isIdle {
+            animation?.cancel()
+            animation = nil
+        }
+        lock.unlock()
+
+        if isIdle {
+            cache?.didRemoveLastListener(self)
+        }
+    }
+
+    /// Stops fetching or decoding the image. A decode that has already
+    /// started runs to completion, but its result is dropped.
+    func cancelLoad() {
+        lock.lock()
+        defer { lock.unlock() }
+        isLoadCancelled = true
+        loadTask?.cancel()
+    }
+
+    func load<Source>(
+        fetch: @escaping () async throws -> Source,
+        decode: @escaping (Source) -> AnimatedImage?
+    ) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard !isLoadCancelled else {
+            return
+        }
+        loadTask = Task { [decodePool, decodeJob] in
+            var image: AnimatedImage?
+            do {
+                let source = try await fetch()
+                image = try await decodePool.run(decodeJob) { decode(source) }
+            } catch {
+                image = nil
+            }
+            // Nobody is waiting for the image anymore.
+            guard !Task.isCancelled else {
+                return
+            }
+            guard let image, let frame = image.getNextFrame() else {
+                lock.lock()
+                isFailed = true
+                let listeners = self.listeners.values
+                self.listeners.removeAll()
+                lock.unlock()
+
+                cache?.didLoad(self, byteCount: nil)
+                for listener in listeners {
+                    listener.finish()
+                }
+                return
+            }
+
+            let isAnimated = image.frameCount > 1 && frame.duration != nil
+            let listeners = update(frame, animatedImage: isAnimated ? image : nil)
+            // The cache learns about the image before any stream receives it,
+            // so that the image is in the cache once a stream has a frame.
+            cache?.didLoad(self, byteCount: image.byteCount)
+            for listener in listeners {
+                listener.yield(frame.image)
+            }
+            startAnimationIfNeeded()
+        }
+    }
+
+    /// Makes `frame` the current frame and returns the streams that haven't
+    /// received it yet. Streams added later start with it.
+    private func update(
+        _ frame: FrameInfo,
+        animatedImage: AnimatedImage?
+    ) -> [AsyncStream<NativeImage>.Continuation] {
+        lock.lock()
+        defer { lock.unlock() }
+        currentImage = frame.image
+        currentFrameDuration = frame.duration
+        if animatedImage != nil {
+            self.animatedImage = animatedImage
+        }
+        return Array(listeners.values)
+    }
+
+    func startAnimationIfNeeded() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let animatedImage, animation == nil, !listeners.isEmpty else {
+            return
+        }
+        animation = Task { [weak self] in
+            while let duration = self?.nextFrameDelay() {
+                try? await Task.sleep(for: duration)
+                guard !Task.isCancelled, let frame = animatedImage.getNextFrame(),
+                    let listeners = self?.update(frame, animatedImage: nil)
+                else {
+                    return
+                }
+                for listener in listeners {
+                    listener.yield(frame.image)
+                }
+            }
+        }
+    }
+
+    /// The time until the next frame, or nil if the image doesn't advance.
+    private func nextFrameDelay() -> Duration? {
+        lock.lock()
+        defer { lock.unlock() }
+        return currentFrameDuration
+    }
+}
@@ -0,0 +1,196 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+
+/// How urgently an image is needed. Decodes of higher priority start first.
+public enum ImageDecodePriority: Int, Comparable {
+    /// Images that are not shown yet, such as images resolved ahead of
+    /// scrolling.
+    case prefetch
+
+    /// Images that are shown on screen.
+    case visible
+
+    public static func < (lhs: ImageDecodePriority, rhs: ImageDecodePriority) -> Bool {
+        lhs.rawValue < rhs.rawValue
+    }
+}
+
+/// Decodes images on a bounded number of background threads.
+///
+/// Decodes that can't start right away wait in a queue and start by
+/// priority, then in the order they were requested. A decode is removed
+/// from the queue when the task waiting for it is cancelled, so images that
+/// are scrolled away before their turn are never decoded. Decodes that have
+/// started run to completion.
+public final class ImageDecodePool {
+    /// The pool used by ``ImageCache/shared``.
+    public static let shared = ImageDecodePool()
+
+    public init(maxConcurrentDecodes: Int = ImageDecodePool.defaultMaxConcurrentDecodes) {
+        self._maxConcurrentDecodes = max(maxConcurrentDecodes, 1)
+    }
+
+    /// One worker per core, leaving one core for the UI thread, and at most
+    /// four, since decoding more images at once mostly adds memory pressure.
+    public static var defaultMaxConcurrentDecodes: Int {
+        min(max(ProcessInfo.processInfo.activeProcessorCount - 1, 1), 4)
+    }
+
+    /// The maximum number of images decoded at the same time.
+    public var maxConcurrentDecodes: Int {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return _maxConcurrentDecodes
+        }
+        set {
+            lock.lock()
+            _maxConcurrentDecodes = max(newValue, 1)
+            lock.unlock()
+            startJobs()
+        }
+    }
+
+    /// The number of decodes waiting for a worker.
+    public var queuedCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return queue.count
+    }
+
+    /// The number of decodes running.
+    public var runningCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return _runningCount
+    }
+
+    /// Runs `work` on a worker of the pool and returns its result. Throws
+    /// `CancellationError` if the calling task is cancelled before `work`
+    /// starts.
+    public func run<T>(
+        priority: ImageDecodePriority = .visible,
+        _ work: @escaping () -> T
+    ) async throws -> T {
+        try await run(ImageDecodeJob(priority: priority), work)
+    }
+
+    /// Runs `work` as `job`, whose priority can be raised with ``promote``
+    /// while it's queued.
+    func run<T>(_ job: ImageDecodeJob, _ work: @escaping () -> T) async throws -> T {
+        try await withTaskCancellationHandler {
+            try await withCheckedThrowingContinuation { continuation in
+                lock.lock()
+                if job.isCancelled {
+                    lock.unlock()
+                    continuation.resume(throwing: CancellationError())
+                    return
+                }
+                job.start = { continuation.resume(returning: work()) }
+                job.cancel = { continuation.resume(throwing: CancellationError()) }
+                queue.append(job)
+                lock.unlock()
+
+                startJobs()
+            }
+        } onCancel: {
+            lock.lock()
+            job.isCancelled = true
+            let index = queue.firstIndex { $0 === job }
+            if let index {
+                queue.remove(at: index)
+            }
+            lock.unlock()
+
+            if index != nil {
+                job.cancel?()
+                job.clear()
+            }
+        }
+    }
+
+    /// Raises the priority of `job` to `priority` if it's lower.
+    func promote(_ job: ImageDecodeJob, to priority: ImageDecodePriority) {
+        lock.lock()
+        defer { lock.unlock() }
+        job.priority = max(job.priority, priority)
+    }
+
+    private var _maxConcurrentDecodes: Int
+
+    private var _runningCount = 0
+
+    /// Jobs waiting for a worker, in the order they were queued.
+    private var queue: [ImageDecodeJob] = []
+
+    private let lock = NSLock()
+
+    private let workers = DispatchQueue(
+        label: "shaft.image-decode",
+        qos: .userInitiated,
+        attributes: .concurrent
+    )
+
+    /// Hands queued jobs to workers until all workers are busy.
+    private func startJobs() {
+        var jobs: [ImageDecodeJob] = []
+
+        lock.lock()
+        while _runningCount < _maxConcurrentDecodes, let index = nextJobIndex() {
+            jobs.append(queue.remove(at: index))
+            _runningCount += 1
+        }
+        lock.unlock()
+
+        for job in jobs {
+            workers.async { [self] in
+                job.start?()
+                job.clear()
+
+                lock.lock()
+                _runningCount -= 1
+                lock.unlock()
+                startJobs()
+            }
+        }
+    }
+
+    /// The oldest job of the highest priority. Must be called with ``lock``
+    /// held.
+    private func nextJobIndex() -> Int? {
+        var result: Int?
+        for (index, job) in queue.enumerated() {
+            if let current = result, job.priority <= queue[current].priority {
+                continue
+            }
+            result = index
+        }
+        return result
+    }
+}
+
+/// A decode in an ``ImageDecodePool``. Its fields are protected by the lock
+/// of the pool.
+final class ImageDecodeJob {
+    init(priority: ImageDecodePriority) {
+        self.priority = priority
+    }
+
+    fileprivate(set) var priority: ImageDecodePriority
+
+    fileprivate var isCancelled = false
+
+    /// Runs the work and resumes the waiting task with its result.
+    fileprivate var start: (() -> Void)?
+
+    /// Resumes the waiting task with a `CancellationError`.
+    fileprivate var cancel: (() -> Void)?
+
+    fileprivate func clear() {
+        start = nil
+        cancel = nil
+    }
+}
@@ -11,7 +11,7 @@ import Foundation
 
 /// Configuration information passed to the [ImageProvider.resolve] method to
 /// select a specific image.
-public struct ImageConfiguration: Equatable {
+public struct ImageConfiguration: Hashable {
     /// Creates an object holding the configuration information for an [ImageProvider].
     ///
     /// All the arguments are optional. Configuration information is merely
@@ -54,6 +54,21 @@ public struct ImageConfiguration: Equatable {
     /// shadows.
     //   let platform: TargetPlatform?
 
+    /// The size in physical pixels at which the image will be rendered, or
+    /// nil if ``size`` is unknown.
+    public var physicalSize: ISize? {
+        guard let size, size.width.isFinite, size.height.isFinite else {
+            return nil
+        }
+        let ratio = devicePixelRatio ?? 1
+        let width = Int((size.width * ratio).rounded(.up))
+        let height = Int((size.height * ratio).rounded(.up))
+        guard width > 0, height > 0 else {
+            return nil
+        }
+        return ISize(width, height)
+    }
+
     /// An image configuration that provides no additional information.
     ///
     /// Useful when resolving an [ImageProvider] without any context.
@@ -78,13 +93,30 @@ public struct ImageConfiguration: Equatable {
     }
 }
 
-public protocol ImageProvider: Equatable {
+/// Identifies an image without committing to the precise final asset. Equal
+/// providers resolve to the same image, which allows ``ImageCache`` to share
+/// it between them.
+public protocol ImageProvider: Hashable {
     func resolve(configuration: ImageConfiguration) -> AsyncStream<NativeImage>
 
+    /// Resolves the image, decoding it before images of lower `priority` if
+    /// it's not cached yet.
+    func resolve(
+        configuration: ImageConfiguration,
+        priority: ImageDecodePriority
+    ) -> AsyncStream<NativeImage>
+
     func isEqualTo(_ other: any ImageProvider) -> Bool
 }
 
 extension ImageProvider {
+    public func resolve(
+        configuration: ImageConfiguration,
+        priority: ImageDecodePriority
+    ) -> AsyncStream<NativeImage> {
+        resolve(configuration: configuration)
+    }
+
     public func isEqualTo(_ other: any ImageProvider) -> Bool {
         guard let other = other as? Self else {
             return false
@@ -93,36 +125,51 @@ extension ImageProvider {
     }
 }
 
-// Decode and stream an image from a data provider.
-private func decodeAndStreamImage(from dataProvider: @escaping () async throws -> Data)
-    -> AsyncStream<NativeImage>
-{
-    AsyncStream { continuation in
-        Task {
-            let data: Data
-            do {
-                data = try await dataProvider()
-            } catch {
-                // Optionally handle error (e.g., log or yield a placeholder image)
-                return
-            }
-            let animatedImage = backend.renderer.decodeImageFromData(data)
-            guard let animatedImage else {
-                return
-            }
-            while let frame = animatedImage.getNextFrame() {
-                continuation.yield(frame.image)
-                if let duration = frame.duration {
-                    try? await Task.sleep(for: duration)
-                } else {
-                    break
-                }
-            }
+/// Resolves the image of `provider` through ``ImageCache/shared``, decoding
+/// the data returned by `dataProvider` if the image is not cached. Images
+/// are decoded no larger than needed to cover the physical size of
+/// `configuration`, so thumbnails of large photos take little memory.
+private func resolveCachedImage(
+    _ provider: any ImageProvider,
+    configuration: ImageConfiguration,
+    priority: ImageDecodePriority,
+    from dataProvider: @escaping () async throws -> Data
+) -> AsyncStream<NativeImage> {
+    let targetSize = configuration.physicalSize
+    return ImageCache.shared.resolve(
+        provider,
+        configuration: configuration,
+        priority: priority,
+        fetch: dataProvider,
+        decode: { backend.renderer.decodeImageFromData($0, targetSize: targetSize) }
+    )
+}
+
+public struct NetworkImage: ImageProvider {
+    public init(url: URL) {
+        self.url = url
+    }
+
+    public let url: URL
+
+    public func resolve(configuration: ImageConfiguration) -> AsyncStream<NativeImage> {
+        resolve(configuration: configuration, priority: .visible)
+    }
+
+    public func resolve(
+        configuration: ImageConfiguration,
+        priority: ImageDecodePriority
+    ) -> AsyncStream<NativeImage> {
+        resolveCachedImage(self, configuration: configuration, priority: priority) {
+            try await fetch(self.url)
         }
     }
 }
 
-public struct NetworkImage: Equatable, ImageProvider {
+/// Decodes the image file at `url`. The renderer maps the file into memory
+/// rather than reading it, so decoding a large file doesn't keep a copy of
+/// its encoded bytes around.
+public struct FileImage: ImageProvider {
     public init(url: URL) {
         self.url = url
     }
@@ -130,11 +177,25 @@ public struct NetworkImage: Equatable, ImageProvider {
     public let url: URL
 
     public func resolve(configuration: ImageConfiguration) -> AsyncStream<NativeImage> {
-        decodeAndStreamImage(from: { try await fetch(self.url) })
+        resolve(configuration: configuration, priority: .visible)
+    }
+
+    public func resolve(
+        configuration: ImageConfiguration,
+        priority: ImageDecodePriority
+    ) -> AsyncStream<NativeImage> {
+        let targetSize = configuration.physicalSize
+        return ImageCache.shared.resolve(
+            self,
+            configuration: configuration,
+            priority: priority,
+            fetch: { url },
+            decode: { backend.renderer.decodeImageFromFile($0, targetSize: targetSize) }
+        )
     }
 }
 
-public struct MemoryImage: Equatable, ImageProvider {
+public struct MemoryImage: ImageProvider {
     public init(data: Data) {
         self.data = data
     }
@@ -142,6 +203,15 @@ public struct MemoryImage: Equatable, ImageProvider {
     public let data: Data
 
     public func resolve(configuration: ImageConfiguration) -> AsyncStream<NativeImage> {
-        decodeAndStreamImage(from: { self.data })
+        resolve(configuration: configuration, priority: .visible)
+    }
+
+    public func resolve(
+        configuration: ImageConfiguration,
+        priority: ImageDecodePriority
+    ) -> AsyncStream<NativeImage> {
+        resolveCachedImage(self, configuration: configuration, priority: priority) {
+            self.data
+        }
     }
 }
@@ -90,13 +90,19 @@ public class RendererBinding {
     var beforeFrameCallbacks = CallbackList()
     var afterFrameCallbacks = CallbackList()
 
+    /// The number of frames drawn so far, including the one being drawn.
+    public private(set) var frameCount = 0
+
     func drawFrame() {
+        frameCount += 1
         beforeFrameCallbacks.call()
         defer { afterFrameCallbacks.call() }
 
-        rootRenderOwner.flushLayout()
-        rootRenderOwner.flushCompositingBits()
-        rootRenderOwner.flushPaint()
+        let timings = FrameTimingRecorder.shared
+        timings.measure(.layout) { rootRenderOwner.flushLayout() }
+        timings.measure(.compositingBits) { rootRenderOwner.flushCompositingBits() }
+        timings.measure(.paint) { rootRenderOwner.flushPaint() }
+        DisplayListOptimizer.shared.endFrame()
         if sendFramesToEngine {
             for view in renderViews {
                 view.compositeFrame()
@@ -116,7 +116,7 @@ public class PaintingContext: ClipContext {
         if !isRecording {
             return
         }
-        currentLayer!.picture = recordingCanvas!.build()
+        currentLayer!.picture = DisplayListOptimizer.shared.optimize(recordingCanvas!.build())
         currentLayer = nil
         recordingCanvas = nil
     }
@@ -377,6 +377,53 @@ public class PaintingContext: ClipContext {
             return nil
         }
     }
+
+    /// Blend further painting with an alpha value.
+    ///
+    /// The `offset` argument indicates an offset to apply to all the children
+    /// (the rendering created by `painter`).
+    ///
+    /// The `alpha` argument is the alpha value to use when blending the
+    /// painting done by `painter`. An alpha value of 0 means the painting is
+    /// fully transparent and an alpha value of 255 means the painting is fully
+    /// opaque.
+    ///
+    /// The `painter` callback will be called while the `alpha` is applied. It
+    /// is called synchronously during the call to [pushOpacity].
+    ///
+    /// Opacity is always applied with a layer. The layer applies it to the
+    /// paints of its children when they don't overlap, and only allocates an
+    /// offscreen buffer otherwise. See ``OpacityLayer``.
+    public func pushOpacity(
+        offset: Offset,
+        alpha: UInt8,
+        painter: (PaintingContext, Offset) -> Void,
+        oldLayer: OpacityLayer? = nil
+    ) -> OpacityLayer {
+        let layer = oldLayer ?? OpacityLayer()
+        layer.alpha = alpha
+        layer.offset = offset
+        pushLayer(layer, painter, .zero)
+        return layer
+    }
+
+    /// Apply a color filter to further painting.
+    ///
+    /// The `colorFilter` argument is the ``ColorFilter`` to apply to the
+    /// painting done by `painter`. Like ``pushOpacity(offset:alpha:painter:oldLayer:)``,
+    /// the filter is folded into the paints of the children when they don't
+    /// overlap. See ``ColorFilterLayer``.
+    public func pushColorFilter(
+        offset: Offset,
+        colorFilter: ColorFilter,
+        painter: (PaintingContext, Offset) -> Void,
+        oldLayer: ColorFilterLayer? = nil
+    ) -> ColorFilterLayer {
+        let layer = oldLayer ?? ColorFilterLayer(colorFilter: colorFilter)
+        layer.colorFilter = colorFilter
+        pushLayer(layer, painter, offset)
+        return layer
+    }
 }
 
 /// The pipeline owner manages the rendering pipeline.
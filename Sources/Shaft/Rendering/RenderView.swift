@@ -178,6 +178,12 @@ public class RenderView: RenderObject, RenderObjectWithSingleChild {
     }
 
     func compositeFrame() {
-        nativeView.render(LayerTree(root: layer!))
+        let layerTree = LayerTree(
+            root: layer!,
+            frameNumber: FrameTimingRecorder.shared.expectRaster(),
+            uiFrame: RendererBinding.shared.frameCount
+        )
+        FrameCapture.capture(layerTree, view: nativeView)
+        nativeView.render(layerTree)
     }
 }
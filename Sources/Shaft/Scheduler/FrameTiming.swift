@@ -0,0 +1,343 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+
+/// The interval during which a phase of a frame was running.
+public struct FrameTimingSpan: Equatable {
+    public init(start: ContinuousClock.Instant, end: ContinuousClock.Instant) {
+        self.start = start
+        self.end = end
+    }
+
+    public let start: ContinuousClock.Instant
+
+    public let end: ContinuousClock.Instant
+
+    public var duration: Duration {
+        end - start
+    }
+}
+
+/// A phase of a frame that runs on the UI thread. The raw value names the
+/// phase in benchmark reports.
+public enum FramePhase: String, CaseIterable {
+    /// ``SchedulerBinding/handleBeginFrame``, which runs transient frame
+    /// callbacks such as animation tickers.
+    case beginFrame
+
+    /// ``BuildOwner/buildScope(_:_:)``, which rebuilds dirty widgets.
+    case build
+
+    /// ``RenderOwner/flushLayout()``.
+    case layout
+
+    /// ``RenderOwner/flushCompositingBits()``.
+    case compositingBits
+
+    /// ``RenderOwner/flushPaint()``.
+    case paint
+
+    /// The name of spans of this phase on the ``Timeline``, such as
+    /// `BeginFrame`.
+    var traceName: String {
+        rawValue.prefix(1).uppercased() + rawValue.dropFirst()
+    }
+}
+
+/// Timing information about a frame, from the vsync signal that started it
+/// to the submission of its painting commands to the GPU.
+///
+/// Phases that did not run for a frame, such as raster phases of a frame
+/// that produced no layer tree, are nil.
+public struct FrameTiming {
+    /// Increases by one for every frame, starting at 1.
+    public let frameNumber: Int
+
+    /// The time stamp of the vsync signal that started the frame as reported
+    /// by the backend. This uses the clock of the backend rather than
+    /// `ContinuousClock`.
+    public let vsyncTimeStamp: Duration?
+
+    /// The phases that ran on the UI thread.
+    public internal(set) var phases: [FramePhase: FrameTimingSpan] = [:]
+
+    /// Painting the layer tree on the raster thread, including ``gpuFlush``.
+    /// When the frame is shown in several views, spans from the start of the
+    /// first to the end of the last.
+    public internal(set) var raster: FrameTimingSpan?
+
+    /// Submitting the painting commands to the GPU at the end of ``raster``.
+    /// When the frame is shown in several views, the longest submission.
+    public internal(set) var gpuFlush: FrameTimingSpan?
+
+    public var beginFrame: FrameTimingSpan? { phases[.beginFrame] }
+
+    public var build: FrameTimingSpan? { phases[.build] }
+
+    public var layout: FrameTimingSpan? { phases[.layout] }
+
+    public var compositingBits: FrameTimingSpan? { phases[.compositingBits] }
+
+    public var paint: FrameTimingSpan? { phases[.paint] }
+
+    /// The time from the start of the first UI phase to the end of the last
+    /// UI phase.
+    public var uiDuration: Duration? {
+        let spans = phases.values
+        guard let start = spans.map(\.start).min(), let end = spans.map(\.end).max() else {
+            return nil
+        }
+        return end - start
+    }
+
+    /// The time from the start of the first UI phase to the end of
+    /// rasterization, which is the latency added by the framework.
+    public var totalDuration: Duration? {
+        guard let start = phases.values.map(\.start).min() else {
+            return nil
+        }
+        let end = raster?.end ?? phases.values.map(\.end).max()!
+        return end - start
+    }
+}
+
+/// Called with the timings of frames as they complete.
+public typealias TimingsCallback = (FrameTiming) -> Void
+
+/// Collects a ``FrameTiming`` for every frame and keeps the most recent
+/// ones in a ring buffer.
+///
+/// UI phases are recorded on the UI thread by ``SchedulerBinding``,
+/// ``RendererBinding`` and ``WidgetsBinding``. Views report raster phases
+/// with ``reportRaster(frameNumber:raster:gpuFlush:)`` from their raster
+/// thread. A frame is complete once its UI phases have ended and every
+/// layer tree submitted for it has been rasterized.
+public final class FrameTimingRecorder {
+    public static let shared = FrameTimingRecorder()
+
+    public init(capacity: Int = 240) {
+        self.capacity = capacity
+    }
+
+    /// The maximum number of frames kept in ``recentTimings``.
+    public var capacity: Int {
+        didSet {
+            lock.lock()
+            defer { lock.unlock() }
+            trimRing()
+        }
+    }
+
+    /// Whether frames are recorded.
+    public var isEnabled = true
+
+    /// Completed frames, oldest first.
+    public var recentTimings: [FrameTiming] {
+        lock.lock()
+        defer { lock.unlock() }
+        return Array(ring[ringStart...] + ring[..<ringStart])
+    }
+
+    /// Calls `callback` with every completed frame. Callbacks are called on
+    /// the UI thread. Returns an identifier for ``removeListener(_:)``.
+    @discardableResult
+    public func addListener(_ callback: @escaping TimingsCallback) -> Int {
+        lock.lock()
+        defer { lock.unlock() }
+        nextListenerID += 1
+        listeners[nextListenerID] = callback
+        return nextListenerID
+    }
+
+    public func removeListener(_ id: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+        listeners.removeValue(forKey: id)
+    }
+
+    /// How listeners are called. Defaults to posting to the UI thread.
+    var deliver: (@escaping () -> Void) -> Void = { backend.runOnMainThread($0) }
+
+    private struct PendingFrame {
+        var timing: FrameTiming
+
+        /// The number of layer trees submitted for the frame that have not
+        /// been rasterized yet.
+        var pendingRasters = 0
+
+        var hasEndedUIPhases = false
+    }
+
+    /// The number of recent frames that may still wait for rasterization.
+    private static let maxPendingFrames = 16
+
+    private let clock = ContinuousClock()
+
+    private let lock = NSLock()
+
+    private var lastFrameNumber = 0
+
+    /// The frame whose UI phases are running. Only accessed on the UI thread.
+    public private(set) var currentFrameNumber: Int?
+
+    private var pending: [Int: PendingFrame] = [:]
+
+    private var ring: [FrameTiming] = []
+
+    /// The index of the oldest frame in ``ring`` once it is full.
+    private var ringStart = 0
+
+    private var listeners: [Int: TimingsCallback] = [:]
+
+    private var nextListenerID = 0
+
+    /// Starts recording a frame. Called on the UI thread when the backend
+    /// signals a vsync.
+    func beginFrame(vsyncTimeStamp: Duration?) {
+        if !isEnabled {
+            return
+        }
+        if currentFrameNumber != nil {
+            endFrame()
+        }
+        lastFrameNumber += 1
+        currentFrameNumber = lastFrameNumber
+
+        lock.lock()
+        defer { lock.unlock() }
+        // Frames whose rasterization was never reported, for example because
+        // their view was destroyed, are dropped.
+        pending = pending.filter { $0.key > lastFrameNumber - Self.maxPendingFrames }
+        pending[lastFrameNumber] = PendingFrame(
+            timing: FrameTiming(frameNumber: lastFrameNumber, vsyncTimeStamp: vsyncTimeStamp)
+        )
+    }
+
+    /// Runs `body` and records it as `phase` of the current frame, if any,
+    /// and on the ``Timeline``.
+    func measure<T>(_ phase: FramePhase, _ body: () -> T) -> T {
+        guard let frameNumber = currentFrameNumber else {
+            return Timeline.timeSync(phase.traceName, body)
+        }
+        let start = clock.now
+        let result = Timeline.timeSync(
+            phase.traceName,
+            arguments: ["frame": String(frameNumber)],
+            body
+        )
+        let span = FrameTimingSpan(start: start, end: clock.now)
+
+        lock.lock()
+        defer { lock.unlock() }
+        pending[frameNumber]?.timing.phases[phase] = span
+        return result
+    }
+
+    /// Records that a layer tree of the current frame was submitted to a
+    /// view, which will report its rasterization. Returns the frame number
+    /// to report, or nil if no frame is being recorded.
+    func expectRaster() -> Int? {
+        guard let frameNumber = currentFrameNumber else {
+            return nil
+        }
+        lock.lock()
+        defer { lock.unlock() }
+        pending[frameNumber]?.pendingRasters += 1
+        return frameNumber
+    }
+
+    /// Ends the UI phases of the current frame. Called on the UI thread.
+    func endFrame() {
+        guard let frameNumber = currentFrameNumber else {
+            return
+        }
+        currentFrameNumber = nil
+
+        lock.lock()
+        pending[frameNumber]?.hasEndedUIPhases = true
+        let completed = completeIfDone(frameNumber)
+        lock.unlock()
+
+        if let completed {
+            notify(completed)
+        }
+    }
+
+    /// Reports that a layer tree of frame `frameNumber` was rasterized. May
+    /// be called on any thread.
+    public func reportRaster(
+        frameNumber: Int,
+        raster: FrameTimingSpan,
+        gpuFlush: FrameTimingSpan?
+    ) {
+        lock.lock()
+        guard var frame = pending[frameNumber] else {
+            lock.unlock()
+            return
+        }
+        if let previous = frame.timing.raster {
+            frame.timing.raster = FrameTimingSpan(
+                start: min(previous.start, raster.start),
+                end: max(previous.end, raster.end)
+            )
+        } else {
+            frame.timing.raster = raster
+        }
+        if let gpuFlush,
+            frame.timing.gpuFlush.map({ $0.duration < gpuFlush.duration }) ?? true
+        {
+            frame.timing.gpuFlush = gpuFlush
+        }
+        frame.pendingRasters -= 1
+        pending[frameNumber] = frame
+        let completed = completeIfDone(frameNumber)
+        lock.unlock()
+
+        if let completed {
+            notify(completed)
+        }
+    }
+
+    /// Moves the frame to the ring buffer if all of its phases have ended.
+    /// Must be called with the lock held.
+    private func completeIfDone(_ frameNumber: Int) -> FrameTiming? {
+        guard let frame = pending[frameNumber], frame.hasEndedUIPhases,
+            frame.pendingRasters <= 0
+        else {
+            return nil
+        }
+        pending.removeValue(forKey: frameNumber)
+
+        if ring.count < capacity {
+            ring.append(frame.timing)
+        } else if capacity > 0 {
+            ring[ringStart] = frame.timing
+            ringStart = (ringStart + 1) % capacity
+        }
+        return frame.timing
+    }
+
+    /// Drops the oldest frames when ``capacity`` shrinks. Must be called
+    /// with the lock held.
+    private func trimRing() {
+        ring = Array((ring[ringStart...] + ring[..<ringStart]).suffix(max(capacity, 0)))
+        ringStart = 0
+    }
+
+    private func notify(_ timing: FrameTiming) {
+        lock.lock()
+        let callbacks = Array(listeners.values)
+        lock.unlock()
+
+        if callbacks.isEmpty {
+            return
+        }
+        deliver {
+            for callback in callbacks {
+                callback(timing)
+            }
+        }
+    }
+}
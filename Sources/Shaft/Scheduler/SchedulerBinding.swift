@@ -193,11 +193,14 @@ public class SchedulerBinding {
         assert(schedulerPhase == .idle)
         hasScheduledFrame = false
 
-        schedulerPhase = .transientCallbacks
-        let localTransientCallbacks = transientCallbacks.values
-        transientCallbacks.removeAll()
-        for callback in localTransientCallbacks {
-            callback(currentFrameTimeStamp)
+        FrameTimingRecorder.shared.beginFrame(vsyncTimeStamp: timeStamp)
+        FrameTimingRecorder.shared.measure(.beginFrame) {
+            schedulerPhase = .transientCallbacks
+            let localTransientCallbacks = transientCallbacks.values
+            transientCallbacks.removeAll()
+            for callback in localTransientCallbacks {
+                callback(currentFrameTimeStamp)
+            }
         }
 
         schedulerPhase = .midFrameMicrotasks
@@ -244,6 +247,25 @@ public class SchedulerBinding {
         }
 
         schedulerPhase = .idle
+        FrameTimingRecorder.shared.endFrame()
+    }
+
+    // MARK: - Frame Timings
+
+    /// Adds a callback that is called with the ``FrameTiming`` of every frame
+    /// once it has been rasterized. Returns an identifier for
+    /// ``removeTimingsCallback(_:)``.
+    ///
+    /// The most recent timings are also available from
+    /// ``FrameTimingRecorder/recentTimings``.
+    @discardableResult
+    public func addTimingsCallback(_ callback: @escaping TimingsCallback) -> Int {
+        FrameTimingRecorder.shared.addListener(callback)
+    }
+
+    /// Removes a callback added with ``addTimingsCallback(_:)``.
+    public func removeTimingsCallback(_ id: Int) {
+        FrameTimingRecorder.shared.removeListener(id)
     }
 
     // MARK: - Frame Callbacks
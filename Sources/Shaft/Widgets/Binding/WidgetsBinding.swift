@@ -148,7 +148,9 @@ public class WidgetsBinding {
 
     private func beforeDrawFrame() {
         if let rootElement {
-            buildOwner.buildScope(rootElement)
+            FrameTimingRecorder.shared.measure(.build) {
+                buildOwner.buildScope(rootElement)
+            }
         }
     }
 
@@ -213,6 +215,9 @@ public class WidgetsBinding {
         for observer in observers {
             observer.didChangeAppLifecycleState(state: state)
         }
+        if let renderer = backend.renderer as? GPUResourceCacheRenderer {
+            renderer.purgeResources(for: state)
+        }
     }
 }
 
@@ -453,6 +453,25 @@ public final class Image: StatefulWidget {
     }
 }
 
+/// Decodes the image of `provider` ahead of time, so that an ``Image`` that
+/// shows it later at `size` doesn't have to wait for it. The decode runs
+/// after the decodes of images on screen. Returns once the image is decoded
+/// or has failed to decode. Cancelling the calling task cancels the decode
+/// unless a widget is showing the image.
+public func precacheImage(
+    _ provider: any ImageProvider,
+    context: BuildContext,
+    size: Size? = nil
+) async {
+    let configuration = ImageConfiguration(
+        devicePixelRatio: MediaQuery.maybeDevicePixelRatioOf(context),
+        size: size
+    )
+    for await _ in provider.resolve(configuration: configuration, priority: .prefetch) {
+        return
+    }
+}
+
 public final class ImageState: State<Image> {
     public override func initState() {
         super.initState()
@@ -490,6 +509,7 @@ public final class ImageState: State<Image> {
             }
 
         let configuration = ImageConfiguration(
+            devicePixelRatio: MediaQuery.maybeDevicePixelRatioOf(context),
             size: size
         )
 
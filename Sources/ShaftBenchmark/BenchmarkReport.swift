@@ -0,0 +1,226 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+import Shaft
+
+/// The results of a benchmark run, encoded as JSON.
+struct BenchmarkReport: Codable {
+    var frames: Int
+
+    var warmupFrames: Int
+
+    var viewWidth: Int
+
+    var viewHeight: Int
+
+    var scenes: [SceneResult]
+}
+
+/// The results of one scene.
+struct SceneResult: Codable {
+    var name: String
+
+    /// Frames that were measured, excluding warm-up frames.
+    var frames: Int
+
+    /// Statistics of every phase in microseconds, keyed by phase name.
+    var phases: [String: PhaseStatistics]
+
+    var heap: HeapResult?
+}
+
+/// Summary statistics of a phase over the measured frames, in microseconds.
+struct PhaseStatistics: Codable {
+    var samples: Int
+
+    var mean: Double
+
+    var p50: Double
+
+    var p90: Double
+
+    var p99: Double
+
+    var max: Double
+
+    /// Returns the statistics of `samples`, or nil if there are none.
+    init?(_ samples: [Double]) {
+        if samples.isEmpty {
+            return nil
+        }
+        let sorted = samples.sorted()
+        self.samples = sorted.count
+        self.mean = sorted.reduce(0, +) / Double(sorted.count)
+        self.p50 = percentile(sorted, 0.5)
+        self.p90 = percentile(sorted, 0.9)
+        self.p99 = percentile(sorted, 0.99)
+        self.max = sorted.last!
+    }
+}
+
+/// The nearest-rank percentile of sorted values.
+private func percentile<T>(_ sorted: [T], _ fraction: Double) -> T {
+    let rank = Int((fraction * Double(sorted.count)).rounded(.up))
+    return sorted[max(rank, 1) - 1]
+}
+
+/// How much the heap grew or shrank over each measured frame. See
+/// ``HeapStatistics``.
+///
+/// These are not allocation counts. Memory that is allocated and freed
+/// within the same frame leaves no trace, so a change that adds short-lived
+/// allocations to every frame does not show up here.
+struct HeapResult: Codable {
+    /// Blocks in use after each frame minus before it.
+    var blocksInUseChange: HeapChangeStatistics?
+
+    /// Bytes in use after each frame minus before it.
+    var bytesInUseChange: HeapChangeStatistics?
+
+    /// Bytes in use after the last frame minus before the first measured one.
+    var totalGrowthBytes: Int
+}
+
+/// Summary statistics of how a heap counter changed over the measured frames,
+/// in the unit of the counter. Values are negative for frames that freed
+/// more than they kept.
+struct HeapChangeStatistics: Codable {
+    var samples: Int
+
+    var mean: Double
+
+    var min: Int
+
+    var p50: Int
+
+    var p90: Int
+
+    var max: Int
+
+    /// Returns the statistics of `samples`, or nil if there are none.
+    init?(_ samples: [Int]) {
+        if samples.isEmpty {
+            return nil
+        }
+        let sorted = samples.sorted()
+        self.samples = sorted.count
+        self.mean = Double(sorted.reduce(0, +)) / Double(sorted.count)
+        self.min = sorted.first!
+        self.p50 = percentile(sorted, 0.5)
+        self.p90 = percentile(sorted, 0.9)
+        self.max = sorted.last!
+    }
+}
+
+extension SceneResult {
+    /// Summarizes the timings of the measured frames of a scene.
+    init(name: String, timings: [FrameTiming], heapDeltas: [HeapDelta], heapGrowth: Int?) {
+        func micros(_ duration: Duration?) -> Double? {
+            duration.map { Double($0.inMicroseconds) }
+        }
+
+        var samples: [String: [Double]] = [:]
+        for timing in timings {
+            for phase in FramePhase.allCases {
+                if let value = micros(timing.phases[phase]?.duration) {
+                    samples[phase.rawValue, default: []].append(value)
+                }
+            }
+            if let value = micros(timing.raster?.duration) {
+                samples["raster", default: []].append(value)
+            }
+            if let value = micros(timing.gpuFlush?.duration) {
+                samples["gpuFlush", default: []].append(value)
+            }
+            if let value = micros(timing.uiDuration) {
+                samples["ui", default: []].append(value)
+            }
+            if let value = micros(timing.totalDuration) {
+                samples["total", default: []].append(value)
+            }
+        }
+
+        self.name = name
+        self.frames = timings.count
+        self.phases = samples.compactMapValues(PhaseStatistics.init)
+        self.heap = heapGrowth.map { growth in
+            HeapResult(
+                blocksInUseChange: HeapChangeStatistics(heapDeltas.compactMap(\.blocks)),
+                bytesInUseChange: HeapChangeStatistics(heapDeltas.map(\.bytes)),
+                totalGrowthBytes: growth
+            )
+        }
+    }
+}
+
+/// The change of the heap over one frame.
+struct HeapDelta {
+    var bytes: Int
+
+    var blocks: Int?
+
+    init(from before: HeapStatistics, to after: HeapStatistics) {
+        bytes = after.bytesInUse - before.bytesInUse
+        if let start = before.blocksInUse, let end = after.blocksInUse {
+            blocks = end - start
+        }
+    }
+}
+
+// MARK: - Baseline comparison
+
+/// A phase whose median got slower than in the baseline.
+struct Regression: Codable {
+    var scene: String
+
+    var phase: String
+
+    var baselineP50: Double
+
+    var currentP50: Double
+
+    /// `currentP50 / baselineP50`.
+    var ratio: Double
+}
+
+extension BenchmarkReport {
+    /// Compares the median of every phase with `baseline` and returns the
+    /// phases that got slower by more than `threshold`, as a fraction of the
+    /// baseline. Differences below `noiseFloor` microseconds are ignored, as
+    /// short phases vary a lot relative to their duration.
+    func regressions(
+        against baseline: BenchmarkReport,
+        threshold: Double,
+        noiseFloor: Double = 20
+    ) -> [Regression] {
+        var result: [Regression] = []
+        for scene in scenes {
+            guard let baselineScene = baseline.scenes.first(where: { $0.name == scene.name })
+            else {
+                continue
+            }
+            for (phase, stats) in scene.phases.sorted(by: { $0.key < $1.key }) {
+                guard let baselineStats = baselineScene.phases[phase],
+                    baselineStats.p50 > 0
+                else {
+                    continue
+                }
+                let ratio = stats.p50 / baselineStats.p50
+                if ratio > 1 + threshold && stats.p50 - baselineStats.p50 > noiseFloor {
+                    result.append(
+                        Regression(
+                            scene: scene.name,
+                            phase: phase,
+                            baselineP50: baselineStats.p50,
+                            currentP50: stats.p50,
+                            ratio: ratio
+                        )
+                    )
+                }
+            }
+        }
+        return result
+    }
+}
@@ -0,0 +1,79 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Shaft
+
+/// Runs scenes one after another in the same view and collects their frame
+/// timings from ``FrameTimingRecorder``.
+final class BenchmarkRunner {
+    init(backend: HeadlessBackend, frames: Int, warmupFrames: Int) {
+        self.backend = backend
+        self.frames = frames
+        self.warmupFrames = warmupFrames
+
+        guard let view = backend.createView() else {
+            fatalError("Failed to create headless view")
+        }
+        self.view = view
+    }
+
+    let backend: HeadlessBackend
+
+    /// The number of frames measured per scene.
+    let frames: Int
+
+    /// The number of frames run per scene before measuring, to fill caches
+    /// and build the widgets that are reused later.
+    let warmupFrames: Int
+
+    let view: NativeView
+
+    func run(_ scene: BenchmarkScene) -> SceneResult {
+        // Attaching a new root replaces the previous scene.
+        runApp(scene.makeWidget(), view: view)
+
+        var frame = 0
+        for _ in 0..<warmupFrames {
+            pump(scene, frame: &frame)
+        }
+
+        // Views rasterize synchronously, so every frame is complete and
+        // delivered to listeners by the time `pump` returns.
+        var timings: [FrameTiming] = []
+        timings.reserveCapacity(frames)
+        let listener = FrameTimingRecorder.shared.addListener { timings.append($0) }
+        defer { FrameTimingRecorder.shared.removeListener(listener) }
+
+        var heapDeltas: [HeapDelta] = []
+        heapDeltas.reserveCapacity(frames)
+        let heapStart = HeapStatistics.current()
+        for _ in 0..<frames {
+            let before = HeapStatistics.current()
+            pump(scene, frame: &frame)
+            if let before, let after = HeapStatistics.current() {
+                heapDeltas.append(HeapDelta(from: before, to: after))
+            }
+        }
+        var heapGrowth: Int?
+        if let heapStart, let heapEnd = HeapStatistics.current() {
+            heapGrowth = heapEnd.bytesInUse - heapStart.bytesInUse
+        }
+
+        return SceneResult(
+            name: scene.name,
+            timings: timings,
+            heapDeltas: heapDeltas,
+            heapGrowth: heapGrowth
+        )
+    }
+
+    /// Advances `scene` and produces a frame. Returns whether a frame was
+    /// produced; scenes that request no frame are idle for that frame.
+    @discardableResult
+    private func pump(_ scene: BenchmarkScene, frame: inout Int) -> Bool {
+        scene.advance(to: frame)
+        frame += 1
+        return backend.pumpFrame()
+    }
+}
@@ -0,0 +1,308 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Foundation
+import Shaft
+import ShaftSkia
+import SwiftMath
+
+/// A ``Backend`` without windows or an event loop that renders into raster
+/// surfaces. Frames are produced only when ``pumpFrame()`` is called, on a
+/// virtual clock that advances by ``frameInterval`` per frame, so runs are
+/// repeatable regardless of how long each frame takes.
+final class HeadlessBackend: Backend {
+    init(renderer: SkiaRasterRenderer, viewSize: ISize, devicePixelRatio: Float = 1) {
+        self.rasterRenderer = renderer
+        self.viewSize = viewSize
+        self.devicePixelRatio = devicePixelRatio
+    }
+
+    let rasterRenderer: SkiaRasterRenderer
+
+    var renderer: Renderer { rasterRenderer }
+
+    /// The physical size of views created by this backend.
+    let viewSize: ISize
+
+    let devicePixelRatio: Float
+
+    /// The time the virtual clock advances for every frame.
+    var frameInterval: Duration = .microseconds(16_667)
+
+    /// The current time on the virtual clock.
+    private(set) var currentTime: Duration = .zero
+
+    // MARK: - Views
+
+    private var views: [Int: HeadlessView] = [:]
+
+    private var nextViewID = 0
+
+    func createView() -> NativeView? {
+        nextViewID += 1
+        let view = HeadlessView(
+            viewID: nextViewID,
+            renderer: rasterRenderer,
+            physicalSize: viewSize,
+            devicePixelRatio: devicePixelRatio
+        )
+        views[view.viewID] = view
+        return view
+    }
+
+    func destroyView(_ view: NativeView) {
+        views.removeValue(forKey: view.viewID)?.isDestroyed = true
+    }
+
+    func view(_ viewId: Int) -> NativeView? {
+        views[viewId]
+    }
+
+    // MARK: - Input
+
+    var onPointerData: PointerDataCallback?
+
+    var onKeyEvent: KeyEventCallback?
+
+    func getKeyboardState() -> [PhysicalKeyboardKey: LogicalKeyboardKey]? {
+        [:]
+    }
+
+    func launchUrl(_ url: String) -> Bool {
+        false
+    }
+
+    // MARK: - Frames
+
+    var onMetricsChanged: MetricsChangedCallback?
+
+    var onBeginFrame: FrameCallback?
+
+    var onDrawFrame: VoidCallback?
+
+    var lifecycleState: AppLifecycleState { .resumed }
+
+    var onAppLifecycleStateChanged: AppLifecycleStateCallback?
+
+    /// Whether the framework has requested a frame since the last one.
+    private(set) var hasScheduledFrame = false
+
+    func scheduleFrame() {
+        hasScheduledFrame = true
+    }
+
+    /// Advances the virtual clock by one frame, runs due timers and posted
+    /// tasks, and produces a frame if one was scheduled. Returns whether a
+    /// frame was produced.
+    @discardableResult
+    func pumpFrame() -> Bool {
+        currentTime += frameInterval
+        runTimers()
+        drainTasks()
+
+        guard hasScheduledFrame else {
+            return false
+        }
+        hasScheduledFrame = false
+        onBeginFrame?(currentTime)
+        onDrawFrame?()
+        drainTasks()
+        return true
+    }
+
+    /// Frames are driven by ``pumpFrame()``, so there is no loop to run.
+    func run() {}
+
+    func stop() {}
+
+    // MARK: - Tasks
+
+    var isMainThread: Bool { Thread.isMainThread }
+
+    private var tasks: [() -> Void] = []
+
+    private let taskLock = NSLock()
+
+    func postTask(_ f: @escaping () -> Void) {
+        taskLock.lock()
+        defer { taskLock.unlock() }
+        tasks.append(f)
+    }
+
+    private func drainTasks() {
+        while true {
+            taskLock.lock()
+            let pending = tasks
+            tasks.removeAll()
+            taskLock.unlock()
+
+            if pending.isEmpty {
+                return
+            }
+            for task in pending {
+                task()
+            }
+        }
+    }
+
+    // MARK: - Timers
+
+    private var timers: [HeadlessTimer] = []
+
+    func createTimer(
+        _ delay: Duration,
+        repeat shouldRepeat: Bool,
+        callback: @escaping () -> Void
+    ) -> Shaft.Timer {
+        let timer = HeadlessTimer(
+            deadline: currentTime + delay,
+            interval: shouldRepeat ? delay : nil,
+            callback: callback
+        )
+        timers.append(timer)
+        return timer
+    }
+
+    /// Fires timers whose deadline has passed on the virtual clock.
+    private func runTimers() {
+        let due = timers.filter { $0.isActive && $0.deadline <= currentTime }
+        for timer in due {
+            if let interval = timer.interval {
+                timer.deadline = currentTime + max(interval, frameInterval)
+            } else {
+                timer.isActive = false
+            }
+            timer.callback()
+        }
+        timers.removeAll { !$0.isActive }
+    }
+
+    // MARK: - Platform
+
+    var targetPlatform: TargetPlatform? {
+        #if os(macOS)
+            .macOS
+        #elseif os(Windows)
+            .windows
+        #else
+            .linux
+        #endif
+    }
+
+    func createCursor(_ cursor: SystemMouseCursor) -> NativeMouseCursor? {
+        nil
+    }
+
+    var locales: [Shaft.Locale] {
+        [Shaft.Locale("en", countryCode: "US")]
+    }
+}
+
+private final class HeadlessTimer: Shaft.Timer {
+    init(deadline: Duration, interval: Duration?, callback: @escaping () -> Void) {
+        self.deadline = deadline
+        self.interval = interval
+        self.callback = callback
+    }
+
+    var deadline: Duration
+
+    let interval: Duration?
+
+    let callback: () -> Void
+
+    var isActive = true
+
+    func cancel() {
+        isActive = false
+    }
+}
+
+/// A ``NativeView`` that rasterizes layer trees on the CPU as soon as they
+/// are submitted and reports the raster phases to ``FrameTimingRecorder``.
+final class HeadlessView: NativeView {
+    init(
+        viewID: Int,
+        renderer: SkiaRasterRenderer,
+        physicalSize: ISize,
+        devicePixelRatio: Float
+    ) {
+        self.viewID = viewID
+        self.physicalSize = physicalSize
+        self.devicePixelRatio = devicePixelRatio
+        self.canvas = renderer.createRasterCanvas(size: physicalSize)
+    }
+
+    let viewID: Int
+
+    let physicalSize: ISize
+
+    let devicePixelRatio: Float
+
+    /// The canvas that layer trees are painted into. Kept across frames so
+    /// that raster and picture caches behave as they do on screen.
+    let canvas: RasterCanvas
+
+    /// The number of layer trees rasterized by this view.
+    private(set) var frameCount = 0
+
+    func render(_ layerTree: LayerTree) {
+        let start = ContinuousClock.now
+        Timeline.timeSync("Rasterize") {
+            canvas.clear(color: .init(0x0000_0000))
+            layerTree.paint(
+                context: LayerPaintContext(
+                    canvas: canvas,
+                    rasterCache: canvas.rasterCache,
+                    cullRect: Rect(
+                        left: 0,
+                        top: 0,
+                        right: Float(physicalSize.width),
+                        bottom: Float(physicalSize.height)
+                    )
+                )
+            )
+        }
+        let flushStart = ContinuousClock.now
+        Timeline.timeSync("GPU flush") {
+            canvas.flush()
+        }
+        let end = ContinuousClock.now
+        frameCount += 1
+
+        if let frameNumber = layerTree.frameNumber {
+            FrameTimingRecorder.shared.reportRaster(
+                frameNumber: frameNumber,
+                raster: FrameTimingSpan(start: start, end: end),
+                gpuFlush: FrameTimingSpan(start: flushStart, end: end)
+            )
+        }
+    }
+
+    // MARK: - Text input
+
+    func startTextInput() {
+        textInputActive = true
+    }
+
+    func stopTextInput() {
+        textInputActive = false
+    }
+
+    func setComposingRect(_ rect: Rect) {}
+
+    func setEditableSizeAndTransform(_ size: Size, _ transform: Matrix4x4f) {}
+
+    private(set) var textInputActive = false
+
+    var onTextEditing: TextEditingCallback?
+
+    var onTextComposed: TextComposedCallback?
+
+    var onTextInputClosed: VoidCallback?
+
+    var title = ""
+
+    fileprivate(set) var isDestroyed = false
+}
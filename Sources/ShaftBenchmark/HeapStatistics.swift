@@ -0,0 +1,39 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if canImport(Darwin)
+    import Darwin
+#elseif canImport(Glibc)
+    import Glibc
+#endif
+
+/// A snapshot of the malloc heap of the process.
+///
+/// The system allocator doesn't count allocations without interposing
+/// malloc, so only the blocks and bytes in use can be compared before and
+/// after each frame. That shows memory that a frame keeps, not how much it
+/// allocates.
+struct HeapStatistics {
+    /// Bytes in allocated blocks.
+    var bytesInUse: Int
+
+    /// Allocated blocks, or nil if the allocator doesn't report them.
+    var blocksInUse: Int?
+
+    static func current() -> HeapStatistics? {
+        #if canImport(Darwin)
+            var stats = malloc_statistics_t()
+            malloc_zone_statistics(nil, &stats)
+            return HeapStatistics(
+                bytesInUse: Int(stats.size_in_use),
+                blocksInUse: Int(stats.blocks_in_use)
+            )
+        #elseif canImport(Glibc)
+            let info = mallinfo2()
+            return HeapStatistics(bytesInUse: Int(info.uordblks + info.hblkhd), blocksInUse: nil)
+        #else
+            return nil
+        #endif
+    }
+}
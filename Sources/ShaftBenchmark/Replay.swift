@@ -0,0 +1,85 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Shaft
+import ShaftSkia
+
+/// Rasterizes the layer trees of a frame capture without running the
+/// framework, so that changes to the rasterizer can be measured on frames
+/// recorded from a real app. See ``FrameCapture``.
+final class CaptureReplayer {
+    init(renderer: SkiaRasterRenderer, frames: [CapturedFrame]) {
+        self.renderer = renderer
+        self.frames = frames
+    }
+
+    let renderer: SkiaRasterRenderer
+
+    let frames: [CapturedFrame]
+
+    /// The canvas of the current frame size. Kept across frames so that
+    /// raster and picture caches behave as they do on screen.
+    private var canvas: RasterCanvas?
+
+    private var canvasSize: ISize?
+
+    /// Rasterizes every frame `iterations` times, in the order they were
+    /// captured, and reports the time spent per frame.
+    func run(name: String, iterations: Int) -> SceneResult {
+        var raster: [Double] = []
+        var gpuFlush: [Double] = []
+        raster.reserveCapacity(frames.count * iterations)
+        gpuFlush.reserveCapacity(frames.count * iterations)
+
+        for _ in 0..<iterations {
+            for frame in frames {
+                let (rasterDuration, flushDuration) = rasterize(frame)
+                raster.append(Double(rasterDuration.inMicroseconds))
+                gpuFlush.append(Double(flushDuration.inMicroseconds))
+            }
+        }
+
+        var phases: [String: PhaseStatistics] = [:]
+        phases["raster"] = PhaseStatistics(raster)
+        phases["gpuFlush"] = PhaseStatistics(gpuFlush)
+        return SceneResult(name: name, frames: raster.count, phases: phases, heap: nil)
+    }
+
+    private func rasterize(_ frame: CapturedFrame) -> (Duration, Duration) {
+        let canvas = canvas(for: frame.physicalSize)
+
+        let start = ContinuousClock.now
+        Timeline.timeSync("Rasterize") {
+            canvas.clear(color: .init(0x0000_0000))
+            frame.layerTree.paint(
+                context: LayerPaintContext(
+                    canvas: canvas,
+                    rasterCache: canvas.rasterCache,
+                    cullRect: Rect(
+                        left: 0,
+                        top: 0,
+                        right: Float(frame.physicalSize.width),
+                        bottom: Float(frame.physicalSize.height)
+                    )
+                )
+            )
+        }
+        let flushStart = ContinuousClock.now
+        Timeline.timeSync("GPU flush") {
+            canvas.flush()
+        }
+        let end = ContinuousClock.now
+        return (end - start, end - flushStart)
+    }
+
+    private func canvas(for size: ISize) -> RasterCanvas {
+        if let canvas, canvasSize == size {
+            return canvas
+        }
+        let canvas = renderer.createRasterCanvas(size: size)
+        self.canvas = canvas
+        self.canvasSize = size
+        return canvas
+    }
+}
@@ -0,0 +1,211 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import Observation
+import Shaft
+import ShaftCodeHighlight
+import ShaftMarkdown
+
+/// A widget tree that is driven through the frame pipeline by the benchmark.
+///
+/// Before every frame, ``advance(to:)`` changes the scene the way a user or
+/// an animation would, so that each frame has build, layout and paint work
+/// to do.
+protocol BenchmarkScene: AnyObject {
+    /// The name used to select the scene and to key its results.
+    var name: String { get }
+
+    func makeWidget() -> Widget
+
+    /// Prepares frame `frame`, counting from 0.
+    func advance(to frame: Int)
+}
+
+/// All scenes in the order they run by default.
+let allScenes: [() -> BenchmarkScene] = [
+    { ListViewScene() },
+    { DeepFlexScene() },
+    { LargeWrapScene() },
+    { MarkdownScene() },
+    { CodeHighlightScene() },
+]
+
+/// State read during build so that scenes rebuild when it changes.
+@Observable
+final class SceneTick {
+    var frame = 0
+}
+
+/// Scrolls a lazily built list of 10,000 items by a bit more than a screen
+/// every frame, so that items are built and discarded continuously.
+final class ListViewScene: BenchmarkScene {
+    let name = "list_view"
+
+    static let itemCount = 10_000
+
+    static let itemExtent: Float = 48
+
+    let controller = ScrollController()
+
+    func makeWidget() -> Widget {
+        ListView(
+            controller: controller,
+            itemExtent: Self.itemExtent,
+            itemBuilder: { context, index in
+                Row {
+                    SizedBox(width: 32, height: 32) {
+                        ColoredBox(color: Color(0xFF00_0000 | UInt32(index * 2_654_435_761 & 0xFF_FFFF)))
+                    }
+                    .padding(.all(8))
+                    Expanded {
+                        Text("Item \(index)")
+                    }
+                }
+            },
+            itemCount: Self.itemCount
+        )
+    }
+
+    func advance(to frame: Int) {
+        guard controller.hasClients else {
+            return
+        }
+        let extent = Float(Self.itemCount) * Self.itemExtent
+        controller.position.jumpTo((Float(frame) * 997).truncatingRemainder(dividingBy: extent))
+    }
+}
+
+/// Nests rows and columns 64 levels deep and changes the padding at the
+/// bottom every frame, which relayouts the whole chain.
+final class DeepFlexScene: BenchmarkScene {
+    let name = "deep_flex"
+
+    static let depth = 64
+
+    let tick = SceneTick()
+
+    func makeWidget() -> Widget {
+        Builder { [tick] context in
+            Self.nest(depth: Self.depth, inset: Float(tick.frame % 4))
+        }
+    }
+
+    private static func nest(depth: Int, inset: Float) -> Widget {
+        if depth == 0 {
+            return Text("Leaf")
+                .padding(.all(inset))
+        }
+        return Flex(direction: depth.isMultiple(of: 2) ? .horizontal : .vertical) {
+            SizedBox(width: 2, height: 2) {
+                ColoredBox(color: Color(0xFF80_8080))
+            }
+            Expanded {
+                nest(depth: depth - 1, inset: inset)
+            }
+        }
+    }
+
+    func advance(to frame: Int) {
+        tick.frame = frame
+    }
+}
+
+/// Lays out 2,000 chips in a wrap whose spacing changes every frame.
+final class LargeWrapScene: BenchmarkScene {
+    let name = "large_wrap"
+
+    static let chipCount = 2_000
+
+    let tick = SceneTick()
+
+    func makeWidget() -> Widget {
+        Builder { [tick] context in
+            Wrap(spacing: Float(4 + tick.frame % 3), runSpacing: 4) {
+                for index in 0..<Self.chipCount {
+                    Text("chip \(index)")
+                        .padding(.all(4))
+                }
+            }
+        }
+    }
+
+    func advance(to frame: Int) {
+        tick.frame = frame
+    }
+}
+
+/// Renders a long markdown document while alternating its width, which
+/// lays out every paragraph again.
+final class MarkdownScene: BenchmarkScene {
+    let name = "markdown"
+
+    let tick = SceneTick()
+
+    static let document: String = (0..<40).map { section in
+        """
+        ## Section \(section)
+
+        Lorem ipsum dolor sit amet, **consectetur** adipiscing elit, sed do \
+        eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad \
+        minim veniam, quis nostrud *exercitation* ullamco laboris nisi ut \
+        aliquip ex ea commodo consequat. Duis aute irure dolor in \
+        `reprehenderit` in voluptate velit esse cillum dolore eu fugiat nulla.
+
+        - First item of section \(section)
+        - Second item with a [link](https://example.com/\(section))
+        - Third item
+
+        """
+    }.joined(separator: "\n")
+
+    func makeWidget() -> Widget {
+        Builder { [tick] context in
+            SingleChildScrollView {
+                SizedBox(width: tick.frame.isMultiple(of: 2) ? 600 : 640) {
+                    MarkdownView(Self.document)
+                }
+            }
+        }
+    }
+
+    func advance(to frame: Int) {
+        tick.frame = frame
+    }
+}
+
+/// Highlights a large Swift source file and alternates its width, which
+/// lays out the highlighted text again.
+final class CodeHighlightScene: BenchmarkScene {
+    let name = "code_highlight"
+
+    let tick = SceneTick()
+
+    static let code: String = (0..<60).map { index in
+        """
+        /// Computes the value of step \(index).
+        func step\(index)(_ input: [Int]) -> Int {
+            var total = 0
+            for (offset, value) in input.enumerated() where value % \(index + 2) == 0 {
+                total += value * offset + \(index)
+            }
+            return total > 1_000 ? total / 2 : total
+        }
+
+        """
+    }.joined(separator: "\n")
+
+    func makeWidget() -> Widget {
+        Builder { [tick] context in
+            SingleChildScrollView {
+                SizedBox(width: tick.frame.isMultiple(of: 2) ? 600 : 640) {
+                    CodeBlock(code: Self.code)
+                }
+            }
+        }
+    }
+
+    func advance(to frame: Int) {
+        tick.frame = frame
+    }
+}
@@ -0,0 +1,199 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Renders a set of widget trees headlessly and reports how long each phase
+// of the frame pipeline took.
+//
+//   swift run -c release ShaftBenchmark [options]
+//
+// Options:
+//   --scene <name>        Run only the named scene. Can be repeated.
+//   --frames <n>          Frames measured per scene (default 300).
+//   --warmup <n>          Frames run per scene before measuring (default 30).
+//   --size <w>x<h>        Size of the view in pixels (default 800x600).
+//   --output <path>       Write the JSON report to a file instead of stdout.
+//   --baseline <path>     Compare with a previous report and exit with 1 if
+//                         the median of any phase regressed.
+//   --threshold <ratio>   Allowed slowdown for --baseline (default 0.1).
+//   --list                Print the names of the scenes.
+//   --replay <path>       Rasterize the frames of a capture written by
+//                         FrameCapture instead of running the scenes.
+//   --iterations <n>      Times the frames of --replay are rasterized
+//                         (default 10).
+
+import Foundation
+import Shaft
+import ShaftSkia
+
+struct Options {
+    var scenes: [String] = []
+    var frames = 300
+    var warmup = 30
+    var width = 800
+    var height = 600
+    var output: String?
+    var baseline: String?
+    var threshold = 0.1
+    var list = false
+    var replay: String?
+    var iterations = 10
+}
+
+func fail(_ message: String) -> Never {
+    FileHandle.standardError.write(Data("ShaftBenchmark: \(message)\n".utf8))
+    exit(2)
+}
+
+func parseOptions(_ arguments: ArraySlice<String>) -> Options {
+    var options = Options()
+    var arguments = arguments
+
+    func value(for flag: String) -> String {
+        guard let value = arguments.popFirst() else {
+            fail("missing value for \(flag)")
+        }
+        return value
+    }
+
+    func number<T: LosslessStringConvertible>(for flag: String) -> T {
+        guard let number = T(value(for: flag)) else {
+            fail("invalid value for \(flag)")
+        }
+        return number
+    }
+
+    while let flag = arguments.popFirst() {
+        switch flag {
+        case "--scene":
+            options.scenes.append(value(for: flag))
+        case "--frames":
+            options.frames = number(for: flag)
+        case "--warmup":
+            options.warmup = number(for: flag)
+        case "--size":
+            let parts = value(for: flag).split(separator: "x").compactMap { Int($0) }
+            guard parts.count == 2, parts.allSatisfy({ $0 > 0 }) else {
+                fail("invalid value for --size, expected <width>x<height>")
+            }
+            options.width = parts[0]
+            options.height = parts[1]
+        case "--output":
+            options.output = value(for: flag)
+        case "--baseline":
+            options.baseline = value(for: flag)
+        case "--threshold":
+            options.threshold = number(for: flag)
+        case "--list":
+            options.list = true
+        case "--replay":
+            options.replay = value(for: flag)
+        case "--iterations":
+            options.iterations = number(for: flag)
+        default:
+            fail("unknown option \(flag)")
+        }
+    }
+    return options
+}
+
+let options = parseOptions(CommandLine.arguments.dropFirst())
+
+var scenes = allScenes.map { $0() }
+if options.list {
+    for scene in scenes {
+        print(scene.name)
+    }
+    exit(0)
+}
+if !options.scenes.isEmpty {
+    for name in options.scenes where !scenes.contains(where: { $0.name == name }) {
+        fail("unknown scene \(name)")
+    }
+    scenes = scenes.filter { options.scenes.contains($0.name) }
+}
+
+var report = BenchmarkReport(
+    frames: options.frames,
+    warmupFrames: options.warmup,
+    viewWidth: options.width,
+    viewHeight: options.height,
+    scenes: []
+)
+
+if let replayPath = options.replay {
+    let renderer = SkiaRasterRenderer()
+    let frames: [CapturedFrame]
+    do {
+        frames = try FrameCapture.load(from: URL(fileURLWithPath: replayPath), codec: renderer)
+    } catch {
+        fail("cannot read capture \(replayPath): \(error)")
+    }
+    guard let first = frames.first else {
+        fail("capture \(replayPath) contains no frames")
+    }
+
+    let replayer = CaptureReplayer(renderer: renderer, frames: frames)
+    let name = URL(fileURLWithPath: replayPath).deletingPathExtension().lastPathComponent
+    FileHandle.standardError.write(Data("Replaying \(frames.count) frames of \(name)...\n".utf8))
+    report.frames = frames.count * options.iterations
+    report.warmupFrames = 0
+    report.viewWidth = first.physicalSize.width
+    report.viewHeight = first.physicalSize.height
+    report.scenes.append(replayer.run(name: name, iterations: options.iterations))
+} else {
+    let headlessBackend = HeadlessBackend(
+        renderer: SkiaRasterRenderer(),
+        viewSize: ISize(options.width, options.height)
+    )
+    backend = headlessBackend
+
+    let runner = BenchmarkRunner(
+        backend: headlessBackend,
+        frames: options.frames,
+        warmupFrames: options.warmup
+    )
+
+    for scene in scenes {
+        FileHandle.standardError.write(Data("Running \(scene.name)...\n".utf8))
+        report.scenes.append(runner.run(scene))
+    }
+}
+
+let encoder = JSONEncoder()
+encoder.outputFormatting = [.prettyPrinted, .sortedKeys]
+let json = try encoder.encode(report)
+if let output = options.output {
+    try json.write(to: URL(fileURLWithPath: output))
+} else {
+    FileHandle.standardOutput.write(json)
+    FileHandle.standardOutput.write(Data("\n".utf8))
+}
+
+if let baselinePath = options.baseline {
+    let baseline: BenchmarkReport
+    do {
+        let data = try Data(contentsOf: URL(fileURLWithPath: baselinePath))
+        baseline = try JSONDecoder().decode(BenchmarkReport.self, from: data)
+    } catch {
+        fail("cannot read baseline \(baselinePath): \(error)")
+    }
+
+    let regressions = report.regressions(against: baseline, threshold: options.threshold)
+    for regression in regressions {
+        let percent = Int(((regression.ratio - 1) * 100).rounded())
+        FileHandle.standardError.write(
+            Data(
+                """
+                Regression in \(regression.scene)/\(regression.phase): \
+                p50 \(regression.baselineP50)µs -> \(regression.currentP50)µs (+\(percent)%)
+
+                """.utf8
+            )
+        )
+    }
+    if !regressions.isEmpty {
+        exit(1)
+    }
+    FileHandle.standardError.write(Data("No regressions against \(baselinePath).\n".utf8))
+}
@@ -48,6 +48,11 @@ import Shaft
         }
 
         /// The actual rendering logic that runs on the raster thread.
+        ///
+        /// Unlike ``SDLOpenGLView``, this view has no damage support. Each
+        /// drawable is a new texture whose content is undefined, and Metal
+        /// canvases don't paint into a retained back buffer, so every frame
+        /// is repainted and presented in full.
         override func performRender(_ layerTree: LayerTree) {
             autoreleasepool {
                 let drawable = metalLayer.nextDrawable()!
@@ -57,12 +62,22 @@ import Shaft
                 canvas.clear(color: .init(0x0000_0000))
 
                 // Record painting instructions to the canvas.
+                let bounds = Shaft.Rect(
+                    left: 0,
+                    top: 0,
+                    right: Float(texture.width),
+                    bottom: Float(texture.height)
+                )
                 layerTree.paint(
-                    context: LayerPaintContext(canvas: canvas)
+                    context: LayerPaintContext(
+                        canvas: canvas,
+                        rasterCache: canvas.rasterCache,
+                        cullRect: bounds
+                    )
                 )
 
                 // Submit painting commands
-                canvas.flush()
+                flush(canvas)
 
                 drawable.present()
             }
@@ -42,6 +42,15 @@ public class SDLOpenGLView: SDLView {
     /// surface being destroyed while it is being painted to.
     private func updateCanvas() {
         canvas = (backend!.renderer as! GLRenderer).createGLCanvas(fbo: 0, size: physicalSize)
+        damageTracker.reset()
+    }
+
+    /// Finds the area that changed since the previous frame, so that canvases
+    /// that preserve their content only repaint that area.
+    private let damageTracker = DamageTracker()
+
+    override func makeGPUContextCurrent() -> Bool {
+        sdlGLContext != nil && SDL_GL_MakeCurrent(sdlWindow, sdlGLContext)
     }
 
     /// The actual rendering logic that runs on the raster thread.
@@ -57,18 +66,51 @@ public class SDLOpenGLView: SDLView {
             updateCanvas()
         }
 
+        if canvas.preservesContents {
+            let damage = damageTracker.computeDamage(layerTree, size: physicalSize)
+            if damage.isEmpty {
+                // The window still shows the previous frame, so the copy of
+                // the back buffer and the swap are skipped as well.
+                return
+            }
+            canvas.save()
+            canvas.clipRect(damage, .intersect, false)
+            paint(layerTree, cullRect: damage)
+            canvas.restore()
+        } else {
+            paint(layerTree, cullRect: physicalBounds)
+        }
+
+        // Submit painting commands
+        flush(canvas)
+
+        // Present the rendered frame to the screen.
+        SDL_GL_SwapWindow(sdlWindow)
+    }
+
+    /// Clears the canvas and paints the layer tree. Only the area inside the
+    /// current clip of the canvas is affected. Layers completely outside of
+    /// `cullRect`, in physical pixels, are skipped.
+    private func paint(_ layerTree: LayerTree, cullRect: Shaft.Rect) {
         // Record painting instructions to the canvas.
-        // sk_canvas_clear(skCanvas, 0x0000_0000)
         canvas.clear(color: .init(0x0000_0000))
 
         layerTree.paint(
-            context: LayerPaintContext(canvas: canvas)
+            context: LayerPaintContext(
+                canvas: canvas,
+                rasterCache: canvas.rasterCache,
+                cullRect: cullRect
+            )
         )
+    }
 
-        // Submit painting commands
-        canvas.flush()
-
-        // Present the rendered frame to the screen.
-        SDL_GL_SwapWindow(sdlWindow)
+    /// The bounds of the window surface in physical pixels.
+    private var physicalBounds: Shaft.Rect {
+        Shaft.Rect(
+            left: 0,
+            top: 0,
+            right: Float(physicalSize.width),
+            bottom: Float(physicalSize.height)
+        )
     }
 }
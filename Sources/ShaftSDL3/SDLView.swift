@@ -45,9 +45,18 @@ public class SDLView: NativeView {
 
         self.backend = backend
         self.rasterThread = DispatchQueue(label: "raster-\(viewID)")
+        self.pipelineSlots = DispatchSemaphore(value: Self.pipelineDepth)
 
         // Center the window on the screen by default.
         centerWindow()
+
+        // The first view applies changes to the GPU resource cache while no
+        // frames are drawn.
+        if let renderer = backend.renderer as? GPUResourceCacheRenderer,
+            renderer.gpuContextExecutor == nil
+        {
+            renderer.gpuContextExecutor = self
+        }
     }
 
     deinit {
@@ -67,13 +76,109 @@ public class SDLView: NativeView {
     /// The thread dedicated to rasterizing this view.
     internal let rasterThread: DispatchQueue
 
+    /// The maximum number of frames that can be queued on or being rendered
+    /// by the raster thread when ``isPipelined`` is true. Read when a view is
+    /// created.
+    public static var pipelineDepth = 2
+
+    /// Whether ``render(_:)`` returns before the frame is rasterized, so that
+    /// the UI thread can build the next frame while the raster thread draws
+    /// the current one.
+    ///
+    /// The raster thread paints a snapshot of the layer tree, in which
+    /// paragraphs are replaced by their ``Paragraph/snapshot()`` so that the
+    /// UI thread can lay them out again in the meantime.
+    public var isPipelined = false
+
+    /// Counts the free slots of the pipeline. Rendering a frame takes a slot
+    /// and blocks until one is free, which keeps the UI thread from running
+    /// more than ``pipelineDepth`` frames ahead of the raster thread.
+    private let pipelineSlots: DispatchSemaphore
+
     public func render(_ layerTree: LayerTree) {
         if isDestroyed {
             return
         }
 
-        rasterThread.sync {
-            self.performRender(layerTree)
+        // Animated layers are ticked and painted again by the raster thread
+        // after this call returns, so they need their own copy.
+        let hasAnimations = layerTree.hasAnimations
+
+        if !isPipelined {
+            let tree = hasAnimations ? layerTree.snapshot() : layerTree
+            rasterThread.sync {
+                self.rasterize(tree, isAnimationFrame: false)
+            }
+            return
+        }
+
+        // Layers are reused and mutated by the next frame, so the raster
+        // thread needs its own copy.
+        let snapshot = layerTree.snapshot()
+
+        pipelineSlots.wait()
+        rasterThread.async {
+            defer { self.pipelineSlots.signal() }
+            if !self.isDestroyed {
+                self.rasterize(snapshot, isAnimationFrame: false)
+            }
+        }
+    }
+
+    /// The interval between frames the raster thread paints on its own while
+    /// the last submitted layer tree has running ``LayerAnimation``s.
+    public var animationFrameInterval: Duration = .microseconds(16_667)
+
+    /// The last submitted tree while it has running animations. Only accessed
+    /// on the raster thread.
+    private var animatingTree: LayerTree?
+
+    /// Incremented for every tree submitted by the UI thread, so that pending
+    /// animation frames of an older tree are dropped. Only accessed on the
+    /// raster thread.
+    private var treeGeneration = 0
+
+    /// Ticks the animations of `layerTree`, paints it, and schedules another
+    /// frame on the raster thread if any animation is still running. Runs on
+    /// the raster thread.
+    private func rasterize(_ layerTree: LayerTree, isAnimationFrame: Bool) {
+        if !isAnimationFrame {
+            treeGeneration += 1
+            animatingTree = nil
+        }
+
+        let isAnimating = layerTree.tickAnimations(at: .now)
+
+        lastFlush = nil
+        let start = ContinuousClock.now
+        Timeline.timeSync(isAnimationFrame ? "Rasterize (animation)" : "Rasterize") {
+            performRender(layerTree)
+        }
+        if !isAnimationFrame, let frameNumber = layerTree.frameNumber {
+            FrameTimingRecorder.shared.reportRaster(
+                frameNumber: frameNumber,
+                raster: FrameTimingSpan(start: start, end: .now),
+                gpuFlush: lastFlush
+            )
+        }
+
+        if isAnimating {
+            animatingTree = layerTree
+            scheduleAnimationFrame(generation: treeGeneration)
+        } else {
+            animatingTree = nil
+        }
+    }
+
+    private func scheduleAnimationFrame(generation: Int) {
+        let interval = Double(animationFrameInterval.inMicroseconds) / 1_000_000
+        rasterThread.asyncAfter(deadline: .now() + interval) { [weak self] in
+            guard let self, !self.isDestroyed, generation == self.treeGeneration,
+                let tree = self.animatingTree
+            else {
+                return
+            }
+            self.rasterize(tree, isAnimationFrame: true)
         }
     }
 
@@ -84,6 +189,16 @@ public class SDLView: NativeView {
             return
         }
         isDestroyed = true
+
+        if let renderer = backend?.renderer as? GPUResourceCacheRenderer,
+            renderer.gpuContextExecutor === self
+        {
+            renderer.gpuContextExecutor = nil
+        }
+
+        // Wait for frames still in the pipeline to finish with the window.
+        rasterThread.sync {}
+
         SDL_DestroyWindow(sdlWindow)
     }
 
@@ -92,6 +207,26 @@ public class SDLView: NativeView {
         shouldImplement()
     }
 
+    /// Makes the GPU context of this view current on the raster thread.
+    /// Returns false if it can't be used.
+    internal func makeGPUContextCurrent() -> Bool {
+        true
+    }
+
+    /// The time spent in the last ``flush(_:)``. Only accessed on the raster
+    /// thread.
+    private var lastFlush: FrameTimingSpan?
+
+    /// Submits the painting commands of `canvas` and records the time spent
+    /// for frame timings. Called by ``performRender(_:)``.
+    internal func flush(_ canvas: DirectCanvas) {
+        let start = ContinuousClock.now
+        Timeline.timeSync("GPU flush") {
+            canvas.flush()
+        }
+        lastFlush = FrameTimingSpan(start: start, end: .now)
+    }
+
     // A helper method to center the window on the screen.
     public func centerWindow() {
         let display = SDL_GetDisplayForWindow(sdlWindow)
@@ -431,3 +566,17 @@ private func sdlEventWatcher(
     }
 
 #endif
+
+extension SDLView: GPUContextExecutor {
+    public func runWithGPUContext(_ work: @escaping () -> Void) -> Bool {
+        if isDestroyed {
+            return false
+        }
+        rasterThread.async {
+            if !self.isDestroyed && self.makeGPUContextCurrent() {
+                work()
+            }
+        }
+        return true
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Shaft
+
+/// A ``SkiaCanvas`` that paints into an offscreen surface whose content is
+/// kept between frames, and copies it to the window surface on every flush.
+///
+/// Window surfaces usually don't keep their content after being presented,
+/// which forces every frame to be repainted in full. Painting into a retained
+/// back buffer lets the view repaint only the damaged area at the cost of a
+/// single copy per frame.
+public class SkiaBackBufferCanvas: SkiaCanvas {
+    /// Returns nil if no offscreen surface compatible with `windowSurface`
+    /// could be created.
+    init?(
+        _ windowSurface: SkSurface_sp,
+        _ grDirectContext: GrDirectContext_sp,
+        _ size: ISize,
+        pictureCache: SkiaPictureCache?,
+        rasterCache: SkiaRasterCache?,
+        framePacer: SkiaFramePacer?,
+        resourceCacheController: SkiaResourceCacheController?
+    ) {
+        let windowCanvas = sk_surface_get_canvas(windowSurface)!
+        let backBuffer = sk_canvas_make_surface(
+            windowCanvas,
+            Int32(size.width),
+            Int32(size.height)
+        )
+        if !backBuffer.__convertToBool() {
+            return nil
+        }
+
+        self.windowSurface = windowSurface
+        self.windowCanvas = windowCanvas
+        super.init(
+            backBuffer,
+            grDirectContext,
+            size,
+            pictureCache: pictureCache,
+            rasterCache: rasterCache,
+            framePacer: framePacer,
+            resourceCacheController: resourceCacheController
+        )
+    }
+
+    /// The surface that is presented to the window.
+    private let windowSurface: SkSurface_sp
+
+    private let windowCanvas: OpaquePointer
+
+    public override var preservesContents: Bool { true }
+
+    public override func flush() {
+        var backBuffer = skSurface
+        sk_surface_draw_replacing(&backBuffer, windowCanvas)
+        super.flush()
+    }
+}
@@ -11,11 +11,37 @@ public class SkiaCanvas: DirectCanvas {
     /// Creates a new canvas that draws to the given Skia canvas. It's the
     /// caller's responsibility to ensure that the canvas is valid during the
     /// lifetime of this object.
-    init(_ skSurface: SkSurface_sp, _ grDirectContext: GrDirectContext_sp, _ size: ISize) {
+    init(
+        _ skSurface: SkSurface_sp,
+        _ grDirectContext: GrDirectContext_sp,
+        _ size: ISize,
+        pictureCache: SkiaPictureCache? = nil,
+        rasterCache: SkiaRasterCache? = nil,
+        framePacer: SkiaFramePacer? = nil,
+        resourceCacheController: SkiaResourceCacheController? = nil
+    ) {
         self.skSurface = skSurface
         self.skCanvas = sk_surface_get_canvas(skSurface)!
         self.grDirectContext = grDirectContext
         self.size = size
+        self.pictureCache = pictureCache
+        self.rasterCache = rasterCache
+        self.framePacer = framePacer
+        self.resourceCacheController = resourceCacheController
+    }
+
+    /// Creates a canvas that draws to a Skia canvas that is not backed by a
+    /// surface, such as the canvas of a picture recorder. Display lists drawn
+    /// on this canvas are always replayed op by op.
+    init(recording skCanvas: OpaquePointer) {
+        self.skSurface = SkSurface_sp()
+        self.skCanvas = skCanvas
+        self.grDirectContext = GrDirectContext_sp()
+        self.size = .zero
+        self.pictureCache = nil
+        self.rasterCache = nil
+        self.framePacer = nil
+        self.resourceCacheController = nil
     }
 
     public let size: ISize
@@ -24,15 +50,62 @@ public class SkiaCanvas: DirectCanvas {
     internal let skCanvas: OpaquePointer
 
     /// The underlying Skia surface.
-    private let skSurface: SkSurface_sp
+    internal let skSurface: SkSurface_sp
 
     /// The GrDirectContext that backs the skCanvas. Used to flush the canvas.
     internal var grDirectContext: GrDirectContext_sp
 
+    /// Pictures of display lists that were drawn in previous frames. Shared
+    /// by all canvases created by the same renderer.
+    internal let pictureCache: SkiaPictureCache?
+
+    public let rasterCache: LayerRasterCache?
+
+    /// Submits the work of ``flush()`` to the GPU. The GPU is waited for on
+    /// every flush if nil.
+    internal let framePacer: SkiaFramePacer?
+
+    /// Changes to the resource cache of ``grDirectContext`` requested by the
+    /// renderer, applied on flush.
+    internal let resourceCacheController: SkiaResourceCacheController?
+
+    /// Surfaces presented to a window don't keep their content by default.
+    public var preservesContents: Bool { false }
+
     private var skPaint = SkPaint()
 
+    /// The paint currently held by ``skPaint``.
+    private var appliedPaint: Paint?
+
+    /// Makes ``skPaint`` match `paint`, skipping the setters of fields that
+    /// are unchanged since the previous draw.
+    private func apply(_ paint: Paint) {
+        if paint == appliedPaint {
+            return
+        }
+        paint.copyToSkia(paint: &skPaint, replacing: appliedPaint)
+        appliedPaint = paint
+    }
+
+    /// Batches the ops of display lists drawn on this canvas into native
+    /// replay calls.
+    private lazy var opStream = SkiaOpStream(canvas: self)
+
+    public func drawDisplayList(_ displayList: DisplayList) {
+        if let picture = pictureCache?.picture(for: displayList) {
+            sk_canvas_draw_picture(skCanvas, picture)
+            return
+        }
+        let clip = sk_canvas_get_local_clip_bounds(skCanvas)
+        displayList.dispatch(
+            to: opStream,
+            cullRect: Rect(left: clip.fLeft, top: clip.fTop, right: clip.fRight, bottom: clip.fBottom)
+        )
+        opStream.flush()
+    }
+
     public func drawLine(_ p0: Offset, _ p1: Offset, _ paint: Paint) {
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_line(skCanvas, p0.dx, p0.dy, p1.dx, p1.dy, self.skPaint)
     }
 
@@ -40,18 +113,22 @@ public class SkiaCanvas: DirectCanvas {
         var skRect = SkRect()
         skRect.setLTRB(rect.left, rect.top, rect.right, rect.bottom)
 
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_rect(skCanvas, skRect, self.skPaint)
     }
 
     public func drawParagraph(_ paragraph: Paragraph, _ offset: Offset) {
+        if let paragraph = paragraph as? SkiaCapturedParagraph {
+            paragraph.paint(self, offset)
+            return
+        }
         let paragraph = paragraph as! SkiaParagraph
         paragraph.paint(self, offset)
     }
 
     public func drawTextBlob(_ blob: any TextBlob, _ offset: Offset, _ paint: Paint) {
         let blob = blob as! SkiaTextBlob
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_text_blob(skCanvas, &blob.skTextBlob, offset.dx, offset.dy, self.skPaint)
     }
 
@@ -70,7 +147,7 @@ public class SkiaCanvas: DirectCanvas {
             skRrect.setRectRadii(skRect, ptr.baseAddress)
         }
 
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_rrect(skCanvas, skRrect, self.skPaint)
     }
 
@@ -103,24 +180,24 @@ public class SkiaCanvas: DirectCanvas {
             skInnerRrect.setRectRadii(skInner, ptr.baseAddress)
         }
 
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_drrect(skCanvas, skOuterRrect, skInnerRrect, self.skPaint)
     }
 
     public func drawCircle(_ center: Offset, _ radius: Float, _ paint: Paint) {
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_circle(skCanvas, center.dx, center.dy, radius, self.skPaint)
     }
 
     public func drawPath(_ path: Path, _ paint: Paint) {
         let path = path as! SkiaPath
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_path(skCanvas, path.skPath, self.skPaint)
     }
 
     public func drawImage(_ image: NativeImage, _ offset: Offset, _ paint: Paint) {
         let image = image as! SkiaImage
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_image(skCanvas, &image.skImage, offset.dx, offset.dy, &self.skPaint)
     }
 
@@ -135,7 +212,7 @@ public class SkiaCanvas: DirectCanvas {
         skSrc.setLTRB(src.left, src.top, src.right, src.bottom)
         var skDst = SkRect()
         skDst.setLTRB(dst.left, dst.top, dst.right, dst.bottom)
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_image_rect(skCanvas, &image.skImage, skSrc, skDst, &self.skPaint)
     }
 
@@ -155,7 +232,7 @@ public class SkiaCanvas: DirectCanvas {
         )
         var skDst = SkRect()
         skDst.setLTRB(dst.left, dst.top, dst.right, dst.bottom)
-        paint.copyToSkia(paint: &self.skPaint)
+        apply(paint)
         sk_canvas_draw_image_nine(skCanvas, &image.skImage, skCenter, skDst, &self.skPaint)
     }
 
@@ -230,7 +307,7 @@ public class SkiaCanvas: DirectCanvas {
         var skRect = SkRect()
         skRect.setLTRB(bounds.left, bounds.top, bounds.right, bounds.bottom)
         if let paint = paint {
-            paint.copyToSkia(paint: &self.skPaint)
+            apply(paint)
             sk_canvas_save_layer(skCanvas, &skRect, &self.skPaint)
         } else {
             sk_canvas_save_layer(skCanvas, &skRect, nil)
@@ -246,6 +323,12 @@ public class SkiaCanvas: DirectCanvas {
     }
 
     public func flush() {
-        gr_direct_context_flush_and_submit(&grDirectContext, GrSyncCpu.yes)
+        pictureCache?.endFrame()
+        resourceCacheController?.apply(&grDirectContext)
+        if let framePacer {
+            framePacer.submit(&grDirectContext)
+        } else {
+            gr_direct_context_flush_and_submit(&grDirectContext, GrSyncCpu.yes)
+        }
     }
 }
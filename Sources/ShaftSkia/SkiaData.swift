@@ -0,0 +1,76 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+
+/// Keeps the storage of a `Data` alive while Skia references its bytes.
+///
+/// `withUnsafeBytes` only promises that its pointer is valid inside the
+/// closure, but Skia keeps the pointer taken from ``data`` until it releases
+/// the owner. This is safe because `Data` too large to be stored inline keeps
+/// its bytes in a heap buffer that is only moved or freed when the `Data` is
+/// mutated or deallocated. ``data`` is a constant that nothing else can
+/// reach, so it is never mutated, and a copy that a caller mutates gets its
+/// own buffer first. The owner checks that the bytes haven't moved before
+/// it's released.
+private final class SkiaDataOwner {
+    let data: Data
+
+    /// The address of the bytes handed to Skia.
+    let bytes: UnsafeRawPointer?
+
+    init(_ data: Data) {
+        self.data = data
+        self.bytes = self.data.withUnsafeBytes { $0.baseAddress }
+    }
+
+    deinit {
+        assert(data.withUnsafeBytes { $0.baseAddress } == bytes)
+    }
+}
+
+extension SkData_sp {
+    /// Wraps the bytes of `data` without copying them. The storage of `data`
+    /// is kept alive until Skia releases it.
+    init(adopting data: Data) {
+        // Small values are stored inline in `Data` and have no address that
+        // outlives `withUnsafeBytes`, so they are copied.
+        if data.count < MemoryLayout<Data>.size {
+            let bytes = UnsafeMutableRawBufferPointer.allocate(
+                byteCount: data.count,
+                alignment: 1
+            )
+            bytes.copyBytes(from: data)
+            self = sk_data_new_with_proc(
+                bytes.baseAddress,
+                bytes.count,
+                { bytes, _ in bytes?.deallocate() },
+                nil
+            )
+            return
+        }
+
+        let owner = SkiaDataOwner(data)
+        self = sk_data_new_with_proc(
+            owner.bytes,
+            data.count,
+            { _, context in Unmanaged<SkiaDataOwner>.fromOpaque(context!).release() },
+            Unmanaged.passRetained(owner).toOpaque()
+        )
+    }
+
+    /// Maps the file at `url` into memory, or returns nil if it can't be
+    /// opened. Pages are read from the file as they are accessed.
+    init?(mappingFileAt url: URL) {
+        guard url.isFileURL else {
+            return nil
+        }
+        let data = url.withUnsafeFileSystemRepresentation { sk_data_new_from_file($0) }
+        guard data.__convertToBool() else {
+            return nil
+        }
+        self = data
+    }
+}
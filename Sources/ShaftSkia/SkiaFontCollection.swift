@@ -10,9 +10,16 @@ public class SkiaFontCollection: FontCollection {
     internal var collection = sk_fontcollection_new()
 
     public func makeTypefaceFrom(_ data: Data) -> any Typeface {
-        let typeface = data.withUnsafeBytes { (ptr: UnsafeRawBufferPointer) in
-            let data = ptr.bindMemory(to: UInt8.self)
-            return sk_typeface_create_from_data(collection, data.baseAddress, data.count)
+        SkiaTypeface(sk_typeface_create_from_data(collection, SkData_sp(adopting: data)))
+    }
+
+    public func makeTypefaceFrom(contentsOf url: URL) -> (any Typeface)? {
+        guard let data = SkData_sp(mappingFileAt: url) else {
+            return nil
+        }
+        let typeface = sk_typeface_create_from_data(collection, data)
+        if typeface.__convertToBool() == false {
+            return nil
         }
         return SkiaTypeface(typeface)
     }
@@ -121,5 +128,9 @@ public class SkiaTextBlob: TextBlob {
         )
     }
 
+    init(skTextBlob: SkTextBlob_sp) {
+        self.skTextBlob = skTextBlob
+    }
+
     var skTextBlob: SkTextBlob_sp
 }
@@ -0,0 +1,144 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+import Shaft
+
+/// How ``SkiaCanvas/flush()`` hands painting commands to the GPU.
+public enum SkiaSubmitMode {
+    /// Waits for the GPU to finish every frame before returning. CPU and GPU
+    /// work of consecutive frames never overlap.
+    case synchronous
+
+    /// Returns as soon as the frame is submitted. The next flush only waits
+    /// when `maxFramesInFlight` frames are still being processed by the GPU.
+    case asynchronous(maxFramesInFlight: Int)
+}
+
+/// Bounds the number of frames the GPU is working on and measures how long
+/// the GPU takes to complete each of them.
+///
+/// Completion is detected with the finished callbacks of the GPU context,
+/// which Skia implements with fences.
+///
+/// ``SkiaMetalRenderer`` always uses ``SkiaSubmitMode/synchronous``, since
+/// its views present with a transaction right after flushing.
+public final class SkiaFramePacer {
+    public init(mode: SkiaSubmitMode) {
+        self.mode = mode
+    }
+
+    public var mode: SkiaSubmitMode
+
+    /// Called with the time between submitting a frame and the GPU completing
+    /// it. This includes time the frame spent queued behind earlier work.
+    /// Called on the thread that flushes the canvas.
+    public var onFrameCompleted: ((Duration) -> Void)?
+
+    /// The GPU time of the most recently completed frame.
+    public private(set) var lastFrameGPUTime: Duration?
+
+    /// The number of submitted frames the GPU has not completed yet.
+    public var framesInFlight: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return submitted.count
+    }
+
+    private let clock = ContinuousClock()
+
+    /// Submit times of the frames in flight, keyed by frame number.
+    private var submitted: [Int: ContinuousClock.Instant] = [:]
+
+    private var nextFrame = 0
+
+    private let lock = NSLock()
+
+    /// How long a wait for a frame sleeps before the context is asked again
+    /// whether it has completed.
+    private static let completionCheckInterval: TimeInterval = 0.0005
+
+    /// Flushes and submits the work recorded in `context` according to
+    /// ``mode``.
+    func submit(_ context: inout GrDirectContext_sp) {
+        guard case .asynchronous(let maxFramesInFlight) = mode else {
+            let start = clock.now
+            gr_direct_context_flush_and_submit(&context, GrSyncCpu.yes)
+            complete(gpuTime: clock.now - start)
+            return
+        }
+
+        waitForFramesInFlight(below: max(maxFramesInFlight, 1)) {
+            gr_direct_context_check_async_work_completion(&context)
+        }
+
+        let frame = recordSubmission()
+        let token = Unmanaged.passRetained(FinishedToken(pacer: self, frame: frame))
+        gr_direct_context_flush_and_submit_async(
+            &context,
+            { token in
+                let token = Unmanaged<FinishedToken>.fromOpaque(token!).takeRetainedValue()
+                token.pacer.finish(token.frame)
+            },
+            token.toOpaque()
+        )
+    }
+
+    /// Records that a frame is submitted and returns its number.
+    func recordSubmission() -> Int {
+        lock.lock()
+        defer { lock.unlock() }
+        let frame = nextFrame
+        nextFrame += 1
+        submitted[frame] = clock.now
+        return frame
+    }
+
+    /// Polls until fewer than `limit` frames are in flight.
+    ///
+    /// Skia only runs finished callbacks when the context checks its fences,
+    /// on the thread that uses the context, so nothing can wake this thread
+    /// when the GPU completes a frame. `checkCompletion` has the context
+    /// check its fences, which calls ``finish(_:)`` for completed frames, and
+    /// the thread sleeps for ``completionCheckInterval`` between checks.
+    func waitForFramesInFlight(below limit: Int, checkCompletion: () -> Void) {
+        while true {
+            checkCompletion()
+            if framesInFlight < limit {
+                return
+            }
+            Thread.sleep(forTimeInterval: Self.completionCheckInterval)
+        }
+    }
+
+    /// Records that the GPU completed `frame`.
+    func finish(_ frame: Int) {
+        lock.lock()
+        let start = submitted.removeValue(forKey: frame)
+        lock.unlock()
+
+        if let start {
+            complete(gpuTime: clock.now - start)
+        }
+    }
+
+    private func complete(gpuTime: Duration) {
+        lastFrameGPUTime = gpuTime
+        onFrameCompleted?(gpuTime)
+    }
+}
+
+/// Passed through the finished callback of the GPU context, which can't
+/// capture Swift values.
+private final class FinishedToken {
+    init(pacer: SkiaFramePacer, frame: Int) {
+        self.pacer = pacer
+        self.frame = frame
+    }
+
+    let pacer: SkiaFramePacer
+
+    let frame: Int
+}
@@ -24,25 +24,76 @@ public class SkiaImage: NativeImage {
 
 /// A skia-based implementation of [AnimatedImage].
 public class SkiaAnimatedImage: AnimatedImage {
-    public static func decode(_ data: Data) -> AnimatedImage? {
-        // use sk_animated_image_decode(data, 1)
-        let skAnimatedImage = data.withUnsafeBytes { (ptr: UnsafeRawBufferPointer) in
-            sk_animated_image_create(ptr.baseAddress, ptr.count)
+    /// Decodes `data`, sampled down towards `targetSize` in pixels if it's
+    /// given. See ``Renderer/decodeImageFromData(_:targetSize:)``. The bytes
+    /// of `data` are used in place rather than copied.
+    ///
+    /// If `yuvaPlanes` is true, still images that the codec can decode into
+    /// YUVA planes, such as most JPEGs, are kept as planes that only GPU
+    /// canvases can draw without decoding them again.
+    public static func decode(
+        _ data: Data,
+        targetSize: ISize? = nil,
+        yuvaPlanes: Bool = false
+    ) -> AnimatedImage? {
+        decode(SkData_sp(adopting: data), targetSize: targetSize, yuvaPlanes: yuvaPlanes)
+    }
+
+    /// Decodes the image file at `url`, which is mapped into memory rather
+    /// than read.
+    public static func decode(
+        contentsOf url: URL,
+        targetSize: ISize? = nil,
+        yuvaPlanes: Bool = false
+    ) -> AnimatedImage? {
+        guard let data = SkData_sp(mappingFileAt: url) else {
+            return nil
         }
+        return decode(data, targetSize: targetSize, yuvaPlanes: yuvaPlanes)
+    }
+
+    private static func decode(
+        _ data: SkData_sp,
+        targetSize: ISize?,
+        yuvaPlanes: Bool
+    ) -> AnimatedImage? {
+        let targetWidth = Int32(clamping: targetSize?.width ?? 0)
+        let targetHeight = Int32(clamping: targetSize?.height ?? 0)
+
+        if yuvaPlanes {
+            var byteCount = 0
+            let skImage = sk_image_decode_yuva(data, targetWidth, targetHeight, &byteCount)
+            if skImage.__convertToBool() {
+                return SkiaStillImage(SkiaImage(skImage: skImage), byteCount: byteCount)
+            }
+        }
+
+        let skAnimatedImage = sk_animated_image_create(data, targetWidth, targetHeight)
 
         if skAnimatedImage.__convertToBool() == false {
             return nil
         }
 
-        return SkiaAnimatedImage(skAnimatedImage: skAnimatedImage)
+        return SkiaAnimatedImage(
+            skAnimatedImage: skAnimatedImage,
+            encodedByteCount: sk_data_get_size(data)
+        )
     }
 
-    private init(skAnimatedImage: SkAnimatedImage_sp) {
+    private init(skAnimatedImage: SkAnimatedImage_sp, encodedByteCount: Int) {
         self.skAnimatedImage = skAnimatedImage
+        self.encodedByteCount = encodedByteCount
     }
 
     private var skAnimatedImage: SkAnimatedImage_sp
 
+    /// The size of the encoded data, which the codec keeps to decode frames.
+    private let encodedByteCount: Int
+
+    public var byteCount: Int {
+        sk_animated_image_get_byte_size(&skAnimatedImage) + encodedByteCount
+    }
+
     public var frameCount: UInt {
         UInt(sk_animated_image_get_frame_count(&skAnimatedImage))
     }
@@ -64,3 +115,23 @@ public class SkiaAnimatedImage: AnimatedImage {
         )
     }
 }
+
+/// An image with a single frame that was decoded up front.
+final class SkiaStillImage: AnimatedImage {
+    init(_ image: SkiaImage, byteCount: Int) {
+        self.image = image
+        self.byteCount = byteCount
+    }
+
+    let image: SkiaImage
+
+    let byteCount: Int
+
+    var frameCount: UInt { 1 }
+
+    var repetitionCount: UInt? { 0 }
+
+    func getNextFrame() -> FrameInfo? {
+        FrameInfo(duration: nil, image: image)
+    }
+}
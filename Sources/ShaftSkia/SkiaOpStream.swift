@@ -0,0 +1,278 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Shaft
+import SwiftMath
+
+/// Batches display list operations into an op stream that is replayed onto a
+/// ``SkiaCanvas`` with a single ``sk_canvas_replay`` call, instead of making
+/// one bridge call and one full paint setup per op.
+///
+/// Ops that reference Swift-side objects (paragraphs, text blobs, paths and
+/// images) can't be encoded into the stream. When one is encountered the
+/// pending stream is replayed first and the op is then drawn directly on the
+/// canvas, so the drawing order is preserved.
+internal class SkiaOpStream: DlOpReceiver {
+    init(canvas: SkiaCanvas) {
+        self.canvas = canvas
+    }
+
+    unowned let canvas: SkiaCanvas
+
+    /// The encoded ops that have not been replayed yet.
+    private var words: [UInt32] = []
+
+    /// The paint most recently set in ``words``. Nil when the stream is empty
+    /// since the native side starts every replay with a default paint.
+    private var currentPaint: Paint?
+
+    /// Replays all pending ops onto the canvas.
+    func flush() {
+        if words.isEmpty {
+            return
+        }
+        words.withUnsafeBufferPointer { buffer in
+            sk_canvas_replay(canvas.skCanvas, buffer.baseAddress, buffer.count)
+        }
+        words.removeAll(keepingCapacity: true)
+        currentPaint = nil
+    }
+
+    // MARK: - Encoding
+
+    private func push(_ op: SkReplayOp) {
+        words.append(op.rawValue)
+    }
+
+    private func write(_ value: Float) {
+        words.append(value.bitPattern)
+    }
+
+    private func write(_ value: Bool) {
+        words.append(value ? 1 : 0)
+    }
+
+    private func write(_ rect: Shaft.Rect) {
+        write(rect.left)
+        write(rect.top)
+        write(rect.right)
+        write(rect.bottom)
+    }
+
+    private func write(_ rrect: RRect) {
+        write(rrect.outerRect)
+        write(rrect.tlRadiusX)
+        write(rrect.tlRadiusY)
+        write(rrect.trRadiusX)
+        write(rrect.trRadiusY)
+        write(rrect.brRadiusX)
+        write(rrect.brRadiusY)
+        write(rrect.blRadiusX)
+        write(rrect.blRadiusY)
+    }
+
+    private func write(_ clipOp: ClipOp) {
+        words.append(UInt32(clipOp.toSkia().rawValue))
+    }
+
+    /// Makes `paint` the current paint of the stream, encoding it only if it
+    /// differs from the paint of the previous op.
+    private func use(_ paint: Paint) {
+        if paint == currentPaint {
+            return
+        }
+        currentPaint = paint
+
+        push(.setPaint)
+        write(paint.isAntiAlias)
+        words.append(paint.color.value)
+        words.append(UInt32(paint.blendMode.toSkia().rawValue))
+        words.append(paint.style == .fill ? 0 : 1)
+        write(paint.strokeWidth)
+        words.append(paint.strokeCap.replayValue)
+        words.append(paint.strokeJoin.replayValue)
+        write(paint.strokeMiterLimit)
+        if let maskFilter = paint.maskFilter {
+            words.append(maskFilter.style.replayValue)
+            write(maskFilter.sigma)
+        } else {
+            words.append(UInt32.max)  // kNoBlur
+            write(Float(0))
+        }
+        let (colorFilterKind, colorFilterValues) = paint.colorFilter.replayValue
+        words.append(colorFilterKind.rawValue)
+        words.append(contentsOf: colorFilterValues)
+    }
+
+    // MARK: - DlOpReceiver
+
+    func drawDisplayList(_ displayList: DisplayList) {
+        displayList.dispatch(to: self)
+    }
+
+    func save() {
+        push(.save)
+    }
+
+    func saveLayer(_ bounds: Shaft.Rect, paint: Paint?) {
+        if let paint {
+            use(paint)
+        }
+        push(.saveLayer)
+        write(bounds)
+        write(paint != nil)
+    }
+
+    func restore() {
+        push(.restore)
+    }
+
+    func translate(_ dx: Float, _ dy: Float) {
+        push(.translate)
+        write(dx)
+        write(dy)
+    }
+
+    func scale(_ sx: Float, _ sy: Float) {
+        push(.scale)
+        write(sx)
+        write(sy)
+    }
+
+    func rotate(_ radians: Float) {
+        push(.rotate)
+        write(radians * 180.0 / .pi)
+    }
+
+    func transform(_ transform: Matrix4x4f) {
+        push(.concat)
+        // Row-major, see SkiaCanvas.transform.
+        for row in 0..<4 {
+            for column in 0..<4 {
+                write(transform[column, row])
+            }
+        }
+    }
+
+    func clipRect(_ rect: Shaft.Rect, _ clipOp: ClipOp, _ doAntiAlias: Bool) {
+        push(.clipRect)
+        write(rect)
+        write(clipOp)
+        write(doAntiAlias)
+    }
+
+    func clipRRect(_ rrect: RRect, _ doAntiAlias: Bool) {
+        push(.clipRRect)
+        write(rrect)
+        write(ClipOp.intersect)
+        write(doAntiAlias)
+    }
+
+    func drawLine(_ p0: Offset, _ p1: Offset, _ paint: Paint) {
+        use(paint)
+        push(.drawLine)
+        write(p0.dx)
+        write(p0.dy)
+        write(p1.dx)
+        write(p1.dy)
+    }
+
+    func drawRect(_ rect: Shaft.Rect, _ paint: Paint) {
+        use(paint)
+        push(.drawRect)
+        write(rect)
+    }
+
+    func drawRRect(_ rrect: RRect, _ paint: Paint) {
+        use(paint)
+        push(.drawRRect)
+        write(rrect)
+    }
+
+    func drawDRRect(_ outer: RRect, _ inner: RRect, _ paint: Paint) {
+        use(paint)
+        push(.drawDRRect)
+        write(outer)
+        write(inner)
+    }
+
+    func drawCircle(_ center: Offset, _ radius: Float, _ paint: Paint) {
+        use(paint)
+        push(.drawCircle)
+        write(center.dx)
+        write(center.dy)
+        write(radius)
+    }
+
+    func clear(color: Color) {
+        push(.clear)
+        words.append(color.value)
+    }
+
+    func drawPath(_ path: Path, _ paint: Paint) {
+        flush()
+        canvas.drawPath(path, paint)
+    }
+
+    func drawImage(_ image: NativeImage, _ offset: Offset, _ paint: Paint) {
+        flush()
+        canvas.drawImage(image, offset, paint)
+    }
+
+    func drawImageRect(_ image: NativeImage, _ src: Shaft.Rect, _ dst: Shaft.Rect, _ paint: Paint) {
+        flush()
+        canvas.drawImageRect(image, src, dst, paint)
+    }
+
+    func drawImageNine(_ image: NativeImage, _ center: Shaft.Rect, _ dst: Shaft.Rect, _ paint: Paint)
+    {
+        flush()
+        canvas.drawImageNine(image, center, dst, paint)
+    }
+
+    func drawParagraph(_ paragraph: Paragraph, _ offset: Offset) {
+        flush()
+        canvas.drawParagraph(paragraph, offset)
+    }
+
+    func drawTextBlob(_ blob: TextBlob, _ offset: Offset, _ paint: Paint) {
+        flush()
+        canvas.drawTextBlob(blob, offset, paint)
+    }
+}
+
+extension StrokeCap {
+    /// The SkPaint::Cap value used in replay op streams.
+    fileprivate var replayValue: UInt32 {
+        switch self {
+        case .butt: 0
+        case .round: 1
+        case .square: 2
+        }
+    }
+}
+
+extension StrokeJoin {
+    /// The SkPaint::Join value used in replay op streams.
+    fileprivate var replayValue: UInt32 {
+        switch self {
+        case .miter: 0
+        case .round: 1
+        case .bevel: 2
+        }
+    }
+}
+
+extension BlurStyle {
+    /// The SkBlurStyle value used in replay op streams.
+    fileprivate var replayValue: UInt32 {
+        switch self {
+        case .normal: 0
+        case .solid: 1
+        case .outer: 2
+        case .inner: 3
+        }
+    }
+}
@@ -67,12 +67,26 @@ public class SkiaParagraph: Paragraph {
     public var didExceedMaxLines: Bool { paragraph.pointee.didExceedMaxLines() }
 
     public func layout(_ constraints: ParagraphConstraints) {
+        lastSnapshot = nil
         switch constraints {
         case .width(let width):
             paragraph_layout(paragraph, width)
         }
     }
 
+    /// The snapshot of the current layout. Recorded on first use, since most
+    /// paragraphs are painted in many frames without being laid out again.
+    private var lastSnapshot: SkiaCapturedParagraph?
+
+    public func snapshot() -> Paragraph {
+        if let lastSnapshot {
+            return lastSnapshot
+        }
+        let snapshot = SkiaCapturedParagraph(recording: self)
+        lastSnapshot = snapshot
+        return snapshot
+    }
+
     public func paint(_ canvas: SkiaCanvas, _ offset: Offset) {
         let canvas = canvas
         paragraph_paint(paragraph, canvas.skCanvas, offset.dx, offset.dy)
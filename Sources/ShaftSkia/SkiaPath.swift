@@ -15,4 +15,9 @@ public class SkiaPath: Path {
     public func reset() {
         sk_path_reset(&skPath)
     }
+
+    public func getBounds() -> Rect {
+        let bounds = sk_path_get_bounds(skPath)
+        return Rect(left: bounds.fLeft, top: bounds.fTop, right: bounds.fRight, bottom: bounds.fBottom)
+    }
 }
@@ -0,0 +1,146 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+import Shaft
+
+/// Retains ``DisplayList``s recorded into `SkPicture`s across frames so that
+/// layers that were not repainted are drawn with a single `drawPicture` call
+/// instead of replaying every op again.
+///
+/// A display list is recorded the second frame in a row it's drawn. Layers
+/// that are repainted every frame, such as animations, never pay for
+/// recording a picture they would only use once.
+///
+/// Entries are keyed by ``DisplayList/uniqueID``. Once a layer is repainted
+/// its old display list is no longer drawn, and the picture is evicted after
+/// ``maxIdleFrames`` frames.
+public final class SkiaPictureCache {
+    /// The number of frames an entry is kept without being drawn. Frames of
+    /// all canvases created by the same renderer are counted, so this is more
+    /// than one to let windows that share the cache keep their pictures.
+    public var maxIdleFrames = 3
+
+    private struct Entry {
+        /// Nil until the display list is drawn in a second frame.
+        var picture: SkPicture_sp?
+
+        var lastUsedFrame: Int
+
+        let firstUsedFrame: Int
+    }
+
+    private var entries: [UInt64: Entry] = [:]
+
+    private var frame = 0
+
+    /// Canvases of different windows draw on their own raster threads.
+    private let lock = NSLock()
+
+    /// The number of pictures currently retained.
+    public var pictureCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return entries.values.filter { $0.picture != nil }.count
+    }
+
+    /// The approximate memory used by the retained pictures.
+    public var byteCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return entries.values.reduce(0) { sum, entry in
+            guard let picture = entry.picture else { return sum }
+            return sum + sk_picture_approximate_bytes_used(picture)
+        }
+    }
+
+    /// Returns the picture of `displayList`, recording it if the display list
+    /// was also drawn in a previous frame. Returns nil if the display list
+    /// should be replayed directly.
+    func picture(for displayList: DisplayList) -> SkPicture_sp? {
+        let id = displayList.uniqueID
+
+        if let picture = markUsed(id) {
+            return picture
+        }
+        if !shouldRecord(id) {
+            return nil
+        }
+
+        // Record outside of the lock so that other windows are not blocked.
+        let picture = record(displayList)
+
+        lock.lock()
+        defer { lock.unlock() }
+        entries[id]?.picture = picture
+        return picture
+    }
+
+    /// Marks the entry of `id` as used in the current frame and returns its
+    /// picture if one was recorded.
+    private func markUsed(_ id: UInt64) -> SkPicture_sp? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard var entry = entries[id] else {
+            entries[id] = Entry(picture: nil, lastUsedFrame: frame, firstUsedFrame: frame)
+            return nil
+        }
+        entry.lastUsedFrame = frame
+        entries[id] = entry
+        return entry.picture
+    }
+
+    /// Whether the display list of `id` has been drawn in an earlier frame
+    /// than the current one.
+    private func shouldRecord(_ id: UInt64) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let entry = entries[id] else {
+            return false
+        }
+        return entry.firstUsedFrame < frame
+    }
+
+    /// Marks the end of a frame and evicts entries that have not been drawn
+    /// recently.
+    func endFrame() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        frame += 1
+        entries = entries.filter { frame - $0.value.lastUsedFrame <= maxIdleFrames }
+    }
+
+    /// Drops all retained pictures.
+    public func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        entries.removeAll()
+    }
+
+    /// The cull rect of pictures of display lists whose ``DisplayList/bounds``
+    /// are unknown. It never culls.
+    private static let unboundedRecordingBounds = SkRect.MakeLTRB(-1e9, -1e9, 1e9, 1e9)
+
+    private func record(_ displayList: DisplayList) -> SkPicture_sp {
+        let recorder = sk_picture_recorder_new()!
+        defer { sk_picture_recorder_delete(recorder) }
+
+        // The cull rect lets Skia reject the picture as a whole when it's
+        // outside of the clip.
+        var skBounds = Self.unboundedRecordingBounds
+        if let bounds = displayList.bounds {
+            skBounds.setLTRB(bounds.left, bounds.top, bounds.right, bounds.bottom)
+        }
+        let skCanvas = sk_picture_recorder_begin(recorder, skBounds)!
+        let canvas = SkiaCanvas(recording: skCanvas)
+        canvas.drawDisplayList(displayList)
+
+        return sk_picture_recorder_finish(recorder)
+    }
+}
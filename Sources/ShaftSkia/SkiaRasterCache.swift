@@ -0,0 +1,334 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+import Shaft
+
+/// A ``LayerRasterCache`` that snapshots layers into offscreen `SkImage`s
+/// created in the same context as the canvas being drawn.
+///
+/// Content qualifies for a snapshot once it has been drawn unchanged for
+/// ``stableFrameThreshold`` consecutive frames. Snapshots are rasterized at
+/// the scale, rotation and skew of the canvas at that time and drawn at
+/// whatever translation the canvas has later, so layers that are scrolled or
+/// moved by an offset keep hitting the cache. A change of any other part of
+/// the transform is a miss.
+public final class SkiaRasterCache: LayerRasterCache {
+    /// The number of consecutive frames content must be drawn unchanged
+    /// before it's snapshotted.
+    public var stableFrameThreshold = 3
+
+    /// The maximum memory used by snapshots. When a new snapshot does not
+    /// fit, the least recently drawn snapshots are evicted first.
+    public var byteBudget = 64 * 1024 * 1024
+
+    /// The number of frames an entry is kept without being drawn. See
+    /// ``SkiaPictureCache/maxIdleFrames``.
+    public var maxIdleFrames = 3
+
+    /// The number of draws served from a snapshot.
+    public var hitCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return counters.hits
+    }
+
+    /// The number of draws of cacheable content that had no snapshot.
+    public var missCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return counters.misses
+    }
+
+    /// The number of snapshots dropped, either because they were not drawn
+    /// recently or to stay within ``byteBudget``.
+    public var evictionCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return counters.evictions
+    }
+
+    /// The memory currently used by snapshots.
+    public var byteCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return counters.bytes
+    }
+
+    /// Resets the hit, miss and eviction counters to zero.
+    public func resetCounters() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        counters = Counters(bytes: counters.bytes)
+    }
+
+    /// Drops all snapshots.
+    public func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        counters.evictions += entries.values.filter { $0.image != nil }.count
+        entries.removeAll()
+        counters.bytes = 0
+    }
+
+    private struct Key: Hashable {
+        var content: Int
+
+        // The matrix of the canvas without its translation.
+        var scaleX: Float
+        var skewX: Float
+        var skewY: Float
+        var scaleY: Float
+    }
+
+    private struct Entry {
+        /// The layer whose content the snapshot shows. Content keys are
+        /// hashes, so a hit on an entry of another layer is a collision.
+        var layerID: Int
+
+        var image: SkImage_sp?
+
+        /// The position of the snapshot relative to the translation of the
+        /// canvas it was created for.
+        var origin = Offset.zero
+
+        var byteCount = 0
+
+        var stableFrames = 1
+
+        var lastUsedFrame: Int
+    }
+
+    private var entries: [Key: Entry] = [:]
+
+    private struct Counters {
+        var hits = 0
+        var misses = 0
+        var evictions = 0
+        var bytes = 0
+    }
+
+    /// Read and written only while holding ``lock``.
+    private var counters = Counters()
+
+    /// The latest frame passed to ``beginFrame(_:)``.
+    private var frame = 0
+
+    /// Canvases of different windows draw on their own raster threads.
+    private let lock = NSLock()
+
+    public func draw(
+        key: Int,
+        layerID: Int,
+        bounds: Shaft.Rect,
+        canvas: Canvas,
+        paint: (LayerPaintContext) -> Void
+    ) -> Bool {
+        guard let canvas = canvas as? SkiaCanvas, !bounds.isEmpty, bounds.isFinite else {
+            return false
+        }
+
+        let matrix = sk_canvas_get_total_matrix(canvas.skCanvas)
+        if matrix.hasPerspective() {
+            return false
+        }
+
+        let cacheKey = Key(
+            content: key,
+            scaleX: matrix.getScaleX(),
+            skewX: matrix.getSkewX(),
+            skewY: matrix.getSkewY(),
+            scaleY: matrix.getScaleY()
+        )
+        let translation = Offset(matrix.getTranslateX(), matrix.getTranslateY())
+
+        guard var snapshot = lookup(cacheKey, layerID: layerID) else {
+            return false
+        }
+
+        // The snapshot is painted without holding the lock so that the raster
+        // threads of other windows are not blocked while it's rasterized.
+        if snapshot.image == nil {
+            if !rasterize(&snapshot, bounds, canvas, matrix, paint) {
+                return false
+            }
+            store(snapshot, for: cacheKey)
+        }
+
+        // Snap to whole pixels so that the snapshot is not resampled.
+        let position = translation + snapshot.origin
+        sk_canvas_draw_image_untransformed(
+            canvas.skCanvas,
+            &snapshot.image!,
+            position.dx.rounded(),
+            position.dy.rounded()
+        )
+        return true
+    }
+
+    /// Records a draw of the content identified by `key` of the layer
+    /// `layerID`. Returns the entry to draw, or an entry without an image if
+    /// the content has become stable enough to be snapshotted now. Returns
+    /// nil if the content must be painted directly.
+    private func lookup(_ key: Key, layerID: Int) -> Entry? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        var entry = entries[key] ?? Entry(layerID: layerID, lastUsedFrame: frame)
+        if entry.layerID != layerID {
+            counters.misses += 1
+            return nil
+        }
+        if entry.lastUsedFrame == frame - 1 {
+            entry.stableFrames += 1
+        } else if entry.lastUsedFrame < frame - 1 {
+            entry.stableFrames = 1
+        }
+        entry.lastUsedFrame = frame
+        entries[key] = entry
+
+        if entry.image != nil {
+            counters.hits += 1
+            return entry
+        }
+        counters.misses += 1
+        return entry.stableFrames < stableFrameThreshold ? nil : entry
+    }
+
+    /// Adds the image of `snapshot` to the cache, unless another thread has
+    /// stored one for the same key in the meantime.
+    private func store(_ snapshot: Entry, for key: Key) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if let entry = entries[key], entry.image != nil || entry.layerID != snapshot.layerID {
+            return
+        }
+        var entry = entries[key] ?? snapshot
+        evict(toFit: snapshot.byteCount)
+        entry.image = snapshot.image
+        entry.origin = snapshot.origin
+        entry.byteCount = snapshot.byteCount
+        entries[key] = entry
+        counters.bytes += entry.byteCount
+    }
+
+    /// Rasterizes the content into a new snapshot stored in `entry`. Returns
+    /// false if the content does not fit into the budget or no surface could
+    /// be created.
+    private func rasterize(
+        _ entry: inout Entry,
+        _ bounds: Shaft.Rect,
+        _ canvas: SkiaCanvas,
+        _ matrix: SkMatrix,
+        _ paint: (LayerPaintContext) -> Void
+    ) -> Bool {
+        let deviceBounds = mapRect(matrix, bounds)
+        let left = deviceBounds.left.rounded(.down)
+        let top = deviceBounds.top.rounded(.down)
+        let width = Int((deviceBounds.right - left).rounded(.up))
+        let height = Int((deviceBounds.bottom - top).rounded(.up))
+
+        // Assume 4 bytes per pixel until the image is created.
+        let estimatedBytes = width * height * 4
+        if width <= 0 || height <= 0 || estimatedBytes > byteBudget {
+            return false
+        }
+
+        var surface = sk_canvas_make_surface(canvas.skCanvas, Int32(width), Int32(height))
+        if !surface.__convertToBool() {
+            return false
+        }
+
+        let offscreen = SkiaCanvas(
+            surface,
+            canvas.grDirectContext,
+            ISize(width, height),
+            pictureCache: canvas.pictureCache
+        )
+        offscreen.clear(color: Color(0x0000_0000))
+        offscreen.translate(-left, -top)
+        sk_canvas_concat_matrix(offscreen.skCanvas, matrix)
+        paint(LayerPaintContext(canvas: offscreen))
+
+        var image = sk_surface_make_image_snapshot(&surface)
+        if !image.__convertToBool() {
+            return false
+        }
+
+        entry.image = image
+        entry.origin = Offset(left - matrix.getTranslateX(), top - matrix.getTranslateY())
+        entry.byteCount = sk_image_get_byte_size(&image)
+        return true
+    }
+
+    /// Evicts the least recently drawn snapshots until `bytes` more fit into
+    /// the budget.
+    private func evict(toFit bytes: Int) {
+        if counters.bytes + bytes <= byteBudget {
+            return
+        }
+        let candidates = entries.filter { $0.value.image != nil }
+            .sorted { $0.value.lastUsedFrame < $1.value.lastUsedFrame }
+        for (key, entry) in candidates {
+            if counters.bytes + bytes <= byteBudget {
+                break
+            }
+            entries[key]!.image = nil
+            counters.bytes -= entry.byteCount
+            counters.evictions += 1
+        }
+    }
+
+    public func beginFrame(_ uiFrame: Int?) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if let uiFrame {
+            // Trees of the same UI frame painted to other windows, or painted
+            // late by a lagging raster thread, don't advance the cache.
+            if uiFrame <= frame {
+                return
+            }
+            frame = uiFrame
+        } else {
+            frame += 1
+        }
+        entries = entries.filter { (_, entry) in
+            if frame - entry.lastUsedFrame <= maxIdleFrames {
+                return true
+            }
+            if entry.image != nil {
+                counters.bytes -= entry.byteCount
+                counters.evictions += 1
+            }
+            return false
+        }
+    }
+
+    /// Returns the bounds of `rect` after applying the affine `matrix`.
+    private func mapRect(_ matrix: SkMatrix, _ rect: Shaft.Rect) -> Shaft.Rect {
+        func map(_ x: Float, _ y: Float) -> Offset {
+            Offset(
+                matrix.getScaleX() * x + matrix.getSkewX() * y + matrix.getTranslateX(),
+                matrix.getSkewY() * x + matrix.getScaleY() * y + matrix.getTranslateY()
+            )
+        }
+        let points = [
+            map(rect.left, rect.top),
+            map(rect.right, rect.top),
+            map(rect.left, rect.bottom),
+            map(rect.right, rect.bottom),
+        ]
+        return Shaft.Rect(
+            left: points.map(\.dx).min()!,
+            top: points.map(\.dy).min()!,
+            right: points.map(\.dx).max()!,
+            bottom: points.map(\.dy).max()!
+        )
+    }
+}
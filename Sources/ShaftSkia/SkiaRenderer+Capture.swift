@@ -0,0 +1,242 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+import Shaft
+
+/// Encodes resources of frame captures with Skia's serialization.
+///
+/// Paragraphs can't be laid out again without the original fonts and text
+/// styles, so they are stored as a picture of their glyphs together with
+/// their metrics, and decoded as ``SkiaCapturedParagraph``.
+extension SkiaRenderer: CaptureResourceCodec {
+    public func encodeParagraph(_ paragraph: Paragraph) -> Data? {
+        if let paragraph = paragraph as? SkiaCapturedParagraph {
+            return paragraph.encoded()
+        }
+        guard let paragraph = paragraph as? SkiaParagraph else {
+            return nil
+        }
+        return SkiaCapturedParagraph(recording: paragraph).encoded()
+    }
+
+    public func encodeTextBlob(_ textBlob: TextBlob) -> Data? {
+        guard let textBlob = textBlob as? SkiaTextBlob else {
+            return nil
+        }
+        return Data(skData: sk_text_blob_serialize(textBlob.skTextBlob))
+    }
+
+    public func encodePath(_ path: Path) -> Data? {
+        guard let path = path as? SkiaPath else {
+            return nil
+        }
+        return Data(skData: sk_path_serialize(path.skPath))
+    }
+
+    public func encodeImage(_ image: NativeImage) -> Data? {
+        guard let image = image as? SkiaImage else {
+            return nil
+        }
+        return Data(skData: sk_image_encode_png(&image.skImage))
+    }
+
+    public func decodeParagraph(_ data: Data) -> Paragraph? {
+        SkiaCapturedParagraph(decoding: data)
+    }
+
+    public func decodeTextBlob(_ data: Data) -> TextBlob? {
+        let blob = data.withUnsafeBytes { sk_text_blob_deserialize($0.baseAddress, $0.count) }
+        guard blob.__convertToBool() else {
+            return nil
+        }
+        return SkiaTextBlob(skTextBlob: blob)
+    }
+
+    public func decodePath(_ data: Data) -> Path? {
+        let path = SkiaPath()
+        let valid = data.withUnsafeBytes {
+            sk_path_deserialize(&path.skPath, $0.baseAddress, $0.count)
+        }
+        return valid ? path : nil
+    }
+
+    public func decodeImage(_ data: Data) -> NativeImage? {
+        let image = data.withUnsafeBytes { sk_image_decode($0.baseAddress, $0.count) }
+        guard image.__convertToBool() else {
+            return nil
+        }
+        return SkiaImage(skImage: image)
+    }
+
+    public func makePlaceholderImage(width: UInt, height: UInt) -> NativeImage? {
+        let image = sk_image_make_transparent(Int32(clamping: width), Int32(clamping: height))
+        guard image.__convertToBool() else {
+            return nil
+        }
+        return SkiaImage(skImage: image)
+    }
+}
+
+/// A paragraph decoded from a frame capture or created as a
+/// ``SkiaParagraph/snapshot()``. It draws the glyphs of the captured
+/// paragraph at the size it was laid out with, and reports the captured
+/// metrics. Queries about text positions return empty results.
+public final class SkiaCapturedParagraph: Paragraph {
+    fileprivate struct Metrics {
+        var width: Float
+        var height: Float
+        var longestLine: Float
+        var minIntrinsicWidth: Float
+        var maxIntrinsicWidth: Float
+        var alphabeticBaseline: Float
+        var ideographicBaseline: Float
+        var didExceedMaxLines: Int32
+        var numberOfLines: Int32
+
+        init(_ paragraph: Paragraph) {
+            width = paragraph.width
+            height = paragraph.height
+            longestLine = paragraph.longestLine
+            minIntrinsicWidth = paragraph.minIntrinsicWidth
+            maxIntrinsicWidth = paragraph.maxIntrinsicWidth
+            alphabeticBaseline = paragraph.alphabeticBaseline
+            ideographicBaseline = paragraph.ideographicBaseline
+            didExceedMaxLines = paragraph.didExceedMaxLines ? 1 : 0
+            numberOfLines = Int32(paragraph.numberOfLines)
+        }
+    }
+
+    /// Glyphs may be drawn outside of the box of the paragraph, for example
+    /// by shadows or by lines that exceed the width.
+    fileprivate static let recordingBounds = SkRect.MakeLTRB(-1e9, -1e9, 1e9, 1e9)
+
+    fileprivate init(picture: SkPicture_sp, metrics: Metrics) {
+        self.picture = picture
+        self.metrics = metrics
+    }
+
+    /// Records the glyphs of `paragraph` with its current layout.
+    convenience init(recording paragraph: SkiaParagraph) {
+        let recorder = sk_picture_recorder_new()!
+        defer { sk_picture_recorder_delete(recorder) }
+        let skCanvas = sk_picture_recorder_begin(recorder, Self.recordingBounds)!
+        paragraph.paint(SkiaCanvas(recording: skCanvas), .zero)
+        let picture = sk_picture_recorder_finish(recorder)
+
+        self.init(picture: picture, metrics: Metrics(paragraph))
+    }
+
+    /// Decodes the metrics followed by the serialized picture.
+    fileprivate convenience init?(decoding data: Data) {
+        let size = MemoryLayout<Metrics>.size
+        guard data.count > size else {
+            return nil
+        }
+        let result: (Metrics, SkPicture_sp) = data.withUnsafeBytes { bytes in
+            let metrics = bytes.loadUnaligned(as: Metrics.self)
+            let picture = UnsafeRawBufferPointer(rebasing: bytes[size...])
+            return (metrics, sk_picture_deserialize(picture.baseAddress, picture.count))
+        }
+        guard result.1.__convertToBool() else {
+            return nil
+        }
+        self.init(picture: result.1, metrics: result.0)
+    }
+
+    private let picture: SkPicture_sp
+
+    private let metrics: Metrics
+
+    fileprivate func encoded() -> Data? {
+        guard let picture = Data(skData: sk_picture_serialize(picture)) else {
+            return nil
+        }
+        return withUnsafeBytes(of: metrics) { Data($0) } + picture
+    }
+
+    func paint(_ canvas: SkiaCanvas, _ offset: Offset) {
+        sk_canvas_save(canvas.skCanvas)
+        sk_canvas_translate(canvas.skCanvas, offset.dx, offset.dy)
+        sk_canvas_draw_picture(canvas.skCanvas, picture)
+        sk_canvas_restore(canvas.skCanvas)
+    }
+
+    public var width: Float { metrics.width }
+
+    public var height: Float { metrics.height }
+
+    public var longestLine: Float { metrics.longestLine }
+
+    public var minIntrinsicWidth: Float { metrics.minIntrinsicWidth }
+
+    public var maxIntrinsicWidth: Float { metrics.maxIntrinsicWidth }
+
+    public var alphabeticBaseline: Float { metrics.alphabeticBaseline }
+
+    public var ideographicBaseline: Float { metrics.ideographicBaseline }
+
+    public var didExceedMaxLines: Bool { metrics.didExceedMaxLines != 0 }
+
+    public var numberOfLines: Int { Int(metrics.numberOfLines) }
+
+    /// The layout is fixed at capture time.
+    public func layout(_ constraints: ParagraphConstraints) {}
+
+    public func snapshot() -> Paragraph {
+        self
+    }
+
+    public func getBoxesForRange(
+        _ start: TextIndex,
+        _ end: TextIndex,
+        boxHeightStyle: BoxHeightStyle,
+        boxWidthStyle: BoxWidthStyle
+    ) -> [TextBox] {
+        []
+    }
+
+    public func getBoxesForPlaceholders() -> [TextBox] {
+        []
+    }
+
+    public func getPositionForOffset(_ offset: Offset) -> TextPosition {
+        TextPosition(offset: .init(utf16Offset: 0), affinity: .downstream)
+    }
+
+    public func getClosestGlyphInfoForOffset(_ offset: Offset) -> GlyphInfo? {
+        nil
+    }
+
+    public func getGlyphInfoAt(_ offset: TextIndex) -> GlyphInfo? {
+        nil
+    }
+
+    public func getWordBoundary(_ position: TextPosition) -> Shaft.TextRange {
+        Shaft.TextRange(start: position.offset, end: position.offset)
+    }
+
+    public func computeLineMetrics() -> [LineMetrics] {
+        []
+    }
+
+    public func getLineMetricsAt(line: Int) -> LineMetrics? {
+        nil
+    }
+
+    public func getLineNumberAt(_ offset: TextIndex) -> Int? {
+        nil
+    }
+}
+
+extension Data {
+    /// Copies the bytes of `skData`, or returns nil if it's null.
+    fileprivate init?(skData: SkData_sp) {
+        guard skData.__convertToBool(), let bytes = sk_data_get_bytes(skData) else {
+            return nil
+        }
+        self.init(bytes: bytes, count: sk_data_get_size(skData))
+    }
+}
@@ -7,13 +7,89 @@ import Foundation
 import Shaft
 
 /// An implementation of ``Renderer`` using Skia as the backend.
-public class SkiaGLRenderer: SkiaRenderer, GLRenderer {
-    /// Cached GrDirectContext for creating surfaces.
+public class SkiaGLRenderer: SkiaRenderer, GLRenderer, GPUResourceCacheRenderer {
+    /// Whether canvases paint into a retained back buffer that is copied to
+    /// the window on flush. This allows views to repaint only the area that
+    /// changed since the previous frame. See ``SkiaBackBufferCanvas``.
+    ///
+    /// The copy costs a full-window blit on every frame that has damage.
+    /// Frames without damage skip both the copy and the swap. Disable this
+    /// for content that changes everywhere on most frames, such as video or
+    /// games, to paint straight into the window.
+    public var usesBackBuffer = true
+
+    public override var decodesToYUVAPlanes: Bool { true }
+
+    public var resourceCacheLimit: Int {
+        get { resourceCacheController.limit }
+        set {
+            resourceCacheController.limit = newValue
+            applyResourceCacheRequests()
+        }
+    }
+
+    public weak var gpuContextExecutor: GPUContextExecutor?
+
+    /// The directory where compiled shaders are kept across launches, so
+    /// that screens opened again don't stutter while their shaders compile.
+    /// Nil disables the cache. Only read when the first canvas is created.
+    public var shaderCacheDirectory: URL? = SkiaGLRenderer.defaultShaderCacheDirectory
+
+    /// What is kept in ``shaderCacheDirectory``. Only read when the first
+    /// canvas is created.
+    public var shaderCacheStrategy = SkiaShaderCacheStrategy.programBinary
+
+    /// The number of bytes of shaders kept in ``shaderCacheDirectory``. The
+    /// least recently used shaders are deleted beyond that. Only read when
+    /// the first canvas is created.
+    public var shaderCacheByteLimit = 32 * 1024 * 1024
+
+    /// A directory named after the app in the caches directory of the user.
+    public static var defaultShaderCacheDirectory: URL? {
+        let appName = Bundle.main.bundleIdentifier ?? ProcessInfo.processInfo.processName
+        return FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first?
+            .appendingPathComponent(appName)
+            .appendingPathComponent("ShaderCache")
+    }
+
+    /// The persistent cache of ``glGrDirectContext``. Must outlive it.
+    private var shaderCache: OpaquePointer?
+
+    /// Cached GrDirectContext for creating surfaces. Must only be created
+    /// and used while the GL context of a view is current.
     private lazy var glGrDirectContext: GrDirectContext_sp = {
         var interface = gr_glinterface_create_native_interface()
-        return gr_direct_context_make_gl(&interface)
+        var context: GrDirectContext_sp
+        if let shaderCacheDirectory {
+            shaderCache = sk_shader_cache_new_gl(
+                shaderCacheDirectory.path,
+                shaderCacheByteLimit,
+                &interface
+            )
+            context = gr_direct_context_make_gl_with_shader_cache(
+                &interface,
+                shaderCache,
+                shaderCacheStrategy == .sksl
+            )
+        } else {
+            context = gr_direct_context_make_gl(&interface)
+        }
+        resourceCacheController.configure(&context)
+        hasGrDirectContext = true
+        return context
     }()
 
+    /// Whether ``glGrDirectContext`` was created, so that resource cache
+    /// changes don't create it. Only accessed with the GL context current.
+    private var hasGrDirectContext = false
+
+    deinit {
+        if let shaderCache {
+            glGrDirectContext = GrDirectContext_sp()
+            sk_shader_cache_delete(shaderCache)
+        }
+    }
+
     public func createGLCanvas(fbo: UInt, size: ISize) -> DirectCanvas {
         let grGLInfo = GrGLFramebufferInfo(
             fFBOID: 0,
@@ -43,6 +119,109 @@ public class SkiaGLRenderer: SkiaRenderer, GLRenderer {
             nil
         )
 
-        return SkiaCanvas(skSurface, glGrDirectContext, size)
+        if usesBackBuffer,
+            let canvas = SkiaBackBufferCanvas(
+                skSurface,
+                glGrDirectContext,
+                size,
+                pictureCache: pictureCache,
+                rasterCache: rasterCache,
+                framePacer: framePacer,
+                resourceCacheController: resourceCacheController
+            )
+        {
+            return canvas
+        }
+
+        return SkiaCanvas(
+            skSurface,
+            glGrDirectContext,
+            size,
+            pictureCache: pictureCache,
+            rasterCache: rasterCache,
+            framePacer: framePacer,
+            resourceCacheController: resourceCacheController
+        )
+    }
+}
+
+/// What the shader cache of ``SkiaGLRenderer`` stores.
+public enum SkiaShaderCacheStrategy {
+    /// Linked programs as returned by the driver. Loading them skips all
+    /// compilation, but they can only be used once a draw needs them.
+    case programBinary
+
+    /// Shaders in Skia's shading language. They still have to be compiled
+    /// by the driver, but ``SkiaGLRenderer/warmUpShaders(with:)`` compiles
+    /// all of them ahead of time.
+    case sksl
+}
+
+extension SkiaGLRenderer {
+    /// Compiles shaders before they are needed by a frame, so that the first
+    /// frames of the app don't stutter. The SkSL kept in the shader cache is
+    /// compiled first, if the cache uses ``SkiaShaderCacheStrategy/sksl``.
+    /// Then `frames`, typically loaded from a capture of the screens of the
+    /// app with ``FrameCapture/load(from:codec:)``, are drawn offscreen to
+    /// compile the shaders they use, which also adds them to the cache.
+    ///
+    /// Must be called while the GL context of a view is current.
+    public func warmUpShaders(with frames: [CapturedFrame] = []) {
+        Timeline.timeSync("Shader warm-up") {
+            // The shader cache is opened together with the context, which
+            // may not exist yet before the first frame.
+            _ = glGrDirectContext
+
+            if let shaderCache, shaderCacheStrategy == .sksl {
+                sk_shader_cache_precompile(shaderCache, &glGrDirectContext)
+            }
+
+            for frame in frames {
+                let size = frame.physicalSize
+                guard size.width > 0, size.height > 0 else {
+                    continue
+                }
+                let skSurface = gr_direct_context_make_render_target(
+                    &glGrDirectContext,
+                    Int32(size.width),
+                    Int32(size.height)
+                )
+                guard skSurface.__convertToBool() else {
+                    continue
+                }
+                let canvas = SkiaCanvas(skSurface, glGrDirectContext, size)
+                frame.layerTree.paint(context: LayerPaintContext(canvas: canvas))
+                canvas.flush()
+            }
+        }
+    }
+}
+
+/// The GL context is only current on the raster thread of a view, so
+/// requests are recorded by ``SkiaResourceCacheController`` and applied on
+/// that thread through ``gpuContextExecutor``. Requests it can't run are
+/// applied on the next flush.
+extension SkiaGLRenderer {
+    public var resourceCacheUsage: GPUResourceCacheUsage? {
+        resourceCacheController.usage
+    }
+
+    public func purgeUnlockedResources(scratchOnly: Bool) {
+        resourceCacheController.purgeUnlockedResources(scratchOnly: scratchOnly)
+        applyResourceCacheRequests()
+    }
+
+    public func purgeResources(notUsedFor duration: Duration) {
+        resourceCacheController.purgeResources(notUsedFor: duration)
+        applyResourceCacheRequests()
+    }
+
+    private func applyResourceCacheRequests() {
+        _ = gpuContextExecutor?.runWithGPUContext { [weak self] in
+            guard let self, hasGrDirectContext else {
+                return
+            }
+            resourceCacheController.apply(&glGrDirectContext)
+        }
     }
 }
@@ -9,17 +9,22 @@ import Shaft
     import Foundation
     import Metal
 
-    public class SkiaMetalRenderer: SkiaRenderer, MetalRenderer {
+    public class SkiaMetalRenderer: SkiaRenderer, MetalRenderer, GPUResourceCacheRenderer {
         public init(device: MTLDevice, queue: MTLCommandQueue) {
             self.device = device
             self.queue = queue
             super.init()
+            // Views present with transactions right after flushing, which
+            // requires the command buffer to be scheduled by then.
+            framePacer.mode = .synchronous
         }
 
         public let device: MTLDevice
 
         public let queue: MTLCommandQueue
 
+        public override var decodesToYUVAPlanes: Bool { true }
+
         lazy var grMtlBackendContext: GrMtlBackendContext = {
             var grMtlBackendContext = GrMtlBackendContext()
             grMtlBackendContext.fDevice.reset(Unmanaged.passRetained(device).toOpaque())
@@ -27,10 +32,53 @@ import Shaft
             return grMtlBackendContext
         }()
 
+        public var resourceCacheLimit: Int {
+            get { resourceCacheController.limit }
+            set {
+                resourceCacheController.limit = newValue
+                applyResourceCacheRequests()
+            }
+        }
+
+        public weak var gpuContextExecutor: GPUContextExecutor?
+
         lazy var grMtlDirectContext: GrDirectContext_sp = {
-            gr_mtl_direct_context_make(&grMtlBackendContext)
+            var context = gr_mtl_direct_context_make(&grMtlBackendContext)
+            resourceCacheController.configure(&context)
+            hasGrDirectContext = true
+            return context
         }()
 
+        /// Whether ``grMtlDirectContext`` was created, so that resource cache
+        /// changes don't create it. Only accessed on the raster thread.
+        private var hasGrDirectContext = false
+
+        /// The context is used on the raster thread, so requests are recorded
+        /// by ``SkiaResourceCacheController`` and applied on that thread
+        /// through ``gpuContextExecutor``, or on the next flush.
+        public var resourceCacheUsage: GPUResourceCacheUsage? {
+            resourceCacheController.usage
+        }
+
+        public func purgeUnlockedResources(scratchOnly: Bool) {
+            resourceCacheController.purgeUnlockedResources(scratchOnly: scratchOnly)
+            applyResourceCacheRequests()
+        }
+
+        public func purgeResources(notUsedFor duration: Duration) {
+            resourceCacheController.purgeResources(notUsedFor: duration)
+            applyResourceCacheRequests()
+        }
+
+        private func applyResourceCacheRequests() {
+            _ = gpuContextExecutor?.runWithGPUContext { [weak self] in
+                guard let self, hasGrDirectContext else {
+                    return
+                }
+                resourceCacheController.apply(&grMtlDirectContext)
+            }
+        }
+
         /// Maps MTLPixelFormat to the corresponding SkColorType.
         /// Returns the appropriate Skia color type for the given Metal pixel format,
         /// or BGRA_8888 as a safe fallback for unsupported formats.
@@ -84,7 +132,15 @@ import Shaft
                 nil
             )
 
-            return SkiaCanvas(skSurface, grMtlDirectContext, size)
+            return SkiaCanvas(
+                skSurface,
+                grMtlDirectContext,
+                size,
+                pictureCache: pictureCache,
+                rasterCache: rasterCache,
+                framePacer: framePacer,
+                resourceCacheController: resourceCacheController
+            )
         }
 
         public func createMetalImage(texture: any MTLTexture) -> any NativeImage {
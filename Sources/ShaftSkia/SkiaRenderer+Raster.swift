@@ -0,0 +1,66 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+import Shaft
+
+/// An implementation of ``Renderer`` that rasterizes on the CPU using Skia's
+/// raster backend. No GPU context is created.
+public class SkiaRasterRenderer: SkiaRenderer, RasterRenderer {
+    public func createRasterCanvas(size: ISize) -> RasterCanvas {
+        precondition(size.width > 0 && size.height > 0, "Raster canvas must not be empty.")
+
+        let skSurface = sk_surface_make_raster(Int32(size.width), Int32(size.height))
+        precondition(skSurface.__convertToBool(), "Failed to allocate raster surface of \(size).")
+
+        return SkiaRasterCanvas(
+            skSurface,
+            size,
+            pictureCache: pictureCache,
+            rasterCache: rasterCache
+        )
+    }
+}
+
+/// A ``SkiaCanvas`` that draws into a raster surface owned by Skia.
+public class SkiaRasterCanvas: SkiaCanvas, RasterCanvas {
+    init(
+        _ skSurface: SkSurface_sp,
+        _ size: ISize,
+        pictureCache: SkiaPictureCache?,
+        rasterCache: SkiaRasterCache?
+    ) {
+        super.init(
+            skSurface,
+            GrDirectContext_sp(),
+            size,
+            pictureCache: pictureCache,
+            rasterCache: rasterCache
+        )
+    }
+
+    public func withPixels<R>(_ body: (RasterPixels) throws -> R) rethrows -> R {
+        var pixmap = SkPixmap()
+        let success = sk_surface_peek_pixels(skSurface, &pixmap)
+        precondition(success, "Raster surface pixels are not accessible.")
+
+        return try body(
+            RasterPixels(
+                baseAddress: pixmap.addr()!,
+                rowBytes: Int(pixmap.rowBytes()),
+                size: size
+            )
+        )
+    }
+
+    /// Raster surfaces are owned by the canvas, so their content is kept
+    /// between frames.
+    public override var preservesContents: Bool { true }
+
+    /// Raster surfaces draw synchronously, so there is nothing to submit.
+    public override func flush() {
+        pictureCache?.endFrame()
+    }
+}
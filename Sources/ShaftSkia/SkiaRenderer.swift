@@ -9,6 +9,7 @@ import Shaft
 /// An implementation of ``Renderer`` using Skia as the backend.
 public class SkiaRenderer: Renderer {
     public init() {
+        Timeline.addSource(SkiaTimelineSource.shared)
     }
 
     public func createParagraphBuilder(_ style: ParagraphStyle) -> ParagraphBuilder {
@@ -21,14 +22,46 @@ public class SkiaRenderer: Renderer {
         SkiaTextBlob(glyphs, positions: positions, font: font)
     }
 
-    public func decodeImageFromData(_ data: Data) -> AnimatedImage? {
-        SkiaAnimatedImage.decode(data)
+    public func decodeImageFromData(_ data: Data, targetSize: ISize?) -> AnimatedImage? {
+        SkiaAnimatedImage.decode(data, targetSize: targetSize, yuvaPlanes: decodesToYUVAPlanes)
     }
 
+    public func decodeImageFromFile(_ url: URL, targetSize: ISize?) -> AnimatedImage? {
+        SkiaAnimatedImage.decode(
+            contentsOf: url,
+            targetSize: targetSize,
+            yuvaPlanes: decodesToYUVAPlanes
+        )
+    }
+
+    /// Whether still images that can be decoded into YUVA planes, such as
+    /// most JPEGs, are kept as planes and converted to RGB on the GPU when
+    /// drawn. A 4:2:0 JPEG takes 1.5 bytes per pixel this way instead of 4,
+    /// and decoding skips the color conversion. Only GPU renderers do this,
+    /// since raster canvases would decode the image again when drawing it.
+    public var decodesToYUVAPlanes: Bool { false }
+
     public func createPath() -> any Path {
         SkiaPath()
     }
 
+    /// Pictures of display lists retained across frames by the canvases of
+    /// this renderer.
+    public let pictureCache = SkiaPictureCache()
+
+    /// Snapshots of layers that stayed unchanged across frames, shared by the
+    /// canvases of this renderer.
+    public let rasterCache = SkiaRasterCache()
+
+    /// Controls how canvases of this renderer submit frames to the GPU and
+    /// reports the GPU time of each frame. ``SkiaMetalRenderer`` sets it to
+    /// ``SkiaSubmitMode/synchronous``.
+    public let framePacer = SkiaFramePacer(mode: .asynchronous(maxFramesInFlight: 2))
+
+    /// Limits and purges the GPU resource cache of GPU renderers from the
+    /// raster thread.
+    public let resourceCacheController = SkiaResourceCacheController()
+
     public let _fontCollection = SkiaFontCollection()
     public var fontCollection: FontCollection { _fontCollection }
 }
@@ -0,0 +1,137 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+import Shaft
+
+/// The resource cache limit of a new GrDirectContext.
+public let skiaDefaultResourceCacheLimit = 256 * 1024 * 1024
+
+extension GPUResourceCacheUsage {
+    /// Reads the usage of the resource cache of `context`.
+    init(_ context: inout GrDirectContext_sp) {
+        var resourceCount: Int32 = 0
+        var resourceBytes = 0
+        gr_direct_context_get_resource_cache_usage(&context, &resourceCount, &resourceBytes)
+        self.init(
+            resourceCount: Int(resourceCount),
+            resourceBytes: resourceBytes,
+            purgeableBytes: gr_direct_context_get_resource_cache_purgeable_bytes(&context),
+            limit: gr_direct_context_get_resource_cache_limit(&context)
+        )
+    }
+}
+
+/// Changes to the resource cache of a GrDirectContext that were requested
+/// but not applied yet.
+struct SkiaResourceCacheRequests: Equatable {
+    /// The new limit, or nil if it didn't change.
+    var limit: Int?
+
+    /// Whether only scratch resources are purged, or nil if no purge of
+    /// unlocked resources was requested.
+    var purgeScratchOnly: Bool?
+
+    var purgeNotUsedFor: Duration?
+}
+
+/// Changes to the resource cache of a GrDirectContext that may be requested
+/// from any thread.
+///
+/// A GrDirectContext is not thread-safe and can only be used while its GPU
+/// context is current, which is the case on the raster thread of a view. The
+/// changes are therefore recorded here and applied on that thread, either
+/// right away through the ``GPUContextExecutor`` of the renderer, or by
+/// canvases when they flush, before the frame is submitted. The usage of the
+/// cache is read at the same time.
+public final class SkiaResourceCacheController {
+    init(limit: Int = skiaDefaultResourceCacheLimit) {
+        self._limit = limit
+    }
+
+    /// The number of bytes the cache may hold.
+    public var limit: Int {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return _limit
+        }
+        set {
+            lock.lock()
+            defer { lock.unlock() }
+            _limit = newValue
+            requests.limit = newValue
+        }
+    }
+
+    /// The usage of the cache as of the last time changes were applied, or
+    /// nil if they never were.
+    public var usage: GPUResourceCacheUsage? {
+        lock.lock()
+        defer { lock.unlock() }
+        return _usage
+    }
+
+    /// Requests a purge of unlocked resources. A request for all resources
+    /// wins over one for scratch resources only.
+    public func purgeUnlockedResources(scratchOnly: Bool) {
+        lock.lock()
+        defer { lock.unlock() }
+        requests.purgeScratchOnly = (requests.purgeScratchOnly ?? true) && scratchOnly
+    }
+
+    /// Requests a purge of resources not used for `duration`. The shortest
+    /// requested duration wins.
+    public func purgeResources(notUsedFor duration: Duration) {
+        lock.lock()
+        defer { lock.unlock() }
+        requests.purgeNotUsedFor = min(requests.purgeNotUsedFor ?? duration, duration)
+    }
+
+    private var _limit: Int
+
+    private var requests = SkiaResourceCacheRequests()
+
+    private var _usage: GPUResourceCacheUsage?
+
+    private let lock = NSLock()
+
+    /// Returns the requests made since the last call and clears them.
+    func takeRequests() -> SkiaResourceCacheRequests {
+        lock.lock()
+        defer { lock.unlock() }
+        let requests = requests
+        self.requests = SkiaResourceCacheRequests()
+        return requests
+    }
+
+    /// Applies the limit to a context that was just created.
+    func configure(_ context: inout GrDirectContext_sp) {
+        gr_direct_context_set_resource_cache_limit(&context, limit)
+    }
+
+    /// Applies the requested changes to `context`. Must be called while the
+    /// GPU context of `context` is current.
+    func apply(_ context: inout GrDirectContext_sp) {
+        let requests = takeRequests()
+        if let limit = requests.limit {
+            gr_direct_context_set_resource_cache_limit(&context, limit)
+        }
+        if let purgeScratchOnly = requests.purgeScratchOnly {
+            gr_direct_context_purge_unlocked_resources(&context, purgeScratchOnly)
+        }
+        if let purgeNotUsedFor = requests.purgeNotUsedFor {
+            gr_direct_context_purge_resources_not_used_in_ms(
+                &context,
+                purgeNotUsedFor.inMilliseconds
+            )
+        }
+
+        let usage = GPUResourceCacheUsage(&context)
+        lock.lock()
+        _usage = usage
+        lock.unlock()
+    }
+}
@@ -0,0 +1,74 @@
+// Copyright 2024 The Shaft Authors.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+import CSkia
+import Foundation
+import Shaft
+
+/// Adds the trace events emitted by Skia, such as path mask rendering, glyph
+/// uploads and GPU submissions, to recordings of ``Timeline``.
+///
+/// Skia only accepts a tracer before it emits its first event, so the source
+/// is installed when the first ``SkiaRenderer`` is created.
+public final class SkiaTimelineSource: TimelineSource {
+    public static let shared = SkiaTimelineSource()
+
+    private init() {
+        isInstalled = sk_trace_install()
+    }
+
+    /// Whether Skia reports its events to this source. False if Skia was
+    /// already using another tracer.
+    public let isInstalled: Bool
+
+    /// Whether to record the categories Skia disables by default, which are
+    /// very verbose.
+    public var includeDisabledByDefault = false
+
+    public func startRecording() {
+        sk_trace_set_recording(true, includeDisabledByDefault)
+    }
+
+    public func stopRecording() -> [TimelineEvent] {
+        sk_trace_set_recording(false, false)
+
+        // Skia timestamps use the C++ steady clock, which may have another
+        // origin than the clock of the timeline.
+        let offset = Timeline.now - .microseconds(Int64(sk_trace_now_micros()))
+
+        var collector = Collector(offset: offset)
+        withUnsafeMutablePointer(to: &collector) { collector in
+            sk_trace_drain(collector) { context, record in
+                let collector = context!.assumingMemoryBound(to: Collector.self)
+                collector.pointee.add(record!.pointee)
+            }
+        }
+        return collector.events
+    }
+
+    private struct Collector {
+        let offset: Duration
+
+        var events: [TimelineEvent] = []
+
+        mutating func add(_ record: SkTraceEventRecord) {
+            let kind: TimelineEvent.Kind =
+                switch UInt8(bitPattern: record.phase) {
+                case UInt8(ascii: "X"), UInt8(ascii: "B"):
+                    .complete(duration: .microseconds(Int64(record.durationMicros)))
+                default:
+                    .instant
+                }
+            events.append(
+                TimelineEvent(
+                    name: String(cString: record.name),
+                    category: String(cString: record.category),
+                    kind: kind,
+                    timestamp: .microseconds(Int64(record.timestampMicros)) + offset,
+                    threadID: record.threadID
+                )
+            )
+        }
+    }
+}
@@ -8,24 +8,76 @@ import Shaft
 
 extension Paint {
     func copyToSkia(paint: inout SkPaint) {
-        paint.setAntiAlias(isAntiAlias)
-        paint.setColor(color.value)
+        copyToSkia(paint: &paint, replacing: nil)
+    }
+
+    /// Copies this paint into `paint`, which must currently hold `previous`.
+    /// Only the fields that differ from `previous` are set.
+    func copyToSkia(paint: inout SkPaint, replacing previous: Paint?) {
+        if isAntiAlias != previous?.isAntiAlias {
+            paint.setAntiAlias(isAntiAlias)
+        }
+        if color != previous?.color {
+            paint.setColor(color.value)
+        }
         // paint.setBlender(blender)
-        paint.setBlendMode(blendMode.toSkia())
-        paint.setStyle(style.toSkia())
-        paint.setStrokeWidth(strokeWidth)
-        paint.setStrokeCap(strokeCap.toSkia())
-        paint.setStrokeJoin(strokeJoin.toSkia())
-        paint.setStrokeMiter(strokeMiterLimit)
-        if let maskFilter {
-            sk_paint_set_maskfilter_blur(&paint, maskFilter.style.toSkia(), maskFilter.sigma)
-        } else {
-            sk_paint_clear_maskfilter(&paint)
+        if blendMode != previous?.blendMode {
+            paint.setBlendMode(blendMode.toSkia())
+        }
+        if style != previous?.style {
+            paint.setStyle(style.toSkia())
+        }
+        if strokeWidth != previous?.strokeWidth {
+            paint.setStrokeWidth(strokeWidth)
+        }
+        if strokeCap != previous?.strokeCap {
+            paint.setStrokeCap(strokeCap.toSkia())
+        }
+        if strokeJoin != previous?.strokeJoin {
+            paint.setStrokeJoin(strokeJoin.toSkia())
+        }
+        if strokeMiterLimit != previous?.strokeMiterLimit {
+            paint.setStrokeMiter(strokeMiterLimit)
+        }
+        if previous == nil || maskFilter != previous!.maskFilter {
+            if let maskFilter {
+                sk_paint_set_maskfilter_blur(&paint, maskFilter.style.toSkia(), maskFilter.sigma)
+            } else {
+                sk_paint_clear_maskfilter(&paint)
+            }
+        }
+        if previous == nil || colorFilter != previous!.colorFilter {
+            let (kind, values) = colorFilter.replayValue
+            sk_paint_set_colorfilter(&paint, kind, values)
         }
         // filterQuality
     }
 }
 
+extension Optional where Wrapped == ColorFilter {
+    /// The kind and values of the filter as understood by
+    /// `sk_paint_set_colorfilter` and replay op streams.
+    var replayValue: (kind: SkColorFilterKind, values: [UInt32]) {
+        switch self {
+        case nil:
+            return (.noFilter, [])
+        case .mode(let color, let blendMode):
+            return (.blend, [color.value, UInt32(blendMode.toSkia().rawValue)])
+        case .matrix(let matrix):
+            assert(matrix.count == 20, "A color matrix must have 20 values")
+            // Skia expects offsets in the range 0..1.
+            let values = matrix.enumerated().map { index, value in
+                index % 5 == 4 ? value / 255 : value
+            }
+            return (.matrix, values.map(\.bitPattern))
+        case .linearToSrgbGamma:
+            return (.linearToSrgbGamma, [])
+        case .srgbToLinearGamma:
+            return (.srgbToLinearGamma, [])
+        }
+    }
+}
+
 extension BoxWidthStyle {
     func toSkia() -> skia.textlayout.RectWidthStyle {
         return switch self {
@@ -0,0 +1,162 @@
+import SwiftMath
+import XCTest
+
+@testable import Shaft
+
+final class DisplayListOptimizerTests: XCTestCase {
+    private func optimize(_ record: (DisplayListBuilder) -> Void) -> [String] {
+        let builder = DisplayListBuilder()
+        record(builder)
+        let optimizer = DisplayListOptimizer()
+        let receiver = TestOpReceiver()
+        optimizer.optimize(builder.build()).dispatch(to: receiver)
+        return receiver.log
+    }
+
+    func testRemovesSaveRestoreWithoutDrawing() {
+        let log = optimize { builder in
+            builder.save()
+            builder.translate(10, 10)
+            builder.clipRect(Rect(left: 0, top: 0, right: 5, bottom: 5), .intersect, false)
+            builder.restore()
+            builder.drawRect(Rect(left: 0, top: 0, right: 1, bottom: 1), Paint())
+        }
+        XCTAssertEqual(log, ["drawRect(\(Rect(left: 0, top: 0, right: 1, bottom: 1)))"])
+    }
+
+    func testFoldsTranslateAndScaleIntoGeometry() {
+        let log = optimize { builder in
+            builder.save()
+            builder.translate(10, 20)
+            builder.scale(2, 2)
+            builder.drawRect(Rect(left: 0, top: 0, right: 5, bottom: 5), Paint())
+            builder.restore()
+        }
+        XCTAssertEqual(
+            log,
+            ["save", "drawRect(\(Rect(left: 10, top: 20, right: 20, bottom: 30)))", "restore"]
+        )
+    }
+
+    func testKeepsScaleForStrokes() {
+        var stroke = Paint()
+        stroke.style = .stroke
+        stroke.strokeWidth = 2
+
+        let log = optimize { builder in
+            builder.translate(10, 0)
+            builder.scale(2, 2)
+            builder.drawRect(Rect(left: 0, top: 0, right: 5, bottom: 5), stroke)
+        }
+        XCTAssertEqual(
+            log,
+            [
+                "translate(10.0, 0.0)",
+                "scale(2.0, 2.0)",
+                "drawRect(\(Rect(left: 0, top: 0, right: 5, bottom: 5)))",
+            ]
+        )
+    }
+
+    func testMergesAdjacentClipRects() {
+        let log = optimize { builder in
+            builder.save()
+            builder.clipRect(Rect(left: 0, top: 0, right: 10, bottom: 10), .intersect, false)
+            builder.translate(5, 0)
+            builder.clipRect(Rect(left: 0, top: 0, right: 10, bottom: 10), .intersect, false)
+            builder.drawRect(Rect(left: 0, top: 0, right: 1, bottom: 1), Paint())
+            builder.restore()
+        }
+        XCTAssertEqual(
+            log,
+            [
+                "save",
+                "clipRect(\(Rect(left: 5, top: 0, right: 10, bottom: 10)), intersect, false)",
+                "drawRect(\(Rect(left: 5, top: 0, right: 6, bottom: 1)))",
+                "restore",
+            ]
+        )
+    }
+
+    func testReplacesSaveLayerWithoutPaint() {
+        let log = optimize { builder in
+            builder.saveLayer(Rect(left: 0, top: 0, right: 10, bottom: 10), paint: nil)
+            builder.drawRect(Rect(left: 0, top: 0, right: 1, bottom: 1), Paint())
+            builder.restore()
+        }
+        XCTAssertEqual(
+            log,
+            ["save", "drawRect(\(Rect(left: 0, top: 0, right: 1, bottom: 1)))", "restore"]
+        )
+    }
+
+    func testKeepsSaveLayerWithNonSourceOverContent() {
+        var clear = Paint()
+        clear.blendMode = .clear
+
+        let log = optimize { builder in
+            builder.saveLayer(Rect(left: 0, top: 0, right: 10, bottom: 10), paint: nil)
+            builder.drawRect(Rect(left: 0, top: 0, right: 1, bottom: 1), clear)
+            builder.restore()
+        }
+        XCTAssertEqual(log.first, "saveLayer(\(Rect(left: 0, top: 0, right: 10, bottom: 10)), nil)")
+    }
+
+    func testRemovesOpsCoveredByOpaqueRect() {
+        var translucent = Paint()
+        translucent.color = Color(0x8000_0000)
+
+        let log = optimize { builder in
+            builder.drawCircle(Offset(5, 5), 2, Paint())
+            builder.drawRect(Rect(left: 0, top: 0, right: 20, bottom: 20), translucent)
+            builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+        }
+        XCTAssertEqual(
+            log,
+            [
+                "drawRect(\(Rect(left: 0, top: 0, right: 20, bottom: 20)))",
+                "drawRect(\(Rect(left: 0, top: 0, right: 10, bottom: 10)))",
+            ]
+        )
+    }
+
+    func testKeepsOpsUnderAntiAliasedRectOffWholePixels() {
+        let cover = Rect(left: 0.5, top: 0, right: 10, bottom: 10)
+        let log = optimize { builder in
+            builder.drawRect(Rect(left: 1, top: 1, right: 2, bottom: 2), Paint())
+            builder.drawRect(cover, Paint())
+        }
+        XCTAssertEqual(log.count, 2)
+    }
+
+    func testRectWithoutAntiAliasOnlyCoversOpsWithoutAntiAlias() {
+        var aliased = Paint()
+        aliased.isAntiAlias = false
+        let cover = Rect(left: 0.5, top: 0, right: 10, bottom: 10)
+        let log = optimize { builder in
+            builder.drawRect(Rect(left: 1, top: 1, right: 2, bottom: 2), aliased)
+            builder.drawCircle(Offset(5, 5), 2, Paint())
+            builder.drawRect(cover, aliased)
+        }
+        XCTAssertEqual(log, ["drawCircle(\(Offset(5, 5)), 2.0)", "drawRect(\(cover))"])
+    }
+
+    func testReportsOpsRemovedPerFrame() {
+        let builder = DisplayListBuilder()
+        builder.save()
+        builder.restore()
+        builder.drawRect(Rect(left: 0, top: 0, right: 1, bottom: 1), Paint())
+
+        let optimizer = DisplayListOptimizer()
+        var reported: [DisplayListOptimizerStats] = []
+        optimizer.onFrameStats = { reported.append($0) }
+        _ = optimizer.optimize(builder.build())
+        optimizer.endFrame()
+
+        XCTAssertEqual(reported.count, 1)
+        XCTAssertEqual(reported[0].displayListCount, 1)
+        XCTAssertEqual(reported[0].opsBefore, 3)
+        XCTAssertEqual(reported[0].opsRemoved, 2)
+        XCTAssertEqual(optimizer.currentFrameStats, DisplayListOptimizerStats())
+    }
+}
@@ -0,0 +1,225 @@
+import SwiftMath
+import XCTest
+
+@testable import Shaft
+
+final class DisplayListTests: XCTestCase {
+    func testReplaysOpsInRecordingOrder() {
+        let rect = Rect(left: 1, top: 2, right: 3, bottom: 4)
+        let builder = DisplayListBuilder()
+        builder.save()
+        builder.clipRect(rect, .difference, false)
+        builder.drawRect(rect, Paint())
+        builder.drawCircle(Offset(5, 6), 7, Paint())
+        builder.saveLayer(rect, paint: nil)
+        builder.restore()
+        builder.restore()
+
+        let displayList = builder.build()
+        XCTAssertEqual(displayList.opCount, 7)
+
+        let receiver = TestOpReceiver()
+        displayList.dispatch(to: receiver)
+        XCTAssertEqual(
+            receiver.log,
+            [
+                "save",
+                "clipRect(\(rect), difference, false)",
+                "drawRect(\(rect))",
+                "drawCircle(\(Offset(5, 6)), 7.0)",
+                "saveLayer(\(rect), nil)",
+                "restore",
+                "restore",
+            ]
+        )
+    }
+
+    func testDeduplicatesPaints() {
+        var red = Paint()
+        red.color = Color(0xFFFF_0000)
+        var blurred = red
+        blurred.maskFilter = MaskFilter(style: .normal, sigma: 2)
+
+        let builder = DisplayListBuilder()
+        for i in 0..<10 {
+            builder.drawRect(Rect(left: 0, top: 0, right: Float(i), bottom: 1), red)
+            builder.drawRect(Rect(left: 0, top: 0, right: Float(i), bottom: 1), blurred)
+        }
+
+        let displayList = builder.build()
+        XCTAssertEqual(displayList.paints.count, 2)
+
+        let receiver = TestOpReceiver()
+        displayList.dispatch(to: receiver)
+        XCTAssertEqual(receiver.paints.count, 20)
+        XCTAssertEqual(receiver.paints[18], red)
+        XCTAssertEqual(receiver.paints[19], blurred)
+    }
+
+    func testStoresTranslationTransformAsTranslate() {
+        let builder = DisplayListBuilder()
+        builder.transform(Matrix4x4f.translate(tx: 10, ty: 20, tz: 0))
+
+        let receiver = TestOpReceiver()
+        builder.build().dispatch(to: receiver)
+        XCTAssertEqual(receiver.log, ["translate(10.0, 20.0)"])
+    }
+
+    func testRoundTrips2DTransform() {
+        var matrix = Matrix4x4f.identity
+        matrix[0, 0] = 2
+        matrix[1, 0] = 0.5
+        matrix[3, 0] = 10
+        matrix[0, 1] = 0.25
+        matrix[1, 1] = 3
+        matrix[3, 1] = 20
+
+        let builder = DisplayListBuilder()
+        builder.transform(matrix)
+        let displayList = builder.build()
+
+        // Tag + six floats instead of a full 4x4 matrix.
+        XCTAssertEqual(displayList.byteCount, 1 + 6 * MemoryLayout<Float>.size)
+
+        class Receiver: TestOpReceiver {
+            var matrix: Matrix4x4f?
+            override func transform(_ transform: Matrix4x4f) {
+                matrix = transform
+            }
+        }
+        let receiver = Receiver()
+        displayList.dispatch(to: receiver)
+        XCTAssertTrue(MatrixUtils.matrixEquals(receiver.matrix, matrix))
+    }
+
+    func testFlattensNestedDisplayLists() {
+        let inner = DisplayListBuilder()
+        inner.drawLine(Offset(0, 0), Offset(1, 1), Paint())
+
+        let outer = DisplayListBuilder()
+        outer.translate(1, 2)
+        outer.drawDisplayList(inner.build())
+
+        let receiver = TestOpReceiver()
+        outer.build().dispatch(to: receiver)
+        XCTAssertEqual(
+            receiver.log,
+            ["translate(1.0, 2.0)", "drawLine(\(Offset(0, 0)), \(Offset(1, 1)))"]
+        )
+    }
+
+    func testEachBuildHasUniqueID() {
+        let builder = DisplayListBuilder()
+        builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+        let first = builder.build()
+        let second = builder.build()
+
+        XCTAssertNotEqual(first.uniqueID, second.uniqueID)
+    }
+
+    func testComputesBoundsThroughTransformsAndClips() {
+        let builder = DisplayListBuilder()
+        builder.save()
+        builder.translate(10, 20)
+        builder.drawRect(Rect(left: 0, top: 0, right: 5, bottom: 5), Paint())
+        builder.restore()
+        builder.clipRect(Rect(left: 0, top: 0, right: 50, bottom: 50), .intersect, false)
+        builder.drawRect(Rect(left: 40, top: 40, right: 100, bottom: 100), Paint())
+
+        XCTAssertEqual(builder.build().bounds, Rect(left: 10, top: 20, right: 50, bottom: 50))
+    }
+
+    func testUnclippedClearHasUnknownBounds() {
+        let builder = DisplayListBuilder()
+        builder.clear(color: Color(0xFFFF_FFFF))
+
+        XCTAssertNil(builder.build().bounds)
+    }
+
+    func testCullingSkipsOpsOutsideCullRect() {
+        let builder = DisplayListBuilder()
+        builder.save()
+        builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+        builder.translate(100, 0)
+        builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+        builder.restore()
+
+        let receiver = TestOpReceiver()
+        let cullRect = Rect(left: 90, top: 0, right: 120, bottom: 10)
+        builder.build().dispatch(to: receiver, cullRect: cullRect)
+        XCTAssertEqual(
+            receiver.log,
+            [
+                "save",
+                "translate(100.0, 0.0)",
+                "drawRect(\(Rect(left: 0, top: 0, right: 10, bottom: 10)))",
+                "restore",
+            ]
+        )
+    }
+
+    func testCullingWithSpatialIndexMatchesLinearScan() {
+        let builder = DisplayListBuilder()
+        for i in 0..<100 {
+            builder.save()
+            builder.translate(Float(i % 10) * 20, Float(i / 10) * 20)
+            builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+            builder.restore()
+        }
+        let displayList = builder.build()
+        XCTAssertNotNil(displayList.rtree)
+
+        let cullRect = Rect(left: 35, top: 35, right: 65, bottom: 45)
+        let expected = (0..<displayList.opCount).filter {
+            displayList.opBounds[$0].intersects(cullRect)
+        }
+        XCTAssertEqual(displayList.visibleOps(in: cullRect), expected)
+        XCTAssertEqual(expected.count - displayList.stateOps.count, 2)
+    }
+
+    func testCullingWithSpatialIndexAroundOriginReplaysStateOpsOnce() {
+        let builder = DisplayListBuilder()
+        for i in 0..<100 {
+            builder.save()
+            builder.translate(Float(i % 10) * 20, Float(i / 10) * 20)
+            builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+            builder.restore()
+        }
+        let displayList = builder.build()
+        XCTAssertNotNil(displayList.rtree)
+
+        // Culling outsets the local clip bounds, so the origin is usually
+        // strictly inside of the cull rect.
+        let cullRect = Rect(left: -1, top: -1, right: 31, bottom: 11)
+        let expected = (0..<displayList.opCount).filter {
+            displayList.opBounds[$0].intersects(cullRect)
+        }
+        XCTAssertEqual(displayList.visibleOps(in: cullRect), expected)
+        let found = displayList.rtree!.search(cullRect)
+        XCTAssertEqual(found.count, 2)
+        XCTAssertTrue(Set(found).isDisjoint(with: displayList.stateOps))
+
+        let linear = TestOpReceiver()
+        let indexed = TestOpReceiver()
+        displayList.dispatch(to: linear)
+        displayList.dispatch(to: indexed, cullRect: cullRect)
+        let drawCount = indexed.log.filter { $0.hasPrefix("drawRect") }.count
+        XCTAssertEqual(drawCount, 2)
+        XCTAssertEqual(
+            indexed.log.filter { !$0.hasPrefix("drawRect") },
+            linear.log.filter { !$0.hasPrefix("drawRect") }
+        )
+    }
+
+    func testGroupOpacityRequiresDisjointOps() {
+        let disjoint = DisplayListBuilder()
+        disjoint.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+        disjoint.drawRect(Rect(left: 20, top: 0, right: 30, bottom: 10), Paint())
+        XCTAssertTrue(disjoint.build().canApplyGroupOpacity)
+
+        let overlapping = DisplayListBuilder()
+        overlapping.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+        overlapping.drawCircle(Offset(10, 10), 5, Paint())
+        XCTAssertFalse(overlapping.build().canApplyGroupOpacity)
+    }
+}
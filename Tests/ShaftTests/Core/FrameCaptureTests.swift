@@ -0,0 +1,139 @@
+import Foundation
+import XCTest
+
+@testable import Shaft
+
+/// A codec for captures without resources.
+private final class NullCaptureCodec: CaptureResourceCodec {
+    func encodeParagraph(_ paragraph: Paragraph) -> Data? { nil }
+
+    func encodeTextBlob(_ textBlob: TextBlob) -> Data? { nil }
+
+    func encodePath(_ path: Path) -> Data? { nil }
+
+    func encodeImage(_ image: NativeImage) -> Data? { nil }
+
+    func decodeParagraph(_ data: Data) -> Paragraph? { nil }
+
+    func decodeTextBlob(_ data: Data) -> TextBlob? { nil }
+
+    func decodePath(_ data: Data) -> Path? { nil }
+
+    func decodeImage(_ data: Data) -> NativeImage? { nil }
+
+    func makePlaceholderImage(width: UInt, height: UInt) -> NativeImage? {
+        TestCaptureImage(width: width, height: height)
+    }
+}
+
+private final class TestCaptureImage: NativeImage {
+    init(width: UInt, height: UInt) {
+        self.width = width
+        self.height = height
+    }
+
+    let width: UInt
+
+    let height: UInt
+}
+
+final class FrameCaptureTests: XCTestCase {
+    private var url: URL!
+
+    override func setUp() {
+        url = FileManager.default.temporaryDirectory
+            .appendingPathComponent("FrameCaptureTests-\(UUID().uuidString).shaftcap")
+    }
+
+    override func tearDown() {
+        try? FrameCapture.stop()
+        try? FileManager.default.removeItem(at: url)
+    }
+
+    private func capture(_ roots: [Layer]) throws -> [CapturedFrame] {
+        let codec = NullCaptureCodec()
+        try FrameCapture.start(to: url, codec: codec)
+        for root in roots {
+            FrameCapture.capture(
+                LayerTree(root: root),
+                physicalSize: ISize(200, 100),
+                devicePixelRatio: 2
+            )
+        }
+        try FrameCapture.stop()
+        return try FrameCapture.load(from: url, codec: codec)
+    }
+
+    func testReplaysCapturedLayersAndOps() throws {
+        let rect = Rect(left: 1, top: 2, right: 3, bottom: 4)
+        let builder = DisplayListBuilder()
+        builder.save()
+        builder.drawRect(rect, Paint())
+        builder.drawCircle(Offset(5, 6), 7, Paint())
+        builder.restore()
+
+        let picture = PictureLayer(canvasBounds: Rect(left: 0, top: 0, right: 10, bottom: 10))
+        picture.picture = builder.build()
+        let root = OffsetLayer(offset: Offset(10, 20))
+        root.append(picture)
+
+        let frames = try capture([root])
+        XCTAssertEqual(frames.count, 1)
+        XCTAssertEqual(frames[0].physicalSize, ISize(200, 100))
+        XCTAssertEqual(frames[0].devicePixelRatio, 2)
+
+        let replayedRoot = try XCTUnwrap(frames[0].layerTree.root as? OffsetLayer)
+        XCTAssertEqual(replayedRoot.offset, Offset(10, 20))
+        let replayedPicture = try XCTUnwrap(replayedRoot.children.first as? PictureLayer)
+        XCTAssertEqual(replayedPicture.canvasBounds, picture.canvasBounds)
+
+        let expected = TestOpReceiver()
+        picture.picture!.dispatch(to: expected)
+        let actual = TestOpReceiver()
+        try XCTUnwrap(replayedPicture.picture).dispatch(to: actual)
+        XCTAssertEqual(actual.log, expected.log)
+    }
+
+    func testFramesShareUnchangedDisplayLists() throws {
+        let builder = DisplayListBuilder()
+        builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+        let picture = PictureLayer(canvasBounds: Rect(left: 0, top: 0, right: 10, bottom: 10))
+        picture.picture = builder.build()
+
+        let first = OffsetLayer()
+        first.append(picture)
+        let second = OffsetLayer(offset: Offset(5, 0))
+        second.append(picture)
+
+        let frames = try capture([first, second])
+        XCTAssertEqual(frames.count, 2)
+
+        func displayList(_ frame: CapturedFrame) -> DisplayList? {
+            let root = frame.layerTree.root as? ContainerLayer
+            return (root?.children.first as? PictureLayer)?.picture
+        }
+        XCTAssertNotNil(displayList(frames[0]))
+        XCTAssertEqual(displayList(frames[0])?.uniqueID, displayList(frames[1])?.uniqueID)
+    }
+
+    func testReplacesImagesThatCouldNotBeEncoded() throws {
+        let builder = DisplayListBuilder()
+        builder.drawImage(TestCaptureImage(width: 30, height: 20), Offset(1, 2), Paint())
+        let picture = PictureLayer(canvasBounds: Rect(left: 0, top: 0, right: 40, bottom: 30))
+        picture.picture = builder.build()
+        let root = OffsetLayer()
+        root.append(picture)
+
+        let frames = try capture([root])
+        let replayedRoot = try XCTUnwrap(frames.first?.layerTree.root as? ContainerLayer)
+        let replayedPicture = try XCTUnwrap(replayedRoot.children.first as? PictureLayer)
+        let image = try XCTUnwrap(replayedPicture.picture?.images.first)
+        XCTAssertEqual(image.width, 30)
+        XCTAssertEqual(image.height, 20)
+    }
+
+    func testRejectsInvalidFile() throws {
+        try Data("not a capture".utf8).write(to: url)
+        XCTAssertThrowsError(try FrameCapture.load(from: url, codec: NullCaptureCodec()))
+    }
+}
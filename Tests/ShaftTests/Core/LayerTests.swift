@@ -0,0 +1,323 @@
+import SwiftMath
+import XCTest
+
+@testable import Shaft
+
+final class LayerTests: XCTestCase {
+    private func makePictureLayer() -> PictureLayer {
+        let builder = DisplayListBuilder()
+        builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+
+        let layer = PictureLayer(canvasBounds: Rect(left: 0, top: 0, right: 10, bottom: 10))
+        layer.picture = builder.build()
+        return layer
+    }
+
+    private func childrenHash(_ layer: ContainerLayer) -> Int {
+        var hasher = Hasher()
+        layer.hashChildren(into: &hasher)
+        return hasher.finalize()
+    }
+
+    func testMovingOffsetKeepsChildrenHash() {
+        let layer = OffsetLayer(offset: Offset(0, 0))
+        layer.append(makePictureLayer())
+        let before = childrenHash(layer)
+
+        layer.offset = Offset(0, 100)
+        XCTAssertEqual(childrenHash(layer), before)
+    }
+
+    func testRepaintingChildChangesHash() {
+        let layer = OffsetLayer()
+        layer.append(makePictureLayer())
+        let before = childrenHash(layer)
+
+        layer.removeAllChildren()
+        layer.append(makePictureLayer())
+        XCTAssertNotEqual(childrenHash(layer), before)
+    }
+
+    func testMovingDescendantChangesHash() {
+        let child = OffsetLayer()
+        child.append(makePictureLayer())
+        let layer = OffsetLayer()
+        layer.append(child)
+        let before = childrenHash(layer)
+
+        child.offset = Offset(5, 0)
+        XCTAssertNotEqual(childrenHash(layer), before)
+    }
+
+    func testChangingDeepDescendantInvalidatesCachedHashes() {
+        let picture = makePictureLayer()
+        let clip = ClipRectLayer(clipRect: Rect(left: 0, top: 0, right: 10, bottom: 10))
+        clip.append(picture)
+        let child = OffsetLayer()
+        child.append(clip)
+        let root = OffsetLayer()
+        root.append(child)
+        let before = root.contentHash
+        XCTAssertEqual(root.contentHash, before)
+
+        picture.picture = makePictureLayer().picture
+        XCTAssertNotEqual(root.contentHash, before)
+        let repainted = root.contentHash
+
+        clip.clipRect = Rect(left: 0, top: 0, right: 5, bottom: 5)
+        XCTAssertNotEqual(root.contentHash, repainted)
+    }
+
+    func testSnapshotKeepsContentHash() {
+        let root = OffsetLayer()
+        root.append(makePictureLayer())
+
+        XCTAssertEqual(root.snapshot().contentHash, root.contentHash)
+    }
+
+    func testPaintBoundsIncludeOffsetAndClip() {
+        let clip = ClipRectLayer(clipRect: Rect(left: 0, top: 0, right: 5, bottom: 5))
+        clip.append(makePictureLayer())
+        let layer = OffsetLayer(offset: Offset(10, 20))
+        layer.append(clip)
+
+        XCTAssertEqual(layer.paintBounds, Rect(left: 10, top: 20, right: 15, bottom: 25))
+    }
+
+    func testFirstFrameIsFullyDamaged() {
+        let root = OffsetLayer()
+        root.append(makePictureLayer())
+
+        let tracker = DamageTracker()
+        XCTAssertEqual(
+            tracker.computeDamage(LayerTree(root: root), size: ISize(100, 100)),
+            Rect(left: 0, top: 0, right: 100, bottom: 100)
+        )
+    }
+
+    func testUnchangedTreeHasNoDamage() {
+        let root = OffsetLayer()
+        root.append(makePictureLayer())
+
+        let tracker = DamageTracker()
+        _ = tracker.computeDamage(LayerTree(root: root), size: ISize(100, 100))
+        XCTAssertTrue(tracker.computeDamage(LayerTree(root: root), size: ISize(100, 100)).isEmpty)
+    }
+
+    func testMovedLayerDamagesOldAndNewBounds() {
+        let child = OffsetLayer()
+        child.append(makePictureLayer())
+        let root = OffsetLayer()
+        root.append(makePictureLayer())
+        root.append(child)
+
+        let tracker = DamageTracker()
+        _ = tracker.computeDamage(LayerTree(root: root), size: ISize(100, 100))
+
+        child.offset = Offset(20, 0)
+        XCTAssertEqual(
+            tracker.computeDamage(LayerTree(root: root), size: ISize(100, 100)),
+            Rect(left: 0, top: 0, right: 30, bottom: 10)
+        )
+    }
+
+    func testSnapshotIsNotAffectedByLaterChanges() {
+        let picture = makePictureLayer()
+        let root = OffsetLayer(offset: Offset(1, 2))
+        root.append(picture)
+
+        let snapshot = root.snapshot() as! OffsetLayer
+        root.offset = Offset(3, 4)
+        root.removeAllChildren()
+
+        XCTAssertEqual(snapshot.offset, Offset(1, 2))
+        XCTAssertEqual(snapshot.layerID, root.layerID)
+        XCTAssertEqual(snapshot.children.count, 1)
+        XCTAssertEqual(snapshot.children[0].layerID, picture.layerID)
+        XCTAssertFalse(snapshot.children[0] === picture)
+    }
+
+    func testPrerollSkipsLayersOutsideClip() {
+        let visible = OffsetLayer()
+        visible.append(makePictureLayer())
+        let clippedOut = OffsetLayer(offset: Offset(100, 0))
+        clippedOut.append(makePictureLayer())
+        let clip = ClipRectLayer(clipRect: Rect(left: 0, top: 0, right: 50, bottom: 50))
+        clip.append(visible)
+        clip.append(clippedOut)
+
+        let bounds = clip.preroll(
+            context: LayerPrerollContext(cullRect: Rect(left: 0, top: 0, right: 100, bottom: 100))
+        )
+
+        // The bounds include the culled child, like paintBounds, and are
+        // limited by the clip.
+        XCTAssertEqual(bounds, Rect(left: 0, top: 0, right: 50, bottom: 10))
+        XCTAssertEqual(bounds, clip.paintBounds)
+        XCTAssertTrue(visible.needsPainting)
+        XCTAssertFalse(clippedOut.needsPainting)
+    }
+
+    func testPrerollMapsCullRectThroughTransform() {
+        let picture = makePictureLayer()
+        let layer = TransformLayer(transform: Matrix4x4f.scale(sx: 2, sy: 2, sz: 1))
+        layer.append(picture)
+
+        _ = layer.preroll(
+            context: LayerPrerollContext(cullRect: Rect(left: 30, top: 0, right: 40, bottom: 10))
+        )
+        XCTAssertFalse(picture.needsPainting)
+
+        _ = layer.preroll(
+            context: LayerPrerollContext(cullRect: Rect(left: 15, top: 0, right: 40, bottom: 10))
+        )
+        XCTAssertTrue(picture.needsPainting)
+    }
+
+    func testTransformBoundsIncludeOffsetAppliedOnBothSides() {
+        let layer = TransformLayer(transform: Matrix4x4f.scale(sx: 2, sy: 2, sz: 1))
+        layer.offset = Offset(10, 0)
+        layer.append(makePictureLayer())
+
+        // The offset is applied before the transform and again to the
+        // children, as in paint(context:).
+        let expected = Rect(left: 30, top: 0, right: 50, bottom: 20)
+        XCTAssertEqual(layer.paintBounds, expected)
+        let bounds = layer.preroll(
+            context: LayerPrerollContext(cullRect: Rect(left: 0, top: 0, right: 100, bottom: 100))
+        )
+        XCTAssertEqual(bounds, expected)
+    }
+
+    private func paint(_ layer: Layer) -> TestCanvas {
+        let canvas = TestCanvas()
+        layer.paint(context: LayerPaintContext(canvas: canvas, rasterCache: nil))
+        return canvas
+    }
+
+    func testOpacityIsFoldedIntoNonOverlappingChildren() {
+        let right = OffsetLayer(offset: Offset(20, 0))
+        right.append(makePictureLayer())
+        let layer = OpacityLayer(alpha: 0x80)
+        layer.append(makePictureLayer())
+        layer.append(right)
+
+        let canvas = paint(layer)
+        XCTAssertFalse(canvas.log.contains { $0.hasPrefix("saveLayer") })
+        XCTAssertEqual(canvas.paints.map(\.color.alpha), [0x80, 0x80])
+    }
+
+    func testOpacityUsesSaveLayerForOverlappingChildren() {
+        let shifted = OffsetLayer(offset: Offset(5, 5))
+        shifted.append(makePictureLayer())
+        let layer = OpacityLayer(alpha: 0x80)
+        layer.append(makePictureLayer())
+        layer.append(shifted)
+
+        let canvas = paint(layer)
+        XCTAssertTrue(canvas.log.contains("saveLayer(\(Rect(left: 0, top: 0, right: 15, bottom: 15)), paint)"))
+        XCTAssertEqual(canvas.paints.first?.color.alpha, 0x80)
+        XCTAssertEqual(canvas.paints.dropFirst().map(\.color.alpha), [0xFF, 0xFF])
+    }
+
+    func testColorFilterIsFoldedIntoChildPaints() {
+        let filter = ColorFilter.mode(Color(0xFF00_FF00), .srcIn)
+        let layer = ColorFilterLayer(colorFilter: filter)
+        layer.append(makePictureLayer())
+
+        let canvas = paint(layer)
+        XCTAssertFalse(canvas.log.contains { $0.hasPrefix("saveLayer") })
+        XCTAssertEqual(canvas.paints.map(\.colorFilter), [filter])
+    }
+
+    func testColorFilterThatTintsTransparentPixelsUsesSaveLayer() {
+        let filter = ColorFilter.mode(Color(0x8000_FF00), .srcOver)
+        let layer = ColorFilterLayer(colorFilter: filter)
+        layer.append(makePictureLayer())
+
+        let canvas = paint(layer)
+        XCTAssertTrue(canvas.log.contains { $0.hasPrefix("saveLayer") })
+        XCTAssertEqual(canvas.paints.map(\.colorFilter), [filter, nil])
+    }
+
+    func testColorFilterModifiesTransparentBlack() {
+        XCTAssertTrue(ColorFilter.mode(Color(0xFF00_FF00), .src).modifiesTransparentBlack)
+        XCTAssertTrue(ColorFilter.mode(Color(0xFF00_FF00), .srcOver).modifiesTransparentBlack)
+        XCTAssertFalse(ColorFilter.mode(Color(0xFF00_FF00), .srcIn).modifiesTransparentBlack)
+        XCTAssertFalse(ColorFilter.mode(Color(0x0000_FF00), .src).modifiesTransparentBlack)
+
+        var matrix: [Float] = [
+            1, 0, 0, 0, 0,
+            0, 1, 0, 0, 0,
+            0, 0, 1, 0, 0,
+            0, 0, 0, 1, 0,
+        ]
+        XCTAssertFalse(ColorFilter.matrix(matrix).modifiesTransparentBlack)
+        matrix[19] = 10
+        XCTAssertTrue(ColorFilter.matrix(matrix).modifiesTransparentBlack)
+    }
+
+    func testOpacityAboveColorFilterIsAppliedAfterTheFilter() {
+        let filter = ColorFilter.mode(Color(0xFF00_FF00), .srcIn)
+        let colorFilter = ColorFilterLayer(colorFilter: filter)
+        colorFilter.append(makePictureLayer())
+        let layer = OpacityLayer(alpha: 0x80)
+        layer.append(colorFilter)
+
+        // The opacity gets its own layer, composited after the children were
+        // filtered.
+        let canvas = paint(layer)
+        XCTAssertEqual(canvas.paints.first?.color.alpha, 0x80)
+        XCTAssertEqual(canvas.paints.first?.colorFilter, nil)
+        XCTAssertEqual(canvas.paints.dropFirst().map(\.colorFilter), [filter])
+        XCTAssertEqual(canvas.paints.dropFirst().map(\.color.alpha), [0xFF])
+    }
+
+    func testLayerAnimationInterpolatesAndRepeats() {
+        let start = ContinuousClock.now
+        let once = LayerAnimation(
+            from: Offset(0, 0),
+            to: Offset(100, 0),
+            duration: .seconds(1),
+            startTime: start
+        )
+        XCTAssertEqual(once.value(at: start + .milliseconds(250)), Offset(25, 0))
+        XCTAssertEqual(once.value(at: start + .seconds(2)), Offset(100, 0))
+        XCTAssertTrue(once.isCompleted(at: start + .seconds(1)))
+
+        let reversing = LayerAnimation(
+            from: UInt8(0),
+            to: UInt8(200),
+            duration: .seconds(1),
+            repeatMode: .reverse,
+            startTime: start
+        )
+        XCTAssertEqual(reversing.value(at: start + .milliseconds(1500)), 100)
+        XCTAssertFalse(reversing.isCompleted(at: start + .seconds(10)))
+    }
+
+    func testTickingAnimatesSnapshotOnly() {
+        let start = ContinuousClock.now
+        let layer = OffsetLayer()
+        layer.offsetAnimation = LayerAnimation(
+            from: Offset(0, 0),
+            to: Offset(0, 40),
+            duration: .seconds(1),
+            startTime: start
+        )
+        let root = ContainerLayer()
+        root.append(layer)
+
+        let tree = LayerTree(root: root)
+        XCTAssertTrue(tree.hasAnimations)
+
+        let snapshot = tree.snapshot()
+        XCTAssertTrue(snapshot.tickAnimations(at: start + .milliseconds(500)))
+        XCTAssertEqual(
+            ((snapshot.root as! ContainerLayer).children[0] as! OffsetLayer).offset,
+            Offset(0, 20)
+        )
+        XCTAssertEqual(layer.offset, Offset.zero)
+        XCTAssertFalse(snapshot.tickAnimations(at: start + .seconds(1)))
+    }
+}
@@ -0,0 +1,33 @@
+import Foundation
+import XCTest
+
+@testable import Shaft
+
+final class TimelineTests: XCTestCase {
+    func testRecordsSpansOnlyWhileRecording() throws {
+        Timeline.timeSync("Ignored") {}
+
+        Timeline.startRecording()
+        let result = Timeline.timeSync("Layout", arguments: ["frame": "1"]) { 42 }
+        Timeline.instantSync("Marker")
+        let trace = Timeline.stopRecording()
+
+        XCTAssertEqual(result, 42)
+        XCTAssertEqual(trace.events.map(\.name), ["Layout", "Marker"])
+        XCTAssertEqual(trace.events[0].threadID, Timeline.currentThreadID)
+    }
+
+    func testExportsChromeTraceJSON() throws {
+        Timeline.startRecording()
+        Timeline.timeSync("Paint") {}
+        let json = try Timeline.stopRecording().chromeTraceJSON()
+
+        let object = try JSONSerialization.jsonObject(with: json) as! [String: Any]
+        let events = object["traceEvents"] as! [[String: Any]]
+        let paint = events.first { $0["name"] as? String == "Paint" }
+        XCTAssertEqual(paint?["ph"] as? String, "X")
+        XCTAssertEqual(paint?["cat"] as? String, "shaft")
+        XCTAssertNotNil(paint?["dur"])
+        XCTAssertTrue(events.contains { $0["ph"] as? String == "M" })
+    }
+}
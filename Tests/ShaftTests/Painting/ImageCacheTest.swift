@@ -0,0 +1,165 @@
+import Foundation
+import XCTest
+
+@testable import Shaft
+
+private final class TestImage: NativeImage {
+    init(width: UInt, height: UInt) {
+        self.width = width
+        self.height = height
+    }
+
+    let width: UInt
+
+    let height: UInt
+}
+
+private final class TestAnimatedImage: AnimatedImage {
+    init(_ image: NativeImage) {
+        self.image = image
+    }
+
+    let image: NativeImage
+
+    var frameCount: UInt { 1 }
+
+    var repetitionCount: UInt? { 0 }
+
+    func getNextFrame() -> FrameInfo? {
+        FrameInfo(duration: nil, image: image)
+    }
+
+    var byteCount: Int { Int(image.width * image.height) * 4 }
+}
+
+/// Counts how many times images are decoded.
+private final class TestLoader: @unchecked Sendable {
+    private let lock = NSLock()
+
+    private var _loadCount = 0
+
+    var loadCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return _loadCount
+    }
+
+    func decode(width: UInt = 10, height: UInt = 10) -> (Data) -> AnimatedImage? {
+        return { _ in
+            self.lock.lock()
+            self._loadCount += 1
+            self.lock.unlock()
+            return TestAnimatedImage(TestImage(width: width, height: height))
+        }
+    }
+}
+
+extension ImageCache {
+    /// Resolves an image whose encoded data is already at hand.
+    fileprivate func resolve(
+        _ provider: any ImageProvider,
+        configuration: ImageConfiguration = .empty,
+        decode: @escaping (Data) -> AnimatedImage?
+    ) -> AsyncStream<NativeImage> {
+        resolve(provider, configuration: configuration, fetch: { Data() }, decode: decode)
+    }
+}
+
+private func firstFrame(_ stream: AsyncStream<NativeImage>) async -> NativeImage? {
+    var iterator = stream.makeAsyncIterator()
+    return await iterator.next()
+}
+
+final class ImageCacheTest: XCTestCase {
+    func testCoalescesResolvesOfTheSameImage() async {
+        let cache = ImageCache()
+        let loader = TestLoader()
+        let provider = MemoryImage(data: Data([1]))
+
+        let first = cache.resolve(provider, decode: loader.decode())
+        let second = cache.resolve(provider, decode: loader.decode())
+
+        let firstImage = await firstFrame(first)
+        let secondImage = await firstFrame(second)
+        XCTAssertNotNil(firstImage)
+        XCTAssertTrue(firstImage === secondImage)
+        XCTAssertEqual(loader.loadCount, 1)
+        XCTAssertEqual(cache.missCount, 1)
+        XCTAssertEqual(cache.hitCount, 1)
+    }
+
+    func testKeysIncludeConfiguration() async {
+        let cache = ImageCache()
+        let loader = TestLoader()
+        let provider = MemoryImage(data: Data([1]))
+
+        _ = await firstFrame(cache.resolve(provider, decode: loader.decode()))
+        _ = await firstFrame(
+            cache.resolve(
+                provider,
+                configuration: ImageConfiguration(size: Size(20, 20)),
+                decode: loader.decode()
+            )
+        )
+        XCTAssertEqual(loader.loadCount, 2)
+        XCTAssertEqual(cache.count, 2)
+    }
+
+    func testEvictsLeastRecentlyUsedImagesOverBudget() async {
+        let cache = ImageCache()
+        cache.byteBudget = 1000  // Two 10x10 images.
+        let loader = TestLoader()
+        let providers = (1...3).map { MemoryImage(data: Data([UInt8($0)])) }
+
+        for provider in providers {
+            _ = await firstFrame(cache.resolve(provider, decode: loader.decode()))
+        }
+        XCTAssertEqual(cache.count, 2)
+        XCTAssertEqual(cache.byteCount, 800)
+
+        // The first image was evicted and is decoded again.
+        _ = await firstFrame(cache.resolve(providers[0], decode: loader.decode()))
+        XCTAssertEqual(loader.loadCount, 4)
+    }
+
+    func testKeepsShownImagesThatDoNotFitTheBudget() async {
+        let cache = ImageCache()
+        cache.byteBudget = 100
+        let loader = TestLoader()
+        let provider = MemoryImage(data: Data([1]))
+
+        let stream = cache.resolve(provider, decode: loader.decode())
+        var iterator = stream.makeAsyncIterator()
+        _ = await iterator.next()
+        XCTAssertEqual(cache.count, 0)
+        XCTAssertEqual(cache.liveImageCount, 1)
+
+        _ = await firstFrame(cache.resolve(provider, decode: loader.decode()))
+        XCTAssertEqual(loader.loadCount, 1)
+    }
+
+    func testCancelsQueuedDecodeWhenNoStreamIsLeft() async throws {
+        let pool = ImageDecodePool(maxConcurrentDecodes: 1)
+        let cache = ImageCache(decodePool: pool)
+        let loader = TestLoader()
+        let blocker = DispatchSemaphore(value: 0)
+        let busy = Task { try await pool.run { blocker.wait() } }
+        while pool.runningCount == 0 {
+            try await Task.sleep(for: .milliseconds(1))
+        }
+
+        let stream = cache.resolve(MemoryImage(data: Data([1])), decode: loader.decode())
+        let listener = Task { await firstFrame(stream) }
+        while pool.queuedCount == 0 {
+            try await Task.sleep(for: .milliseconds(1))
+        }
+        listener.cancel()
+        _ = await listener.value
+
+        XCTAssertEqual(pool.queuedCount, 0)
+        XCTAssertEqual(cache.pendingImageCount, 0)
+        blocker.signal()
+        try await busy.value
+        XCTAssertEqual(loader.loadCount, 0)
+    }
+}
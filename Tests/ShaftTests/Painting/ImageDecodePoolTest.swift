@@ -0,0 +1,103 @@
+import Foundation
+import XCTest
+
+@testable import Shaft
+
+/// Records which decodes ran, in order.
+private final class DecodeLog: @unchecked Sendable {
+    private let lock = NSLock()
+
+    private var _names: [String] = []
+
+    var names: [String] {
+        lock.lock()
+        defer { lock.unlock() }
+        return _names
+    }
+
+    func record(_ name: String) -> () -> Void {
+        return {
+            self.lock.lock()
+            self._names.append(name)
+            self.lock.unlock()
+        }
+    }
+}
+
+final class ImageDecodePoolTest: XCTestCase {
+    /// Occupies the only worker of `pool` until the returned semaphore is
+    /// signalled.
+    private func block(
+        _ pool: ImageDecodePool
+    ) async throws -> (DispatchSemaphore, Task<Void, Error>) {
+        let blocker = DispatchSemaphore(value: 0)
+        let task = Task { try await pool.run { blocker.wait() } }
+        while pool.runningCount == 0 {
+            try await Task.sleep(for: .milliseconds(1))
+        }
+        return (blocker, task)
+    }
+
+    private func waitUntilQueued(_ count: Int, in pool: ImageDecodePool) async throws {
+        while pool.queuedCount < count {
+            try await Task.sleep(for: .milliseconds(1))
+        }
+    }
+
+    func testRunsVisibleDecodesBeforePrefetch() async throws {
+        let pool = ImageDecodePool(maxConcurrentDecodes: 1)
+        let (blocker, busy) = try await block(pool)
+
+        let log = DecodeLog()
+        let prefetch = Task { try await pool.run(priority: .prefetch, log.record("prefetch")) }
+        try await waitUntilQueued(1, in: pool)
+        let visible = Task { try await pool.run(priority: .visible, log.record("visible")) }
+        try await waitUntilQueued(2, in: pool)
+
+        blocker.signal()
+        try await busy.value
+        try await prefetch.value
+        try await visible.value
+        XCTAssertEqual(log.names, ["visible", "prefetch"])
+    }
+
+    func testCancelledDecodeNeverRuns() async throws {
+        let pool = ImageDecodePool(maxConcurrentDecodes: 1)
+        let (blocker, busy) = try await block(pool)
+
+        let log = DecodeLog()
+        let task = Task { try await pool.run(log.record("cancelled")) }
+        try await waitUntilQueued(1, in: pool)
+        task.cancel()
+
+        do {
+            try await task.value
+            XCTFail("Expected CancellationError")
+        } catch {
+            XCTAssertTrue(error is CancellationError)
+        }
+        XCTAssertEqual(pool.queuedCount, 0)
+
+        blocker.signal()
+        try await busy.value
+        XCTAssertEqual(log.names, [])
+    }
+
+    func testLimitsConcurrentDecodes() async throws {
+        let pool = ImageDecodePool(maxConcurrentDecodes: 2)
+        let blocker = DispatchSemaphore(value: 0)
+        let tasks = (0..<3).map { _ in Task { try await pool.run { blocker.wait() } } }
+        while pool.runningCount < 2 || pool.queuedCount < 1 {
+            try await Task.sleep(for: .milliseconds(1))
+        }
+        XCTAssertEqual(pool.runningCount, 2)
+        XCTAssertEqual(pool.queuedCount, 1)
+
+        for _ in tasks {
+            blocker.signal()
+        }
+        for task in tasks {
+            try await task.value
+        }
+    }
+}
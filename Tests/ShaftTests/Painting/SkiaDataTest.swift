@@ -0,0 +1,39 @@
+#if canImport(ShaftSkia)
+    import CSkia
+    import Foundation
+    import XCTest
+
+    @testable import ShaftSkia
+
+    final class SkiaDataTest: XCTestCase {
+        func testAdoptingDataSharesItsBytes() {
+            let data = Data((0..<4096).map { UInt8(truncatingIfNeeded: $0) })
+            let skData = SkData_sp(adopting: data)
+
+            XCTAssertEqual(sk_data_get_size(skData), data.count)
+            data.withUnsafeBytes { bytes in
+                XCTAssertEqual(sk_data_get_bytes(skData), bytes.baseAddress)
+            }
+        }
+
+        func testMutatingAdoptedDataLeavesSkiaBytesUnchanged() {
+            var data = Data(repeating: 1, count: 4096)
+            let skData = SkData_sp(adopting: data)
+
+            data[0] = 2
+            data.append(contentsOf: [UInt8](repeating: 3, count: 4096))
+
+            let bytes = UnsafeRawBufferPointer(start: sk_data_get_bytes(skData), count: 4096)
+            XCTAssertEqual(Array(bytes), [UInt8](repeating: 1, count: 4096))
+        }
+
+        func testAdoptingSmallDataKeepsItsBytes() {
+            let data = Data([1, 2, 3])
+            let skData = SkData_sp(adopting: data)
+
+            XCTAssertEqual(sk_data_get_size(skData), 3)
+            let bytes = UnsafeRawBufferPointer(start: sk_data_get_bytes(skData), count: 3)
+            XCTAssertEqual(Array(bytes), [1, 2, 3])
+        }
+    }
+#endif
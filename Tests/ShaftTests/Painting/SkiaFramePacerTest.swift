@@ -0,0 +1,53 @@
+#if canImport(ShaftSkia)
+    import XCTest
+
+    @testable import ShaftSkia
+
+    final class SkiaFramePacerTest: XCTestCase {
+        func testWaitsUntilFramesInFlightAreBelowLimit() {
+            let pacer = SkiaFramePacer(mode: .asynchronous(maxFramesInFlight: 2))
+            var completed = 0
+            pacer.onFrameCompleted = { _ in completed += 1 }
+            let first = pacer.recordSubmission()
+            _ = pacer.recordSubmission()
+            XCTAssertEqual(pacer.framesInFlight, 2)
+
+            // The GPU completes the first frame on the third check.
+            var checks = 0
+            pacer.waitForFramesInFlight(below: 2) {
+                checks += 1
+                if checks == 3 {
+                    pacer.finish(first)
+                }
+            }
+
+            XCTAssertEqual(checks, 3)
+            XCTAssertEqual(pacer.framesInFlight, 1)
+            XCTAssertEqual(completed, 1)
+            XCTAssertNotNil(pacer.lastFrameGPUTime)
+        }
+
+        func testDoesNotWaitBelowLimit() {
+            let pacer = SkiaFramePacer(mode: .asynchronous(maxFramesInFlight: 2))
+            _ = pacer.recordSubmission()
+
+            var checks = 0
+            pacer.waitForFramesInFlight(below: 2) { checks += 1 }
+            XCTAssertEqual(checks, 1)
+        }
+
+        func testFinishingAFrameTwiceCountsItOnce() {
+            let pacer = SkiaFramePacer(mode: .asynchronous(maxFramesInFlight: 2))
+            var completed = 0
+            pacer.onFrameCompleted = { _ in completed += 1 }
+            let frame = pacer.recordSubmission()
+            _ = pacer.recordSubmission()
+
+            pacer.finish(frame)
+            pacer.finish(frame)
+
+            XCTAssertEqual(pacer.framesInFlight, 1)
+            XCTAssertEqual(completed, 1)
+        }
+    }
+#endif
@@ -0,0 +1,106 @@
+#if canImport(ShaftSkia)
+    import Foundation
+    import XCTest
+
+    @testable import Shaft
+    @testable import ShaftSkia
+
+    /// A uniformly gray 16x8 JPEG whose EXIF orientation rotates it by 90
+    /// degrees, so that it's shown at 8x16.
+    private let rotatedJPEG = Data(
+        base64Encoded: """
+            /9j/4QAiRXhpZgAATU0AKgAAAAgAAQESAAMAAAABAAYAAAAAAAD/2wBDAAEBAQEBAQEBAQEBAQEB\
+            AQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQH/wAALCAAI\
+            ABABAREA/8QAJgABAAAAAAAAAAAAAAAAAAAAABABAAAAAAAAAAAAAAAAAAAAAP/aAAgBAQAAPwAP\
+            /9k=
+            """
+    )!
+
+    /// A uniformly gray 32x16 JPEG with 4:2:0 chroma subsampling.
+    private let subsampledJPEG = Data(
+        base64Encoded: """
+            /9j/2wBDAAEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEB\
+            AQEBAQEBAQEBAQEBAQH/wAARCAAQACADASIAAhEAAxEA/8QAJgABAAAAAAAAAAAAAAAAAAAAABAB\
+            AAAAAAAAAAAAAAAAAAAAAP/aAAwDAQACAAMAAD8AAAAA/9k=
+            """
+    )!
+
+    /// ``subsampledJPEG`` with an EXIF orientation that rotates it by 90
+    /// degrees.
+    private let rotatedSubsampledJPEG = Data(
+        base64Encoded: """
+            /9j/4QAiRXhpZgAATU0AKgAAAAgAAQESAAMAAAABAAYAAAAAAAD/2wBDAAEBAQEBAQEBAQEBAQEB\
+            AQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEBAQH/wAARCAAQ\
+            ACADASIAAhEAAxEA/8QAJgABAAAAAAAAAAAAAAAAAAAAABABAAAAAAAAAAAAAAAAAAAAAP/aAAwD\
+            AQACAAMAAD8AAAAA/9k=
+            """
+    )!
+
+    /// A 1x1 GIF with two frames.
+    private let animatedGIF = Data(
+        base64Encoded: """
+            R0lGODlhAQABAIAAAAAA////If8LTkVUU0NBUEUyLjADAQAAACH5BAAKAAAALAAAAAABAAEAAAIC\
+            RAEAIfkEAAoAAAAsAAAAAAEAAQAAAgJEAQA7
+            """
+    )!
+
+    final class SkiaImageDecodeTest: XCTestCase {
+        private func decodedSize(_ data: Data, targetSize: ISize? = nil) -> ISize? {
+            guard let frame = SkiaAnimatedImage.decode(data, targetSize: targetSize)?.getNextFrame()
+            else {
+                return nil
+            }
+            return ISize(Int(frame.image.width), Int(frame.image.height))
+        }
+
+        func testRotatedImageKeepsItsAspectRatio() {
+            XCTAssertEqual(decodedSize(rotatedJPEG), ISize(8, 16))
+        }
+
+        func testRotatedImageIsSampledTowardsTargetInDisplayOrientation() {
+            XCTAssertEqual(decodedSize(rotatedJPEG, targetSize: ISize(4, 8)), ISize(4, 8))
+        }
+
+        private func decodePlanes(_ data: Data, targetSize: ISize? = nil) -> AnimatedImage? {
+            SkiaAnimatedImage.decode(data, targetSize: targetSize, yuvaPlanes: true)
+        }
+
+        func testSubsampledJPEGIsDecodedToPlanes() {
+            let image = decodePlanes(subsampledJPEG)
+            XCTAssertTrue(image is SkiaStillImage)
+            let frame = image?.getNextFrame()
+            XCTAssertEqual(frame?.image.width, 32)
+            XCTAssertEqual(frame?.image.height, 16)
+
+            // A full-size Y plane and quarter-size U and V planes, and the
+            // encoded data kept to decode to RGBA on raster canvases.
+            XCTAssertEqual(image?.byteCount, 32 * 16 * 3 / 2 + subsampledJPEG.count)
+        }
+
+        func testRotatedJPEGFallsBackToRGBA() {
+            let image = decodePlanes(rotatedSubsampledJPEG)
+            XCTAssertTrue(image is SkiaAnimatedImage)
+            let frame = image?.getNextFrame()
+            XCTAssertEqual(frame?.image.width, 16)
+            XCTAssertEqual(frame?.image.height, 32)
+            XCTAssertEqual(image?.byteCount, 16 * 32 * 4 + rotatedSubsampledJPEG.count)
+        }
+
+        func testSampledJPEGFallsBackToRGBA() {
+            let image = decodePlanes(subsampledJPEG, targetSize: ISize(16, 8))
+            XCTAssertTrue(image is SkiaAnimatedImage)
+            let frame = image?.getNextFrame()
+            XCTAssertEqual(frame?.image.width, 16)
+            XCTAssertEqual(frame?.image.height, 8)
+            XCTAssertEqual(image?.byteCount, 16 * 8 * 4 + subsampledJPEG.count)
+        }
+
+        func testAnimatedImageFallsBackToFrames() {
+            let image = decodePlanes(animatedGIF)
+            XCTAssertTrue(image is SkiaAnimatedImage)
+            XCTAssertEqual(image?.frameCount, 2)
+            // The displayed frame and the one being decoded.
+            XCTAssertEqual(image?.byteCount, 2 * 4 + animatedGIF.count)
+        }
+    }
+#endif
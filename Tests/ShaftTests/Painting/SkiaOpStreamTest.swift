@@ -0,0 +1,291 @@
+#if canImport(ShaftSkia)
+    import CSkia
+    import SwiftMath
+    import XCTest
+
+    @testable import Shaft
+    @testable import ShaftSkia
+
+    /// Draws every op on a canvas with its own call, including the ops of
+    /// nested display lists, which ``SkiaCanvas`` would send through an
+    /// ``SkiaOpStream``.
+    private final class PerOpReceiver: DlOpReceiver {
+        init(_ canvas: SkiaCanvas) {
+            self.canvas = canvas
+        }
+
+        let canvas: SkiaCanvas
+
+        func drawDisplayList(_ displayList: DisplayList) {
+            displayList.dispatch(to: self)
+        }
+
+        func save() { canvas.save() }
+
+        func saveLayer(_ bounds: Shaft.Rect, paint: Paint?) {
+            canvas.saveLayer(bounds, paint: paint)
+        }
+
+        func restore() { canvas.restore() }
+
+        func translate(_ dx: Float, _ dy: Float) { canvas.translate(dx, dy) }
+
+        func scale(_ sx: Float, _ sy: Float) { canvas.scale(sx, sy) }
+
+        func rotate(_ radians: Float) { canvas.rotate(radians) }
+
+        func transform(_ transform: Matrix4x4f) { canvas.transform(transform) }
+
+        func clipRect(_ rect: Shaft.Rect, _ clipOp: ClipOp, _ doAntiAlias: Bool) {
+            canvas.clipRect(rect, clipOp, doAntiAlias)
+        }
+
+        func clipRRect(_ rrect: RRect, _ doAntiAlias: Bool) {
+            canvas.clipRRect(rrect, doAntiAlias)
+        }
+
+        func drawLine(_ p0: Offset, _ p1: Offset, _ paint: Paint) {
+            canvas.drawLine(p0, p1, paint)
+        }
+
+        func drawRect(_ rect: Shaft.Rect, _ paint: Paint) { canvas.drawRect(rect, paint) }
+
+        func drawRRect(_ rrect: RRect, _ paint: Paint) { canvas.drawRRect(rrect, paint) }
+
+        func drawDRRect(_ outer: RRect, _ inner: RRect, _ paint: Paint) {
+            canvas.drawDRRect(outer, inner, paint)
+        }
+
+        func drawCircle(_ center: Offset, _ radius: Float, _ paint: Paint) {
+            canvas.drawCircle(center, radius, paint)
+        }
+
+        func drawPath(_ path: Path, _ paint: Paint) { canvas.drawPath(path, paint) }
+
+        func drawImage(_ image: NativeImage, _ offset: Offset, _ paint: Paint) {
+            canvas.drawImage(image, offset, paint)
+        }
+
+        func drawImageRect(
+            _ image: NativeImage,
+            _ src: Shaft.Rect,
+            _ dst: Shaft.Rect,
+            _ paint: Paint
+        ) {
+            canvas.drawImageRect(image, src, dst, paint)
+        }
+
+        func drawImageNine(
+            _ image: NativeImage,
+            _ center: Shaft.Rect,
+            _ dst: Shaft.Rect,
+            _ paint: Paint
+        ) {
+            canvas.drawImageNine(image, center, dst, paint)
+        }
+
+        func drawParagraph(_ paragraph: Paragraph, _ offset: Offset) {
+            canvas.drawParagraph(paragraph, offset)
+        }
+
+        func drawTextBlob(_ blob: TextBlob, _ offset: Offset, _ paint: Paint) {
+            canvas.drawTextBlob(blob, offset, paint)
+        }
+
+        func clear(color: Color) { canvas.clear(color: color) }
+    }
+
+    final class SkiaOpStreamTest: XCTestCase {
+        private let renderer = SkiaRasterRenderer()
+
+        private let size = ISize(64, 64)
+
+        /// A raster canvas without caches, so that display lists are always
+        /// replayed op by op.
+        private func makeCanvas() -> SkiaRasterCanvas {
+            let surface = sk_surface_make_raster(Int32(size.width), Int32(size.height))
+            return SkiaRasterCanvas(surface, size, pictureCache: nil, rasterCache: nil)
+        }
+
+        private func makeImage() -> NativeImage {
+            let canvas = makeCanvas()
+            canvas.clear(color: Color(0xFF00_00FF))
+            var paint = Paint()
+            paint.color = Color(0xFFFF_FF00)
+            canvas.drawCircle(Offset(32, 32), 20, paint)
+            var surface = canvas.skSurface
+            return SkiaImage(skImage: sk_surface_make_image_snapshot(&surface))
+        }
+
+        private func paint(
+            _ color: UInt32,
+            style: PaintingStyle = .fill,
+            configure: (inout Paint) -> Void = { _ in }
+        ) -> Paint {
+            var paint = Paint()
+            paint.color = Color(color)
+            paint.style = style
+            configure(&paint)
+            return paint
+        }
+
+        /// A display list that records every kind of op, with paints that
+        /// change each of the fields the op stream encodes.
+        private func makeDisplayList() -> DisplayList {
+            let nested = DisplayListBuilder()
+            nested.drawCircle(Offset(8, 8), 6, paint(0xFF80_4020))
+            nested.drawRect(
+                Rect(left: 2, top: 2, right: 12, bottom: 12),
+                paint(0xFF00_80FF, style: .stroke) { $0.strokeWidth = 2 }
+            )
+
+            let path = renderer.createPath()
+            path.moveTo(40, 40)
+            path.lineTo(60, 44)
+            path.lineTo(48, 60)
+
+            let paragraphBuilder = renderer.createParagraphBuilder(ParagraphStyle())
+            paragraphBuilder.addText("Op stream")
+            let paragraph = paragraphBuilder.build()
+            paragraph.layout(.width(64))
+
+            let image = makeImage()
+            let rrect = RRect.fromRectAndRadius(
+                Rect(left: 4, top: 30, right: 30, bottom: 60),
+                .circular(6)
+            )
+            let innerRRect = RRect.fromRectAndRadius(
+                Rect(left: 10, top: 36, right: 24, bottom: 54),
+                .circular(3)
+            )
+
+            let builder = DisplayListBuilder()
+            builder.clear(color: Color(0xFFFF_FFFF))
+            builder.drawLine(
+                Offset(0, 0),
+                Offset(63, 20),
+                paint(0xFF00_0000, style: .stroke) {
+                    $0.strokeWidth = 3
+                    $0.strokeCap = .round
+                }
+            )
+            builder.drawRect(
+                Rect(left: 20, top: 4, right: 44, bottom: 20),
+                paint(0x8000_FF00) { $0.blendMode = .multiply }
+            )
+            builder.drawRRect(
+                rrect,
+                paint(0xFFFF_0000, style: .stroke) {
+                    $0.strokeWidth = 4
+                    $0.strokeJoin = .bevel
+                    $0.isAntiAlias = false
+                }
+            )
+            builder.drawDRRect(
+                rrect,
+                innerRRect,
+                paint(0xFF00_00FF) { $0.maskFilter = MaskFilter(style: .normal, sigma: 2) }
+            )
+
+            builder.save()
+            builder.translate(32, 0)
+            builder.scale(0.5, 0.5)
+            builder.clipRect(Rect(left: 0, top: 0, right: 60, bottom: 60), .intersect, true)
+            builder.drawDisplayList(nested.build())
+            builder.restore()
+
+            builder.save()
+            builder.clipRRect(rrect, true)
+            builder.rotate(.pi / 12)
+            builder.drawCircle(
+                Offset(16, 44),
+                10,
+                paint(0xFF00_FFFF) {
+                    $0.colorFilter = .mode(Color(0xFFFF_00FF), .srcATop)
+                }
+            )
+            builder.restore()
+
+            builder.saveLayer(
+                Rect(left: 32, top: 32, right: 64, bottom: 64),
+                paint: paint(0x80FF_FFFF) {
+                    $0.colorFilter = .matrix([
+                        0, 0, 1, 0, 0,
+                        0, 1, 0, 0, 0,
+                        1, 0, 0, 0, 0,
+                        0, 0, 0, 1, 0,
+                    ])
+                }
+            )
+            builder.drawPath(path, paint(0xFFFF_8000))
+            builder.drawImage(image, Offset(48, 48), Paint())
+            builder.restore()
+
+            builder.saveLayer(Rect(left: 0, top: 0, right: 64, bottom: 64), paint: nil)
+            builder.transform(Matrix4x4f.translate(tx: 2, ty: 2, tz: 0))
+            builder.drawImageRect(
+                image,
+                Rect(left: 0, top: 0, right: 32, bottom: 32),
+                Rect(left: 0, top: 20, right: 16, bottom: 36),
+                Paint()
+            )
+            builder.drawImageNine(
+                image,
+                Rect(left: 24, top: 24, right: 40, bottom: 40),
+                Rect(left: 40, top: 0, right: 64, bottom: 16),
+                Paint()
+            )
+            builder.drawParagraph(paragraph, Offset(0, 48))
+            if let typeface = renderer.fontCollection.findTypeface(
+                [],
+                style: .normal,
+                weight: .normal
+            ).first, let glyph = typeface.getGlyphID(0x41) {
+                builder.drawTextBlob(
+                    renderer.createTextBlob(
+                        [glyph, glyph],
+                        positions: [Offset(0, 0), Offset(10, 0)],
+                        font: typeface.createFont(12)
+                    ),
+                    Offset(4, 28),
+                    paint(0xFF40_4040)
+                )
+            }
+            builder.restore()
+
+            // The default paint again, after paints that set every field.
+            builder.drawRect(Rect(left: 28, top: 28, right: 36, bottom: 36), Paint())
+            return builder.build()
+        }
+
+        private func pixels(of canvas: SkiaRasterCanvas) -> [UInt8] {
+            canvas.withPixels { pixels in
+                (0..<pixels.size.height).flatMap { row in
+                    let start = row * pixels.rowBytes
+                    return Array(pixels.bytes[start..<start + pixels.size.width * 4])
+                }
+            }
+        }
+
+        func testReplayMatchesPerOpDispatch() {
+            let displayList = makeDisplayList()
+
+            let streamed = makeCanvas()
+            streamed.drawDisplayList(displayList)
+
+            let perOp = makeCanvas()
+            displayList.dispatch(to: PerOpReceiver(perOp))
+
+            let expected = pixels(of: perOp)
+            let actual = pixels(of: streamed)
+            XCTAssertTrue(expected.contains { $0 != 0xFF }, "Nothing was drawn")
+            if let index = zip(actual, expected).firstIndex(where: { $0 != $1 }) {
+                let pixel = index / 4
+                XCTFail(
+                    "Pixel (\(pixel % size.width), \(pixel / size.width)) differs: "
+                        + "\(actual[index]) instead of \(expected[index])"
+                )
+            }
+        }
+    }
+#endif
@@ -0,0 +1,84 @@
+#if canImport(ShaftSkia)
+    import CSkia
+    import XCTest
+
+    @testable import Shaft
+    @testable import ShaftSkia
+
+    final class SkiaPaintTest: XCTestCase {
+        private let blurred = {
+            var paint = Paint()
+            paint.maskFilter = MaskFilter(style: .normal, sigma: 2)
+            return paint
+        }()
+
+        private let filtered = {
+            var paint = Paint()
+            paint.colorFilter = .mode(Color(0xFFFF_0000), .srcIn)
+            return paint
+        }()
+
+        /// Copies each paint into the same SkPaint with the diffed setters,
+        /// the way ``SkiaCanvas`` does between draws.
+        private func applyInOrder(_ paints: [Paint]) -> SkPaint {
+            var skPaint = SkPaint()
+            var previous: Paint?
+            for paint in paints {
+                paint.copyToSkia(paint: &skPaint, replacing: previous)
+                previous = paint
+            }
+            return skPaint
+        }
+
+        private func fresh(_ paint: Paint) -> SkPaint {
+            var skPaint = SkPaint()
+            paint.copyToSkia(paint: &skPaint)
+            return skPaint
+        }
+
+        func testClearingMaskFilterRemovesItFromSkPaint() {
+            XCTAssertNotNil(sk_paint_get_maskfilter(applyInOrder([blurred])))
+            XCTAssertNil(sk_paint_get_maskfilter(applyInOrder([blurred, Paint()])))
+            XCTAssertNil(sk_paint_get_maskfilter(applyInOrder([blurred, filtered])))
+        }
+
+        func testClearingColorFilterRemovesItFromSkPaint() {
+            XCTAssertNotNil(sk_paint_get_colorfilter(applyInOrder([filtered])))
+            XCTAssertNil(sk_paint_get_colorfilter(applyInOrder([filtered, Paint()])))
+            XCTAssertNil(sk_paint_get_colorfilter(applyInOrder([filtered, blurred])))
+        }
+
+        func testChangedBlurReplacesMaskFilter() {
+            var wider = blurred
+            wider.maskFilter = MaskFilter(style: .normal, sigma: 4)
+
+            XCTAssertEqual(
+                sk_paint_get_maskfilter(applyInOrder([blurred, wider])),
+                sk_paint_get_maskfilter(fresh(wider))
+            )
+            XCTAssertNotEqual(
+                sk_paint_get_maskfilter(fresh(wider)),
+                sk_paint_get_maskfilter(fresh(blurred))
+            )
+        }
+
+        func testFieldsReturningToDefaultMatchFreshPaint() {
+            var changed = blurred
+            changed.colorFilter = filtered.colorFilter
+            changed.color = Color(0x8000_FF00)
+            changed.isAntiAlias = false
+            changed.style = .stroke
+            changed.strokeWidth = 3
+
+            let diffed = applyInOrder([changed, Paint()])
+            let expected = fresh(Paint())
+
+            XCTAssertEqual(diffed.getColor(), expected.getColor())
+            XCTAssertEqual(diffed.isAntiAlias(), expected.isAntiAlias())
+            XCTAssertEqual(diffed.getStyle(), expected.getStyle())
+            XCTAssertEqual(diffed.getStrokeWidth(), expected.getStrokeWidth())
+            XCTAssertNil(sk_paint_get_maskfilter(diffed))
+            XCTAssertNil(sk_paint_get_colorfilter(diffed))
+        }
+    }
+#endif
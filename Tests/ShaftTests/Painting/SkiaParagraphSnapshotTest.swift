@@ -0,0 +1,49 @@
+#if canImport(ShaftSkia)
+    import XCTest
+
+    @testable import Shaft
+    @testable import ShaftSkia
+
+    final class SkiaParagraphSnapshotTest: XCTestCase {
+        private func makeParagraph() -> Paragraph {
+            let builder = SkiaRenderer().createParagraphBuilder(ParagraphStyle())
+            builder.addText("The quick brown fox jumps over the lazy dog")
+            return builder.build()
+        }
+
+        func testSnapshotKeepsLayoutWhenParagraphIsLaidOutAgain() {
+            let paragraph = makeParagraph()
+            paragraph.layout(.width(1000))
+            let snapshot = paragraph.snapshot()
+            let width = snapshot.width
+
+            paragraph.layout(.width(10))
+
+            XCTAssertEqual(snapshot.width, width)
+            XCTAssertNotEqual(paragraph.width, width)
+        }
+
+        func testSnapshotIsReusedUntilParagraphIsLaidOutAgain() {
+            let paragraph = makeParagraph()
+            paragraph.layout(.width(100))
+            let snapshot = paragraph.snapshot()
+
+            XCTAssertTrue(paragraph.snapshot() === snapshot)
+            paragraph.layout(.width(200))
+            XCTAssertFalse(paragraph.snapshot() === snapshot)
+        }
+
+        func testDisplayListSnapshotReplacesParagraphsAndKeepsIdentity() {
+            let paragraph = makeParagraph()
+            paragraph.layout(.width(100))
+            let builder = DisplayListBuilder()
+            builder.drawParagraph(paragraph, .zero)
+            let displayList = builder.build()
+
+            let snapshot = displayList.snapshot()
+
+            XCTAssertEqual(snapshot.uniqueID, displayList.uniqueID)
+            XCTAssertTrue(snapshot.paragraphs[0] is SkiaCapturedParagraph)
+        }
+    }
+#endif
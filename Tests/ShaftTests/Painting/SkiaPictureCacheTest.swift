@@ -0,0 +1,54 @@
+#if canImport(ShaftSkia)
+    import CSkia
+    import XCTest
+
+    @testable import Shaft
+    @testable import ShaftSkia
+
+    final class SkiaPictureCacheTest: XCTestCase {
+        private func makeDisplayList() -> DisplayList {
+            let builder = DisplayListBuilder()
+            builder.drawRect(Rect(left: 0, top: 0, right: 10, bottom: 10), Paint())
+            return builder.build()
+        }
+
+        func testUnchangedDisplayListIsRecordedOnceAndReused() {
+            let cache = SkiaPictureCache()
+            let displayList = makeDisplayList()
+
+            XCTAssertNil(cache.picture(for: displayList))
+            cache.endFrame()
+
+            let recorded = cache.picture(for: displayList)
+            XCTAssertNotNil(recorded)
+            XCTAssertEqual(cache.pictureCount, 1)
+            cache.endFrame()
+
+            let reused = cache.picture(for: displayList)
+            XCTAssertEqual(sk_picture_unique_id(reused!), sk_picture_unique_id(recorded!))
+            XCTAssertEqual(cache.pictureCount, 1)
+        }
+
+        func testPictureIsEvictedAfterIdleFrames() {
+            let cache = SkiaPictureCache()
+            cache.maxIdleFrames = 2
+            let displayList = makeDisplayList()
+
+            _ = cache.picture(for: displayList)
+            cache.endFrame()
+            XCTAssertNotNil(cache.picture(for: displayList))
+
+            // The layer is repainted and draws a new display list from now on.
+            let repainted = makeDisplayList()
+            for _ in 0..<2 {
+                cache.endFrame()
+                _ = cache.picture(for: repainted)
+            }
+            XCTAssertEqual(cache.pictureCount, 2)
+
+            cache.endFrame()
+            XCTAssertEqual(cache.pictureCount, 1)
+            XCTAssertNil(cache.picture(for: displayList))
+        }
+    }
+#endif
@@ -0,0 +1,73 @@
+#if canImport(ShaftSkia)
+    import XCTest
+
+    @testable import Shaft
+    @testable import ShaftSkia
+
+    final class SkiaRasterCacheTest: XCTestCase {
+        private let bounds = Rect(left: 0, top: 0, right: 10, bottom: 10)
+
+        private func draw(
+            _ cache: SkiaRasterCache,
+            key: Int,
+            layerID: Int? = nil,
+            on canvas: Canvas
+        ) -> Bool {
+            cache.draw(
+                key: key,
+                layerID: layerID ?? key,
+                bounds: bounds,
+                canvas: canvas
+            ) { context in
+                context.canvas.drawRect(self.bounds, Paint())
+            }
+        }
+
+        func testWindowsPaintedInTheSameFrameAdvanceTheCacheOnce() {
+            let renderer = SkiaRasterRenderer()
+            let windows = [
+                renderer.createRasterCanvas(size: ISize(20, 20)),
+                renderer.createRasterCanvas(size: ISize(20, 20)),
+            ]
+            let cache = SkiaRasterCache()
+            cache.stableFrameThreshold = 3
+
+            for uiFrame in 1...4 {
+                for (key, canvas) in windows.enumerated() {
+                    cache.beginFrame(uiFrame)
+                    let drawn = draw(cache, key: key, on: canvas)
+                    XCTAssertEqual(drawn, uiFrame >= 3, "frame \(uiFrame), window \(key)")
+                }
+            }
+            XCTAssertEqual(cache.hitCount, 2)
+            XCTAssertEqual(cache.evictionCount, 0)
+        }
+
+        func testTreesWithoutUIFrameAdvanceTheCacheEachTime() {
+            let canvas = SkiaRasterRenderer().createRasterCanvas(size: ISize(20, 20))
+            let cache = SkiaRasterCache()
+            cache.stableFrameThreshold = 2
+
+            cache.beginFrame(nil)
+            XCTAssertFalse(draw(cache, key: 0, on: canvas))
+            cache.beginFrame(nil)
+            XCTAssertTrue(draw(cache, key: 0, on: canvas))
+            cache.beginFrame(nil)
+            XCTAssertTrue(draw(cache, key: 0, on: canvas))
+            XCTAssertEqual(cache.hitCount, 1)
+        }
+
+        func testSnapshotIsNotDrawnForAnotherLayerWithTheSameKey() {
+            let canvas = SkiaRasterRenderer().createRasterCanvas(size: ISize(20, 20))
+            let cache = SkiaRasterCache()
+            cache.stableFrameThreshold = 1
+
+            cache.beginFrame(nil)
+            XCTAssertTrue(draw(cache, key: 0, layerID: 1, on: canvas))
+            XCTAssertFalse(draw(cache, key: 0, layerID: 2, on: canvas))
+            XCTAssertTrue(draw(cache, key: 0, layerID: 1, on: canvas))
+            XCTAssertEqual(cache.hitCount, 1)
+            XCTAssertEqual(cache.missCount, 2)
+        }
+    }
+#endif
@@ -0,0 +1,47 @@
+#if canImport(ShaftSkia)
+    import XCTest
+
+    @testable import ShaftSkia
+
+    final class SkiaResourceCacheTest: XCTestCase {
+        func testPurgeOfAllResourcesWinsOverScratchOnly() {
+            let controller = SkiaResourceCacheController()
+
+            controller.purgeUnlockedResources(scratchOnly: true)
+            XCTAssertEqual(controller.takeRequests().purgeScratchOnly, true)
+
+            controller.purgeUnlockedResources(scratchOnly: true)
+            controller.purgeUnlockedResources(scratchOnly: false)
+            controller.purgeUnlockedResources(scratchOnly: true)
+            XCTAssertEqual(controller.takeRequests().purgeScratchOnly, false)
+        }
+
+        func testShortestUnusedDurationWins() {
+            let controller = SkiaResourceCacheController()
+
+            controller.purgeResources(notUsedFor: .seconds(5))
+            controller.purgeResources(notUsedFor: .seconds(2))
+            controller.purgeResources(notUsedFor: .seconds(10))
+            XCTAssertEqual(controller.takeRequests().purgeNotUsedFor, .seconds(2))
+        }
+
+        func testLatestLimitWins() {
+            let controller = SkiaResourceCacheController(limit: 100)
+
+            controller.limit = 200
+            controller.limit = 50
+            XCTAssertEqual(controller.limit, 50)
+            XCTAssertEqual(controller.takeRequests().limit, 50)
+        }
+
+        func testTakingRequestsClearsThem() {
+            let controller = SkiaResourceCacheController()
+            controller.limit = 1
+            controller.purgeUnlockedResources(scratchOnly: false)
+            controller.purgeResources(notUsedFor: .seconds(1))
+
+            XCTAssertNotEqual(controller.takeRequests(), SkiaResourceCacheRequests())
+            XCTAssertEqual(controller.takeRequests(), SkiaResourceCacheRequests())
+        }
+    }
+#endif
@@ -0,0 +1,109 @@
+#if canImport(ShaftSkia)
+    import CSkia
+    import Foundation
+    import XCTest
+
+    @testable import ShaftSkia
+
+    final class SkiaShaderCacheTest: XCTestCase {
+        private var directory: URL!
+
+        override func setUpWithError() throws {
+            directory = FileManager.default.temporaryDirectory
+                .appendingPathComponent("SkiaShaderCacheTest-\(UUID().uuidString)")
+        }
+
+        override func tearDownWithError() throws {
+            try? FileManager.default.removeItem(at: directory)
+        }
+
+        private func withCache<R>(
+            maxBytes: Int = 1024 * 1024,
+            _ body: (OpaquePointer) throws -> R
+        ) rethrows -> R {
+            let cache = sk_shader_cache_new(directory.path, maxBytes)!
+            defer { sk_shader_cache_delete(cache) }
+            return try body(cache)
+        }
+
+        private func store(_ cache: OpaquePointer, _ key: String, _ data: Data) {
+            sk_shader_cache_store(
+                cache,
+                SkData_sp(adopting: Data(key.utf8)),
+                SkData_sp(adopting: data)
+            )
+        }
+
+        private func load(_ cache: OpaquePointer, _ key: String) -> Data? {
+            let data = sk_shader_cache_load(cache, SkData_sp(adopting: Data(key.utf8)))
+            guard data.__convertToBool(), let bytes = sk_data_get_bytes(data) else {
+                return nil
+            }
+            return Data(bytes: bytes, count: sk_data_get_size(data))
+        }
+
+        private func entryFiles() throws -> [URL] {
+            try FileManager.default.contentsOfDirectory(
+                at: directory,
+                includingPropertiesForKeys: nil
+            )
+        }
+
+        func testEntriesAreLoadedByALaterCache() throws {
+            let program = Data((0..<100).map { UInt8($0) })
+            withCache { store($0, "program-key", program) }
+
+            withCache { cache in
+                XCTAssertEqual(load(cache, "program-key"), program)
+                XCTAssertNil(load(cache, "other-key"))
+            }
+            XCTAssertEqual(try entryFiles().map(\.pathExtension), ["shader"])
+        }
+
+        func testEntryOfAnotherKeyInTheSameFileMisses() throws {
+            try withCache { cache in
+                store(cache, "first-key", Data([1, 2, 3]))
+                let first = try entryFiles()[0]
+                store(cache, "second-key", Data([4, 5, 6]))
+                let second = try entryFiles().first { $0 != first }!
+
+                // Simulates two keys with the same hash.
+                try FileManager.default.removeItem(at: second)
+                try FileManager.default.copyItem(at: first, to: second)
+
+                XCTAssertNil(load(cache, "second-key"))
+                XCTAssertEqual(load(cache, "first-key"), Data([1, 2, 3]))
+            }
+        }
+
+        func testLeastRecentlyUsedEntriesAreDeletedBeyondLimit() throws {
+            // Each entry takes 4 bytes for the key size, 5 for the key and
+            // 100 for the data, so only two fit.
+            let data = Data(count: 100)
+            try withCache(maxBytes: 250) { cache in
+                store(cache, "key-a", data)
+                let fileA = try entryFiles()[0]
+                store(cache, "key-b", data)
+                let fileB = try entryFiles().first { $0 != fileA }!
+
+                try FileManager.default.setAttributes(
+                    [.modificationDate: Date(timeIntervalSinceNow: -7200)],
+                    ofItemAtPath: fileA.path
+                )
+                try FileManager.default.setAttributes(
+                    [.modificationDate: Date(timeIntervalSinceNow: -3600)],
+                    ofItemAtPath: fileB.path
+                )
+                // Loading the older entry makes it the most recently used one.
+                XCTAssertNotNil(load(cache, "key-a"))
+
+                store(cache, "key-c", data)
+
+                XCTAssertEqual(try entryFiles().count, 2)
+                XCTAssertNil(load(cache, "key-b"))
+                XCTAssertNotNil(load(cache, "key-a"))
+                XCTAssertNotNil(load(cache, "key-c"))
+            }
+        }
+    }
+#endif
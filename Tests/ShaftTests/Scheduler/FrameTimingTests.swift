@@ -0,0 +1,54 @@
+import XCTest
+
+@testable import Shaft
+
+final class FrameTimingTests: XCTestCase {
+    func testFrameCompletesAfterRaster() {
+        let recorder = FrameTimingRecorder()
+        var delivered: [FrameTiming] = []
+        recorder.deliver = { $0() }
+        recorder.addListener { delivered.append($0) }
+
+        recorder.beginFrame(vsyncTimeStamp: .milliseconds(16))
+        recorder.measure(.layout) {}
+        let frameNumber = recorder.expectRaster()
+        recorder.endFrame()
+        XCTAssertTrue(recorder.recentTimings.isEmpty)
+
+        let now = ContinuousClock.now
+        recorder.reportRaster(
+            frameNumber: frameNumber!,
+            raster: FrameTimingSpan(start: now, end: now + .milliseconds(3)),
+            gpuFlush: FrameTimingSpan(start: now + .milliseconds(2), end: now + .milliseconds(3))
+        )
+
+        XCTAssertEqual(delivered.count, 1)
+        XCTAssertEqual(delivered[0].frameNumber, 1)
+        XCTAssertEqual(delivered[0].vsyncTimeStamp, .milliseconds(16))
+        XCTAssertNotNil(delivered[0].layout)
+        XCTAssertNil(delivered[0].build)
+        XCTAssertEqual(delivered[0].raster?.duration, .milliseconds(3))
+        XCTAssertEqual(delivered[0].gpuFlush?.duration, .milliseconds(1))
+    }
+
+    func testRingBufferKeepsMostRecentFrames() {
+        let recorder = FrameTimingRecorder(capacity: 3)
+        for _ in 0..<5 {
+            recorder.beginFrame(vsyncTimeStamp: nil)
+            recorder.measure(.build) {}
+            recorder.endFrame()
+        }
+        XCTAssertEqual(recorder.recentTimings.map(\.frameNumber), [3, 4, 5])
+
+        recorder.capacity = 2
+        XCTAssertEqual(recorder.recentTimings.map(\.frameNumber), [4, 5])
+    }
+
+    func testPhasesOutsideFramesAreNotRecorded() {
+        let recorder = FrameTimingRecorder()
+        XCTAssertEqual(recorder.measure(.paint) { 42 }, 42)
+        XCTAssertNil(recorder.expectRaster())
+        recorder.endFrame()
+        XCTAssertTrue(recorder.recentTimings.isEmpty)
+    }
+}
@@ -0,0 +1,132 @@
+import Foundation
+import SwiftMath
+
+@testable import Shaft
+
+/// A ``DlOpReceiver`` that records a readable log of every operation it
+/// receives. Nested display lists are flattened into the log.
+class TestOpReceiver: DlOpReceiver {
+    var log: [String] = []
+
+    var paints: [Paint] = []
+
+    func drawDisplayList(_ displayList: DisplayList) {
+        displayList.dispatch(to: self)
+    }
+
+    func save() {
+        log.append("save")
+    }
+
+    func saveLayer(_ bounds: Shaft.Rect, paint: Paint?) {
+        log.append("saveLayer(\(bounds), \(paint == nil ? "nil" : "paint"))")
+        if let paint {
+            paints.append(paint)
+        }
+    }
+
+    func restore() {
+        log.append("restore")
+    }
+
+    func translate(_ dx: Float, _ dy: Float) {
+        log.append("translate(\(dx), \(dy))")
+    }
+
+    func scale(_ sx: Float, _ sy: Float) {
+        log.append("scale(\(sx), \(sy))")
+    }
+
+    func rotate(_ radians: Float) {
+        log.append("rotate(\(radians))")
+    }
+
+    func transform(_ transform: Matrix4x4f) {
+        log.append("transform")
+    }
+
+    func clipRect(_ rect: Shaft.Rect, _ clipOp: ClipOp, _ doAntiAlias: Bool) {
+        log.append("clipRect(\(rect), \(clipOp), \(doAntiAlias))")
+    }
+
+    func clipRRect(_ rrect: RRect, _ doAntiAlias: Bool) {
+        log.append("clipRRect(\(rrect.outerRect), \(doAntiAlias))")
+    }
+
+    func drawLine(_ p0: Offset, _ p1: Offset, _ paint: Paint) {
+        log.append("drawLine(\(p0), \(p1))")
+        paints.append(paint)
+    }
+
+    func drawRect(_ rect: Shaft.Rect, _ paint: Paint) {
+        log.append("drawRect(\(rect))")
+        paints.append(paint)
+    }
+
+    func drawRRect(_ rrect: RRect, _ paint: Paint) {
+        log.append("drawRRect(\(rrect.outerRect))")
+        paints.append(paint)
+    }
+
+    func drawDRRect(_ outer: RRect, _ inner: RRect, _ paint: Paint) {
+        log.append("drawDRRect(\(outer.outerRect), \(inner.outerRect))")
+        paints.append(paint)
+    }
+
+    func drawCircle(_ center: Offset, _ radius: Float, _ paint: Paint) {
+        log.append("drawCircle(\(center), \(radius))")
+        paints.append(paint)
+    }
+
+    func drawPath(_ path: Path, _ paint: Paint) {
+        log.append("drawPath")
+        paints.append(paint)
+    }
+
+    func drawImage(_ image: NativeImage, _ offset: Offset, _ paint: Paint) {
+        log.append("drawImage(\(offset))")
+        paints.append(paint)
+    }
+
+    func drawImageRect(_ image: NativeImage, _ src: Shaft.Rect, _ dst: Shaft.Rect, _ paint: Paint)
+    {
+        log.append("drawImageRect(\(src), \(dst))")
+        paints.append(paint)
+    }
+
+    func drawImageNine(
+        _ image: NativeImage,
+        _ center: Shaft.Rect,
+        _ dst: Shaft.Rect,
+        _ paint: Paint
+    ) {
+        log.append("drawImageNine(\(center), \(dst))")
+        paints.append(paint)
+    }
+
+    func drawParagraph(_ paragraph: Paragraph, _ offset: Offset) {
+        log.append("drawParagraph(\(offset))")
+    }
+
+    func drawTextBlob(_ blob: TextBlob, _ offset: Offset, _ paint: Paint) {
+        log.append("drawTextBlob(\(offset))")
+        paints.append(paint)
+    }
+
+    func clear(color: Color) {
+        log.append("clear(\(color))")
+    }
+}
+
+/// A ``Canvas`` that logs its operations like ``TestOpReceiver``, for painting
+/// layers in tests.
+class TestCanvas: TestOpReceiver, Canvas {
+    func getSaveCount() -> Int {
+        log.reduce(1) { count, entry in
+            if entry == "restore" {
+                return count - 1
+            }
+            return entry.hasPrefix("save") ? count + 1 : count
+        }
+    }
+}